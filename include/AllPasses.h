@@ -16,8 +16,7 @@ enum class PassTag {
 // Front-end passes
 /* ===--------------------------------------------------------------------=== */
 
-utils::Pass& NewJoos1WParserPass(utils::PassManager& PM, SourceFile file,
-                                 utils::Pass* depends);
+utils::Pass& NewJoos1WParserPass(utils::PassManager& PM, SourceFile file);
 utils::Pass& NewAstBuilderPass(utils::PassManager& PM, utils::Pass* depends);
 
 DECLARE_PASS(HierarchyChecker);
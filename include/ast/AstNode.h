@@ -112,13 +112,19 @@ public:
    virtual SourceRange location() const = 0;
    /// @brief
    virtual DeclContext const* asDeclContext() const { return nullptr; }
+   /// @brief Gets the dense ID of the declaration, unique within its linking
+   /// unit. Assigned when the linking unit is built, see DeclMap.
+   uint32_t id() const { return id_; }
+   static constexpr uint32_t InvalidId = ~uint32_t{0};
 
 protected:
    std::pmr::string canonicalName_;
 
 private:
+   friend class Semantic;
    std::pmr::string name_;
    DeclContext* parent_;
+   uint32_t id_ = InvalidId;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -193,7 +199,10 @@ public:
    virtual ast::Decl const* getAsDecl() const { return nullptr; }
 
 private:
+   friend class Semantic;
    SourceRange loc_;
+   /// @brief The uniqued instance of this type, see Semantic::GetCanonicalType
+   mutable Type const* canonical_ = nullptr;
 };
 
 /* ===--------------------------------------------------------------------=== */
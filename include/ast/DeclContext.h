@@ -75,6 +75,9 @@ public:
    LinkingUnit(BumpAllocator& alloc,
                array_ref<CompilationUnit*> compilationUnits) noexcept;
    auto compliationUnits() const { return std::views::all(compilationUnits_); }
+   /// @brief The number of declarations in the linking unit, i.e., one past
+   /// the largest Decl::id() in it.
+   uint32_t numDecls() const { return numDecls_; }
    std::ostream& print(std::ostream& os, int indentation = 0) const override;
    int printDotNode(DotPrinter& dp) const override;
    utils::Generator<ast::AstNode const*> children() const override {
@@ -82,7 +85,9 @@ public:
    }
 
 private:
+   friend class Semantic;
    pmr_vector<CompilationUnit*> compilationUnits_;
+   uint32_t numDecls_ = 0;
 };
 
 class ClassDecl final : public DeclContext, public Decl {
@@ -177,6 +182,8 @@ public:
    auto modifiers() const { return modifiers_; }
    bool isConstructor() const { return isConstructor_; }
    auto parameters() const { return std::views::all(parameters_); }
+   /// @brief All the lexical declarations in the method, parameters included
+   auto locals() const { return std::views::all(locals_); }
    bool hasCanonicalName() const override { return true; }
    std::ostream& print(std::ostream& os, int indentation = 0) const override;
    int printDotNode(DotPrinter& dp) const override;
@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "ast/AstNode.h"
+#include "utils/Assert.h"
+
+namespace ast {
+
+/**
+ * @brief A side table mapping declarations to values of type T, stored as a
+ * vector indexed by the dense ID of the declaration (see Decl::id()). The
+ * table must be sized to the number of declarations in the linking unit
+ * before use, which makes lookups a single load instead of a hash probe.
+ *
+ * @tparam T The value type, which must be default constructible
+ */
+template <typename T>
+class DeclMap final {
+public:
+   DeclMap() = default;
+   explicit DeclMap(size_t numDecls) { reset(numDecls); }
+
+   /// @brief Clears the table and sizes it for numDecls declarations
+   void reset(size_t numDecls) {
+      values_.clear();
+      values_.resize(numDecls);
+      present_.assign(numDecls, false);
+   }
+   /// @brief Removes all the entries, keeping the size of the table
+   void clear() { reset(values_.size()); }
+   /// @brief The number of declarations the table can hold
+   size_t capacity() const { return values_.size(); }
+
+   /// @brief Returns true if the table has a value for decl
+   bool contains(Decl const* decl) const {
+      auto id = decl->id();
+      return id < present_.size() && present_[id];
+   }
+   /// @brief Gets the value for decl, default constructing it if needed
+   T& operator[](Decl const* decl) {
+      auto id = index(decl);
+      present_[id] = true;
+      return values_[id];
+   }
+   /// @brief Gets the value for decl, which must be in the table
+   T const& at(Decl const* decl) const {
+      assert(contains(decl) && "Decl not in table");
+      return values_[decl->id()];
+   }
+   T& at(Decl const* decl) {
+      assert(contains(decl) && "Decl not in table");
+      return values_[decl->id()];
+   }
+   /// @brief Gets a pointer to the value for decl, or nullptr if not present
+   T const* find(Decl const* decl) const {
+      return contains(decl) ? &values_[decl->id()] : nullptr;
+   }
+
+private:
+   size_t index(Decl const* decl) const {
+      assert(decl->id() != Decl::InvalidId && "Decl has no ID assigned");
+      assert(decl->id() < values_.size() && "Decl ID out of range");
+      return decl->id();
+   }
+
+private:
+   std::vector<T> values_;
+   std::vector<bool> present_;
+};
+
+} // namespace ast
@@ -51,47 +51,45 @@ private:
 
 public:
    BuiltInType(Kind kind, SourceRange loc) : Type{loc}, kind{kind} {}
-   BuiltInType(parsetree::BasicType::Type type, SourceRange loc = {}) : Type{loc} {
+   BuiltInType(parsetree::BasicType::Type type, SourceRange loc = {})
+         : Type{loc}, kind{KindFrom(type)} {}
+   BuiltInType(parsetree::Literal::Type type)
+         : Type{SourceRange{}}, kind{KindFrom(type)} {}
+   /// @brief Maps a parse tree basic type to the kind of built-in type
+   static Kind KindFrom(parsetree::BasicType::Type type) {
       switch(type) {
          case parsetree::BasicType::Type::Byte:
-            kind = Kind::Byte;
-            break;
+            return Kind::Byte;
          case parsetree::BasicType::Type::Short:
-            kind = Kind::Short;
-            break;
+            return Kind::Short;
          case parsetree::BasicType::Type::Int:
-            kind = Kind::Int;
-            break;
+            return Kind::Int;
          case parsetree::BasicType::Type::Char:
-            kind = Kind::Char;
-            break;
+            return Kind::Char;
          case parsetree::BasicType::Type::Boolean:
-            kind = Kind::Boolean;
-            break;
+            return Kind::Boolean;
          default:
             assert(false && "Invalid basic type");
       }
+      std::unreachable();
    }
-   BuiltInType(parsetree::Literal::Type type) : Type{SourceRange{}} {
+   /// @brief Maps a parse tree literal type to the kind of built-in type
+   static Kind KindFrom(parsetree::Literal::Type type) {
       switch(type) {
          case parsetree::Literal::Type::Integer:
-            kind = Kind::Int;
-            break;
+            return Kind::Int;
          case parsetree::Literal::Type::Character:
-            kind = Kind::Char;
-            break;
+            return Kind::Char;
          case parsetree::Literal::Type::String:
-            kind = Kind::String;
-            break;
+            return Kind::String;
          case parsetree::Literal::Type::Boolean:
-            kind = Kind::Boolean;
-            break;
+            return Kind::Boolean;
          case parsetree::Literal::Type::Null:
-            kind = Kind::NoneType;
-            break;
+            return Kind::NoneType;
          default:
             assert(false && "Invalid literal type");
       }
+      std::unreachable();
    }
    Kind getKind() const { return kind; }
    string_view toString() const override { return Kind_to_string(kind, "??"); }
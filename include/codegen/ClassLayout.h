@@ -0,0 +1,106 @@
+#pragma once
+
+#include <cstdint>
+#include <unordered_map>
+#include <unordered_set>
+#include <vector>
+
+#include "ast/AST.h"
+#include "ast/Decl.h"
+#include "ast/DeclContext.h"
+#include "ast/DeclMap.h"
+#include "semantic/HierarchyChecker.h"
+#include "tir/Context.h"
+#include "tir/Type.h"
+
+namespace codegen {
+
+class CodeGenerator;
+
+/**
+ * @brief The memory layout of a class object and its vtable. The layout of a
+ * class is derived from the layout of its superclass: every inherited field
+ * keeps its index (even if it is hidden), and the class' own instance fields
+ * are appended after them.
+ */
+struct ClassLayout {
+   /// @brief The layout of the superclass, or nullptr for java.lang.Object
+   ClassLayout const* parent;
+   /// @brief The IR types of the object struct, the vtable pointer first
+   std::vector<tir::Type*> fieldTypes;
+   /// @brief The offsets (in bits) of the fieldTypes in the object struct
+   std::vector<uint32_t> fieldOffsets;
+   /// @brief The size of the object struct in bits
+   uint32_t sizeInBits;
+   /// @brief The IR struct type of the class object
+   tir::StructType* type;
+   /// @brief The number of function pointer entries in the vtable
+   int numVTableEntries;
+   /// @brief The IR struct type of the vtable (the TypeID, then the entries)
+   tir::StructType* vtableType;
+};
+
+/// @brief Where an instance field is in the object struct of its class
+struct FieldLayout {
+   /// @brief The index of the field in ClassLayout::fieldTypes
+   int index;
+   /// @brief The offset of the field in the object struct, in bits
+   uint32_t offset;
+};
+
+/**
+ * @brief Computes the class layouts, field indices and vtable slots for a
+ * linking unit once, so codegen and RTTI emission can look them up in O(1).
+ */
+class ClassLayoutTable {
+public:
+   ClassLayoutTable(tir::Context& ctx, CodeGenerator& cg,
+                    semantic::HierarchyChecker& hc)
+         : ctx{ctx}, cg{cg}, hc{hc} {}
+   ClassLayoutTable(ClassLayoutTable const&) = delete;
+   ClassLayoutTable& operator=(ClassLayoutTable const&) = delete;
+
+   /// @brief Computes the layout of every class in the linking unit
+   void build(ast::LinkingUnit const* lu);
+   /// @brief Gets the layout of the class
+   ClassLayout const& get(ast::ClassDecl const* decl) const {
+      return layouts_.at(decl);
+   }
+   /// @brief Gets the index of the instance field in its class' struct type
+   int fieldIndex(ast::FieldDecl const* decl) const {
+      return fields_.at(decl).index;
+   }
+   /// @brief Gets the offset (in bits) of the instance field in the object
+   uint32_t fieldOffset(ast::FieldDecl const* decl) const {
+      return fields_.at(decl).offset;
+   }
+   /// @brief Gets the vtable slot of the method. Slot 0 is the TypeID.
+   int vtableIndex(ast::MethodDecl const* decl) const {
+      auto* index = vtableIndex_.find(decl);
+      return index ? *index : 0;
+   }
+
+private:
+   using InterferenceGraph =
+         std::unordered_map<const ast::MethodDecl*,
+                            std::unordered_set<const ast::MethodDecl*>>;
+   // Assigns the vtable slots such that the methods of any one type
+   // never share a slot
+   void assignVTableSlots(ast::LinkingUnit const* lu);
+   void colorInterferenceGraph(InterferenceGraph& graph);
+   // Computes the layout of decl after the layout of its superclass
+   ClassLayout const& computeLayout(ast::ClassDecl const* decl);
+
+private:
+   tir::Context& ctx;
+   CodeGenerator& cg;
+   semantic::HierarchyChecker& hc;
+   // AST class -> layout. Sized once per build, so parent pointers are stable.
+   ast::DeclMap<ClassLayout> layouts_;
+   // AST instance field -> index and offset in the struct type of its class
+   ast::DeclMap<FieldLayout> fields_;
+   // AST class method -> VTable index
+   ast::DeclMap<int> vtableIndex_;
+};
+
+} // namespace codegen
@@ -3,7 +3,9 @@
 #include "ast/AST.h"
 #include "ast/Decl.h"
 #include "ast/DeclContext.h"
+#include "ast/DeclMap.h"
 #include "ast/Stmt.h"
+#include "codegen/ClassLayout.h"
 #include "semantic/HierarchyChecker.h"
 #include "semantic/NameResolver.h"
 #include "tir/Constant.h"
@@ -44,6 +46,8 @@ public:
    tir::Type* emitType(ast::Type const* type);
    // Gets the array struct type used
    tir::StructType* arrayType() const { return arrayType_; }
+   // Gets the class layouts, valid once run() has started
+   ClassLayoutTable const& layouts() const { return layouts_; }
 
 private:
    void emitStmt(ast::Stmt const* stmt);
@@ -58,11 +62,6 @@ private:
    void emitClass(ast::ClassDecl const* decl);
    // Populate the RTTI mappings
    void populateRtti(ast::LinkingUnit const* lu);
-   // Populate the method index table
-   void populateMethodIndexTable(ast::LinkingUnit const* lu);
-   void colorInterferenceGraph(
-         std::unordered_map<const ast::MethodDecl*,
-                            std::unordered_set<const ast::MethodDecl*>>& graph);
    // Emit the vtable in the IR for the class
    void emitVTable(ast::ClassDecl const* decl);
 
@@ -92,21 +91,17 @@ private:
    // Local AST local decl -> IR alloca
    std::unordered_map<ast::VarDecl const*, tir::AllocaInst*> valueMap{};
    // Global static AST func/field -> IR global value
-   std::unordered_map<ast::Decl const*, tir::Value*> gvMap{};
-   // Global AST Class -> IR struct type map
-   std::unordered_map<ast::ClassDecl const*, tir::StructType*> typeMap{};
+   ast::DeclMap<tir::Value*> gvMap{};
+   // Class layouts, field indices and vtable slots
+   ClassLayoutTable layouts_;
    // Array type (cache)
    tir::StructType* arrayType_{nullptr};
    // AST class -> TypeID map
-   std::unordered_map<ast::Decl const*, int> rttiMap{};
+   ast::DeclMap<int> rttiMap{};
    // MxM table for rtti, where M is the total number of types
    std::vector<std::vector<bool>> rttiTable{};
-   // AST class field -> index in the IR struct type for that class (typeMap)
-   std::unordered_map<ast::FieldDecl const*, int> fieldIndexMap{};
-   // AST class -> VTable IR struct type map
-   std::unordered_map<ast::ClassDecl const*, tir::Value*> vtableMap{};
-   // AST class method -> VTable index
-   std::unordered_map<ast::MethodDecl const*, int> vtableIndexMap{};
+   // AST class -> VTable IR global value
+   ast::DeclMap<tir::Value*> vtableMap{};
    tir::IRBuilder builder{ctx};
    semantic::NameResolver& nr;
    semantic::HierarchyChecker& hc;
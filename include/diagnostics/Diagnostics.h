@@ -1,7 +1,11 @@
 #pragma once
 
+#include <atomic>
+#include <cstdint>
+#include <deque>
 #include <forward_list>
 #include <iostream>
+#include <limits>
 #include <ranges>
 #include <string_view>
 #include <variant>
@@ -42,6 +46,9 @@ public:
 
    auto args() const { return std::views::counted(arguments_, argIndex); }
 
+   /// @brief The location the diagnostic was reported at
+   SourceRange location() const { return std::get<SourceRange>(arguments_[0]); }
+
    std::ostream& emit(std::ostream& os) const {
       for(auto& arg : arguments_) {
          if(std::holds_alternative<std::string_view>(arg)) {
@@ -102,14 +109,37 @@ DiagnosticStream& operator<<(DiagnosticStream& str, T&& value) {
 // DiagnosticEngine
 /* ===--------------------------------------------------------------------=== */
 
+/**
+ * @brief Collects the errors and warnings of the compilation. Outside of a
+ * parallel region, the engine is single-threaded and the diagnostics are
+ * recorded as they are reported.
+ *
+ * Inside of a parallel region (see ParallelScope), any thread may report
+ * diagnostics. Each thread appends to its own buffer, which it publishes to
+ * the engine on its first report without taking a lock. When the region
+ * ends, the buffers are merged by the index of the task that reported them
+ * (see TaskScope), so the diagnostics come out in the same order as if the
+ * tasks had run serially in index order. hasErrors() is an atomic flag and
+ * can be checked at any time, i.e., to stop a task early.
+ */
 class DiagnosticEngine {
 public:
    explicit DiagnosticEngine(int verbose = 0) : verbose_{verbose} {}
+   DiagnosticEngine(DiagnosticEngine const&) = delete;
+   DiagnosticEngine& operator=(DiagnosticEngine const&) = delete;
+   ~DiagnosticEngine();
+
    DiagnosticBuilder ReportError(SourceRange loc) {
+      hasErrors_.store(true, std::memory_order_relaxed);
+      taskHasErrors_ = true;
+      if(parallel_) [[unlikely]]
+         return DiagnosticBuilder{reportParallel(loc, true)};
       errors_.emplace_after(errors_.before_begin(), loc);
       return DiagnosticBuilder{errors_.front()};
    }
    DiagnosticBuilder ReportWarning(SourceRange loc) {
+      if(parallel_) [[unlikely]]
+         return DiagnosticBuilder{reportParallel(loc, false)};
       warnings_.emplace_after(warnings_.before_begin(), loc);
       return DiagnosticBuilder{warnings_.front()};
    }
@@ -120,18 +150,101 @@ public:
       return DiagnosticStream{std::cerr};
    }
    void setVerbose(int verbose) { verbose_ = verbose; }
-   bool hasErrors() const { return !errors_.empty(); }
+   bool hasErrors() const { return hasErrors_.load(std::memory_order_relaxed); }
+   /// @brief Inside of a task (see TaskScope), true if the task reported an
+   /// error. Otherwise, the same as hasErrors().
+   bool hasErrorsInTask() const {
+      return currentTask_ == NoTask ? hasErrors() : taskHasErrors_;
+   }
+   /// @brief The errors, must not be called inside of a parallel region
    auto errors() const { return std::views::all(errors_); }
    bool hasWarnings() const { return !warnings_.empty(); }
+   /// @brief The warnings, must not be called inside of a parallel region
    auto warnings() const { return std::views::all(warnings_); }
 
 public:
    bool Verbose(int level = 1) const { return verbose_ >= level; }
 
+public:
+   /**
+    * @brief Marks a parallel region on the thread that starts the parallel
+    * work. The diagnostics reported in the region are merged into the engine
+    * when the scope ends. Regions do not nest.
+    */
+   class ParallelScope {
+   public:
+      explicit ParallelScope(DiagnosticEngine& diag) : diag_{diag} {
+         diag_.beginParallel();
+      }
+      ParallelScope(ParallelScope const&) = delete;
+      ParallelScope& operator=(ParallelScope const&) = delete;
+      ~ParallelScope() { diag_.endParallel(lastTask_); }
+
+      /// @brief Drops the diagnostics of the tasks after the given one when
+      /// merging, i.e., of the tasks a serial run would not have reached
+      void DiscardTasksAfter(size_t task) { lastTask_ = task; }
+
+   private:
+      DiagnosticEngine& diag_;
+      size_t lastTask_ = NoTask;
+   };
+
+   /**
+    * @brief Marks the task being run by the current thread inside of a
+    * parallel region. The diagnostics of task i are ordered before the ones
+    * of task i + 1, and the ones reported outside of any task come last.
+    */
+   class TaskScope {
+   public:
+      explicit TaskScope(size_t task)
+            : prevTask_{currentTask_}, prevHasErrors_{taskHasErrors_} {
+         currentTask_ = task;
+         taskHasErrors_ = false;
+      }
+      TaskScope(TaskScope const&) = delete;
+      TaskScope& operator=(TaskScope const&) = delete;
+      ~TaskScope() {
+         currentTask_ = prevTask_;
+         taskHasErrors_ = prevHasErrors_;
+      }
+
+   private:
+      size_t prevTask_;
+      bool prevHasErrors_;
+   };
+
+private:
+   static constexpr size_t NoTask = std::numeric_limits<size_t>::max();
+
+   // A diagnostic reported inside of a parallel region
+   struct PendingDiagnostic {
+      size_t task;
+      size_t seq;
+      bool isError;
+      DiagnosticStorage storage;
+   };
+   // The diagnostics reported by a single thread inside of a parallel region
+   struct ThreadBuffer {
+      std::deque<PendingDiagnostic> diags;
+      ThreadBuffer* next = nullptr;
+   };
+
+   DiagnosticStorage& reportParallel(SourceRange loc, bool isError);
+   void beginParallel();
+   void endParallel(size_t lastTask);
+
 private:
    int verbose_ = 0;
    std::forward_list<DiagnosticStorage> errors_;
    std::forward_list<DiagnosticStorage> warnings_;
+   std::atomic<bool> hasErrors_{false};
+   // Only changed by the thread that owns the engine, outside of the region
+   bool parallel_ = false;
+   uint64_t generation_ = 0;
+   // The buffers published by the threads in the current parallel region
+   std::atomic<ThreadBuffer*> buffers_{nullptr};
+   static thread_local size_t currentTask_;
+   static thread_local bool taskHasErrors_;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -181,11 +181,7 @@ public:
    /// @brief Iterates over the children of the node (including chains)
    utils::Generator<InstSelectNode*> childNodes() const;
    /// @brief Remove all the chains from the node
-   void clearChains() {
-      for(unsigned i = arity_; i < numChildren(); i++)
-         getRawChild(i)->removeUse({this, i});
-      children_.resize(arity_);
-   }
+   void clearChains() { truncateChildren(arity_); }
    /// @brief Gets the ith child of the node
    InstSelectNode* getChild(unsigned idx) const {
       return static_cast<InstSelectNode*>(getRawChild(idx));
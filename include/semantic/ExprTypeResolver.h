@@ -1,6 +1,8 @@
 #pragma once
 
 #include <memory_resource>
+#include <unordered_map>
+#include <utility>
 
 #include "ast/AstNode.h"
 #include "ast/Expr.h"
@@ -21,11 +23,19 @@ namespace semantic {
  */
 class ExprTypeResolver final : private ast::ExprEvaluator<ast::Type const*> {
    using Heap = std::pmr::memory_resource;
+   using TypePair = std::pair<ast::Type const*, ast::Type const*>;
+   struct TypePairHash {
+      size_t operator()(TypePair const& p) const {
+         auto h1 = std::hash<ast::Type const*>{}(p.first);
+         auto h2 = std::hash<ast::Type const*>{}(p.second);
+         return h1 ^ (h2 + 0x9e3779b9 + (h1 << 6) + (h1 >> 2));
+      }
+   };
 
 public:
    ExprTypeResolver(diagnostics::DiagnosticEngine& diag, Heap* heap,
                     ast::Semantic& sema)
-         : diag{diag}, heap{heap}, alloc{heap}, sema{sema} {}
+         : diag{diag}, heap{heap}, alloc{heap}, sema{sema}, assignableCache_{heap} {}
    void Init(HierarchyChecker* HC, NameResolver* NR) {
       this->HC = HC;
       this->NR = NR;
@@ -75,6 +85,7 @@ protected:
 public:
    // @brief Check if it is possible to convert
    // lhs to rhs (call this latter type T) by assignment conversion (§5.2);
+   // The result is cached per pair of canonical types.
    bool isAssignableTo(const Type* lhs, const Type* rhs) const;
 
    // @brief check if it is valid to cast exprType to castType
@@ -87,6 +98,10 @@ public:
    /// @brief Check if the type is a reference type or an array type.
    bool isReferenceOrArrType(const Type* type) const;
 
+private:
+   // Uncached isAssignableTo() over canonical types
+   bool isAssignableToImpl(const Type* lhs, const Type* rhs) const;
+
 private:
    diagnostics::DiagnosticEngine& diag;
    HierarchyChecker* HC;
@@ -95,6 +110,8 @@ private:
    Heap* heap;
    mutable BumpAllocator alloc;
    ast::Semantic& sema;
+   // (lhs, rhs) canonical type pair -> isAssignableTo(lhs, rhs)
+   mutable std::pmr::unordered_map<TypePair, bool, TypePairHash> assignableCache_;
 };
 
 } // namespace semantic
@@ -1,5 +1,7 @@
 #pragma once
 
+#include <memory>
+#include <span>
 #include <unordered_map>
 #include <unordered_set>
 #include <vector>
@@ -7,8 +9,10 @@
 #include "ast/AST.h"
 #include "ast/AstNode.h"
 #include "ast/Decl.h"
+#include "ast/DeclMap.h"
 #include "diagnostics/Diagnostics.h"
 #include "utils/Generator.h"
+#include "utils/PersistentTable.h"
 
 namespace semantic {
 
@@ -34,53 +38,77 @@ public:
    // @brief Check if an interface is a subperinterface of another class/interface
    bool isSuperInterface(ast::InterfaceDecl const* super, ast::Decl const* sub);
 
-   bool isInheritedSet(ast::Decl const* decl) {
-      return methodInheritanceMap_.find(decl) != methodInheritanceMap_.end();
+   /// @brief Structurally shared table of the methods a type inherits
+   using MethodTable = utils::PersistentTable<ast::MethodDecl const*>;
+   /// @brief Structurally shared table of the fields a class inherits
+   using FieldTable = utils::PersistentTable<ast::FieldDecl const*>;
+
+   bool isInheritedSet(ast::Decl const* decl) const {
+      auto* table = methodInheritanceMap_.find(decl);
+      return table && *table;
    }
 
-   auto& getInheritedMethods(ast::Decl const* decl) {
+   /// @brief Gets the method table of a class or interface. The slots of
+   /// the superclass (or primary superinterface) are preserved in the table.
+   MethodTable const& getMethodTable(ast::Decl const* decl) const {
       assert(isInheritedSet(decl));
-      std::vector<int> x;
-      return methodInheritanceMap_.at(decl);
+      return *methodInheritanceMap_.at(decl);
    }
 
-   auto& getInheritedMembers(ast::Decl const* decl) {
-      // assert(memberInheritancesMap_.find(decl) != memberInheritancesMap_.end());
-      return memberInheritancesMap_[decl];
+   /// @brief Iterate through all the methods declared or inherited by decl
+   utils::Generator<ast::MethodDecl const*> getInheritedMethods(
+         ast::Decl const* decl) const {
+      return getMethodTable(decl).entries();
    }
 
-   void setInheritedMethods(
-         ast::Decl const* decl,
-         std::pmr::vector<ast::MethodDecl const*>& inheritedMethods) {
-      assert(inheritanceMap_.find(decl) != inheritanceMap_.end());
-      methodInheritanceMap_.insert({decl, inheritedMethods});
+   /// @brief Iterate through all the (non-hidden) fields declared or
+   /// inherited by decl. Yields nothing if decl has no field table.
+   utils::Generator<ast::FieldDecl const*> getInheritedMembers(
+         ast::Decl const* decl) const {
+      auto* table = memberInheritancesMap_.find(decl);
+      if(!table || !*table) return {};
+      return (*table)->entries();
    }
 
 private:
    diagnostics::DiagnosticEngine& diag;
    ast::LinkingUnit const* lu_;
-   std::pmr::unordered_map<ast::Decl const*, std::pmr::unordered_set<ast::Decl const*>>
-         inheritanceMap_;
-   std::pmr::unordered_map<ast::Decl const*, std::pmr::vector<ast::MethodDecl const*>>
-         methodInheritanceMap_;
-   std::pmr::unordered_map<ast::Decl const*, std::pmr::vector<ast::FieldDecl const*>>
-         memberInheritancesMap_;
+   // Decl -> the direct supertypes of the decl
+   ast::DeclMap<std::pmr::vector<ast::Decl const*>> inheritanceMap_;
+   // Decl -> method and field tables, boxed as the tables are not movable
+   ast::DeclMap<std::unique_ptr<MethodTable>> methodInheritanceMap_;
+   ast::DeclMap<std::unique_ptr<FieldTable>> memberInheritancesMap_;
    void checkInheritance();
 
+   // Gets the direct supertypes of decl recorded by checkInheritance()
+   std::span<ast::Decl const* const> getDirectSupers(ast::Decl const* decl) const {
+      auto* supers = inheritanceMap_.find(decl);
+      if(!supers) return {};
+      return *supers;
+   }
+   void addDirectSuper(ast::Decl const* decl, ast::Decl const* super);
+   MethodTable& newMethodTable(ast::Decl const* decl, MethodTable const* parent);
+   FieldTable& newFieldTable(ast::Decl const* decl, FieldTable const* parent);
+
    // Check functions for method
    void checkClassConstructors(ast::ClassDecl const* classDecl);
-   void checkClassMethod(
-         ast::ClassDecl const* classDecl,
-         std::pmr::vector<ast::MethodDecl const*>& inheritedMethods);
-   void checkInterfaceMethod(
-         ast::InterfaceDecl const* interfaceDecl,
-         std::pmr::vector<ast::MethodDecl const*>& inheritedMethods);
+   void checkClassMethod(ast::ClassDecl const* classDecl,
+                         std::pmr::vector<ast::Decl const*> const& supers);
+   void checkInterfaceMethod(ast::InterfaceDecl const* interfaceDecl,
+                             std::pmr::vector<ast::Decl const*> const& supers);
 
    // Check method inheritance
    void checkMethodInheritance();
    void checkMethodInheritanceHelper(ast::Decl const* node,
                                      std::pmr::unordered_set<ast::Decl const*>& visited);
 
+   // Iterate the methods of all the direct supertypes in supers
+   utils::Generator<ast::MethodDecl const*> getSuperMethods(
+         std::pmr::vector<ast::Decl const*> const& supers) const;
+   // Picks the supertype whose method table the new table is derived from
+   MethodTable const* getPrimaryTable(
+         std::pmr::vector<ast::Decl const*> const& supers) const;
+
    void setInheritedMembersHelper(ast::ClassDecl const* node, ast::Decl const* parent);
 };
 
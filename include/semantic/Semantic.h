@@ -1,5 +1,7 @@
 #pragma once
 
+#include <array>
+#include <unordered_map>
 #include <unordered_set>
 
 #include "ast/AST.h"
@@ -31,6 +33,25 @@ public:
    BuiltInType* BuildBuiltInType(parsetree::Literal::Type type);
    BuiltInType* BuildBuiltInType(ast::BuiltInType::Kind type);
 
+   /* ===-----------------------------------------------------------------=== */
+   // Type uniquing
+   /* ===-----------------------------------------------------------------=== */
+
+   /// @brief Gets the uniqued array type of the (canonical) element type
+   ArrayType* GetArrayType(Type const* elementType);
+
+   /**
+    * @brief Maps a resolved type to its uniqued instance. There is exactly
+    * one canonical type per primitive kind, per resolved declaration and per
+    * canonical array element type, so two resolved types are equal iff their
+    * canonical types are the same object. The result is cached on the type.
+    *
+    * @param type The type to canonicalize, may be nullptr (i.e., void)
+    * @return Type const* The canonical type. Unresolved, invalid and
+    * synthetic method types are returned as-is.
+    */
+   Type const* GetCanonicalType(Type const* type);
+
    /* ===-----------------------------------------------------------------=== */
    // ast/Decl.h
    /* ===-----------------------------------------------------------------=== */
@@ -152,6 +173,10 @@ public:
       currentFieldScope_ = ScopeID::New(alloc);
    }
 
+private:
+   // Assigns the dense IDs to every declaration in the linking unit
+   void AssignDeclIds(LinkingUnit* lu);
+
 private:
    BumpAllocator& alloc;
    diagnostics::DiagnosticEngine& diag;
@@ -160,6 +185,11 @@ private:
    std::unordered_map<std::string, VarDecl const*> lexicalLocalScope;
    // java.lang.Object type
    ast::ReferenceType* objectType_;
+   // Uniqued types, see GetCanonicalType()
+   std::array<BuiltInType*, static_cast<size_t>(BuiltInType::Kind::LAST_MEMBER)>
+         builtinTypes_{};
+   std::pmr::unordered_map<Decl const*, ReferenceType*> referenceTypes_;
+   std::pmr::unordered_map<Type const*, ArrayType*> arrayTypes_;
    // Current lexical local scope
    ast::ScopeID const* currentScope_;
    // Current field scope
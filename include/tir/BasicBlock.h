@@ -1,5 +1,7 @@
 #pragma once
 
+#include <span>
+
 #include "tir/Value.h"
 #include "utils/DotPrinter.h"
 #include "utils/Generator.h"
@@ -9,9 +11,12 @@ namespace tir {
 class Instruction;
 class Function;
 class PhiNode;
+class BranchInst;
 
 class BasicBlock final : public Value {
    friend class Instruction;
+   friend class BranchInst;
+   friend class Function;
 
 private:
    // Private implementation of the iterator
@@ -105,6 +110,8 @@ public:
    }
    // Gets the parent function of this basic block
    auto* parent() const { return parent_; }
+   // Gets the dense number of this block within its function, see BlockMap
+   unsigned localNumber() const { return localNumber_; }
    // Gets an iterator to the first instruction of the block (if not empty)
    auto begin() { return iterator{first_, this, first_ == nullptr, false}; }
    // Gets an iterator to AFTER the last instruction of the block
@@ -131,20 +138,37 @@ public:
    void eraseFromParent();
    // Prints the DOT representation of this basic block
    int printDotNode(utils::DotPrinter&) const;
-   // Grab the sucessor basic blocks of this basic block
-   utils::Generator<BasicBlock*> successors() const;
-   // Grab the predecessor basic blocks of this basic block
-   utils::Generator<BasicBlock*> predecessors() const;
+   // Grab the (distinct) sucessor basic blocks of this basic block
+   std::span<BasicBlock* const> successors() const { return succs_; }
+   // Grab the (distinct) predecessor basic blocks of this basic block
+   std::span<BasicBlock* const> predecessors() const { return preds_; }
    // Iterate through the PHI nodes
    utils::Generator<PhiNode*> phis() const;
    // Destroy all instructions from this basic block
    void releaseAllReferences();
    bool isBasicBlock() const override { return true; }
+   // Replaces all uses of this block, moving the CFG edges along
+   void replaceAllUsesWith(GraphNode* newValue) override;
+
+private:
+   // Adds or removes the CFG edges of a branch in this block
+   void addBranchEdges(BranchInst* br);
+   void removeBranchEdges(BranchInst* br);
+   void addEdge(BasicBlock* succ);
+   void removeEdge(BasicBlock* succ);
 
 private:
    Instruction* first_;
    Instruction* last_;
    Function* parent_;
+   unsigned localNumber_ = NoLocalNumber;
+   // The CFG edges, kept up to date by the branches as they are inserted,
+   // erased or changed. The successors are in the order of the most recently
+   // changed branch, and succCounts_ holds the number of branch operands
+   // targeting each successor.
+   std::pmr::vector<BasicBlock*> succs_;
+   std::pmr::vector<unsigned> succCounts_;
+   std::pmr::vector<BasicBlock*> preds_;
 };
 
 } // namespace tir
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+#include "tir/CompilationUnit.h"
+#include "tir/Constant.h"
+#include "tir/Type.h"
+
+namespace tir {
+
+/**
+ * @brief The TIR bitcode is a compact binary encoding of a compilation unit.
+ * All the integers are unsigned LEB128 (varints) unless noted otherwise, and
+ * the sections are laid out as follows:
+ *
+ *    header   := "TIRB" version:u32
+ *    strings  := count (length bytes)*
+ *    types    := count (code payload)*
+ *    globals  := count (global)*
+ *    index    := (offset:u64 size:u64)* for each function with a body
+ *    bodies   := (body)*
+ *
+ * The types, globals and strings are referred to by their index in their
+ * table. The index gives the position of each function body in the module,
+ * so a body is only decoded when the function is materialized. Within a body,
+ * the blocks and instructions are referred to by their position in layout
+ * order.
+ */
+inline constexpr uint32_t BitcodeVersion = 1;
+
+/**
+ * @brief Writes the compilation unit to os as a bitcode module. The function
+ * bodies not yet loaded are materialized first.
+ */
+void WriteBitcode(CompilationUnit& CU, std::ostream& os);
+
+/**
+ * @brief Reads a bitcode module into a compilation unit. The types and
+ * globals are read eagerly by load(), and the function bodies lazily as the
+ * functions are materialized (see CompilationUnit::materialize). The data
+ * must outlive the reader.
+ *
+ * Malformed modules are reported by throwing a utils::FatalError.
+ */
+class BitcodeReader final : public Materializer {
+public:
+   BitcodeReader(CompilationUnit& CU, std::span<uint8_t const> data);
+   BitcodeReader(BitcodeReader const&) = delete;
+   BitcodeReader& operator=(BitcodeReader const&) = delete;
+   ~BitcodeReader() override;
+
+   /**
+    * @brief Maps the module at path into memory (or reads it, if mapping is
+    * not supported) and creates a reader owning the mapping.
+    */
+   static std::unique_ptr<BitcodeReader> OpenFile(CompilationUnit& CU,
+                                                  std::string const& path);
+   /**
+    * @brief Reads the types and global objects of the module into the
+    * compilation unit. The functions have no body until materialized.
+    */
+   void load();
+   void materialize(Function* fn) override;
+   void materializeAll() override;
+
+private:
+   class Cursor;
+   std::string_view readString(Cursor& cur) const;
+   Type* readType(Cursor& cur) const;
+   void readBody(Function* fn, std::span<uint8_t const> body);
+
+private:
+   CompilationUnit& CU_;
+   std::span<uint8_t const> data_;
+   // The mapping (or buffer) backing data_, if owned by the reader
+   void* mapping_ = nullptr;
+   std::vector<uint8_t> buffer_;
+   std::vector<std::string_view> strings_;
+   std::vector<Type*> types_;
+   std::vector<GlobalObject*> globals_;
+   // The bodies of the functions not materialized yet
+   std::unordered_map<Function*, std::span<uint8_t const>> bodies_;
+};
+
+} // namespace tir
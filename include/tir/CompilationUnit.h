@@ -1,5 +1,6 @@
 #pragma once
 
+#include <memory>
 #include <string_view>
 #include <unordered_map>
 
@@ -10,6 +11,19 @@
 
 namespace tir {
 
+/**
+ * @brief Loads the bodies of the functions of a compilation unit on demand,
+ * i.e., from a lazily read bitcode module (see BitcodeReader).
+ */
+class Materializer {
+public:
+   virtual ~Materializer() = default;
+   /// @brief Loads the body of fn, if it has one that is not loaded yet
+   virtual void materialize(Function* fn) = 0;
+   /// @brief Loads the bodies of all the functions not loaded yet
+   virtual void materializeAll() = 0;
+};
+
 class CompilationUnit {
    friend void RegisterAllIntrinsics(CompilationUnit& cu);
 
@@ -97,7 +111,9 @@ public:
    /// @brief Yields all global objects in the compilation unit
    utils::Generator<std::pair<std::string_view, GlobalObject*>> global_objects_kv()
          const {
-      for(auto& [name, go] : globals_) co_yield std::pair{name, go};
+      // The name must view the key, not a copy of it in a temporary pair
+      for(auto& [name, go] : globals_)
+         co_yield std::pair<std::string_view, GlobalObject*>{name, go};
    }
 
    /// @brief Get the context associated with this compilation unit
@@ -114,6 +130,20 @@ public:
    /// @brief Remove the global object with the given name
    void removeGlobalObject(std::string const& name) { globals_.erase(name); }
 
+   /// @brief Sets the materializer loading the function bodies on demand
+   void setMaterializer(std::unique_ptr<Materializer> materializer) {
+      materializer_ = std::move(materializer);
+   }
+   /// @brief Loads the body of fn if it is not loaded yet, this must be
+   /// called before looking at the body of a function
+   void materialize(Function* fn) {
+      if(materializer_) materializer_->materialize(fn);
+   }
+   /// @brief Loads the bodies of all the functions not loaded yet
+   void materializeAll() {
+      if(materializer_) materializer_->materializeAll();
+   }
+
 public:
    Function* getIntrinsic(Instruction::IntrinsicKind kind) {
       auto it = intrinsics_.find(kind);
@@ -134,6 +164,7 @@ private:
    Context& ctx_;
    std::pmr::unordered_map<std::string, GlobalObject*> globals_;
    std::pmr::unordered_map<Instruction::IntrinsicKind, Function*> intrinsics_;
+   std::unique_ptr<Materializer> materializer_;
 };
 
 } // namespace tir
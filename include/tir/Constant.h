@@ -50,11 +50,26 @@ private:
          : Constant{ctx, type}, value_{value} {}
 
 public:
+   /**
+    * @brief Gets the unique ConstantInt of type with value (truncated to the
+    * bitwidth of type), creating it if it does not exist yet. ConstantInts can
+    * therefore be compared by pointer.
+    */
    static ConstantInt* Create(Context& ctx, Type* type, uint64_t value) {
       assert(type->isIntegerType() && "Type must be an integer type");
-      auto* buf =
-            ctx.alloc().allocate_bytes(sizeof(ConstantInt), alignof(ConstantInt));
-      return new(buf) ConstantInt{ctx, type, value};
+      auto bits = cast<IntegerType>(type)->getBitWidth();
+      if(bits < 64) value &= (1ULL << bits) - 1;
+      ConstantIntKey key{type, value};
+      auto& shard = ctx.pimpl().constantIntShard(key);
+      std::unique_lock guard{shard.lock, std::defer_lock};
+      if(ctx.isConcurrent()) guard.lock();
+      auto [it, inserted] = shard.map.try_emplace(key);
+      if(inserted) {
+         auto* buf = ctx.alloc().allocate_bytes(sizeof(ConstantInt),
+                                                alignof(ConstantInt));
+         it->second = new(buf) ConstantInt{ctx, type, value};
+      }
+      return it->second;
    }
    static ConstantInt* AllOnes(Context& ctx, Type* type) {
       return Create(ctx, type, ~0ULL);
@@ -173,6 +188,7 @@ private:
 class Function final : public GlobalObject {
    friend class CompilationUnit;
    friend class BasicBlock;
+   friend class Instruction;
 
 private:
    Function(Context& ctx, CompilationUnit* parent, FunctionType* type,
@@ -266,11 +282,26 @@ public:
    Argument* arg(unsigned index) const {
       return static_cast<Argument*>(getChild(index));
    }
+   /**
+    * @brief Assigns dense local numbers (from 0, in layout order) to the
+    * blocks and instructions of the function, unless already numbered. The
+    * blocks and instructions inserted afterwards are numbered as they are
+    * inserted, so the numbers stay valid, but not necessarily dense.
+    */
+   void numberValues() const;
+   // Gets an upper bound on the local numbers of the blocks
+   unsigned numBlockNumbers() const { return numBlockNumbers_; }
+   // Gets an upper bound on the local numbers of the instructions
+   unsigned numInstNumbers() const { return numInstNumbers_; }
 
 private:
    void addBlock(BasicBlock* block) {
       if(!entryBB_) entryBB_ = block;
       body_.push_front(block);
+      if(numbered_) block->localNumber_ = numBlockNumbers_++;
+   }
+   void numberInstruction(Instruction* inst) const {
+      if(numbered_) inst->localNumber_ = numInstNumbers_++;
    }
 
 private:
@@ -278,6 +309,10 @@ private:
    BasicBlock* entryBB_ = nullptr;
    tir::CompilationUnit* parent_;
    Attrs attrs_{.all{0}};
+   // The local numbering is a cache, so it can be computed on const functions
+   mutable bool numbered_ = false;
+   mutable unsigned numBlockNumbers_ = 0;
+   mutable unsigned numInstNumbers_ = 0;
 };
 
 } // namespace tir
@@ -1,18 +1,94 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <mutex>
+#include <shared_mutex>
+#include <unordered_map>
+#include <unordered_set>
+#include <utility>
+
 #include "utils/BumpAllocator.h"
 #include "target/TargetInfo.h"
+#include "utils/Utils.h"
 
 namespace tir {
 
 class Type;
+class ConstantInt;
 class ConstantNullPointer;
 class FunctionType;
 class ArrayType;
 class IntegerType;
 class StructType;
 
+/**
+ * @brief The structural identity of a derived type being looked up: its data
+ * (i.e., the bitwidth or length) and its child types, which are first (if not
+ * nullptr) followed by rest (if not nullptr).
+ */
+struct TypeKey {
+   uint32_t data;
+   Type* first;
+   utils::range_ref<Type*>* rest;
+};
+
+/// @brief Hashes a derived type or a TypeKey by its structural identity
+struct TypeKeyHash {
+   using is_transparent = void;
+   std::size_t operator()(Type const* type) const;
+   std::size_t operator()(TypeKey const& key) const;
+};
+
+/// @brief Compares derived types and TypeKeys by their structural identity
+struct TypeKeyEqual {
+   using is_transparent = void;
+   bool operator()(Type const* a, Type const* b) const { return a == b; }
+   bool operator()(TypeKey const& key, Type const* type) const;
+   bool operator()(Type const* type, TypeKey const& key) const {
+      return (*this)(key, type);
+   }
+};
+
+/// @brief A hash-consing table of derived types (all of the same kind)
+using TypeSet = std::pmr::unordered_set<Type*, TypeKeyHash, TypeKeyEqual>;
+
+/// @brief The identity of a ConstantInt: its type and its (masked) value
+struct ConstantIntKey {
+   Type* type;
+   uint64_t value;
+   bool operator==(ConstantIntKey const&) const = default;
+};
+
+struct ConstantIntKeyHash {
+   std::size_t operator()(ConstantIntKey const& key) const {
+      auto seed = std::hash<Type*>{}(key.type);
+      return seed ^ (std::hash<uint64_t>{}(key.value) + 0x9e3779b97f4a7c15ULL +
+                     (seed << 6) + (seed >> 2));
+   }
+};
+
+/// @brief A hash-consing table of ConstantInts
+using ConstantIntMap =
+      std::pmr::unordered_map<ConstantIntKey, ConstantInt*, ConstantIntKeyHash>;
+
+/// @brief One shard of the ConstantInt table, with its own lock
+struct ConstantIntShard {
+   ConstantIntShard(BumpAllocator& alloc) : map{alloc} {}
+   std::mutex lock;
+   ConstantIntMap map;
+};
+
 struct ContextPImpl {
+private:
+   static constexpr size_t NumConstantIntShards = 16;
+   template <size_t... I>
+   static std::array<ConstantIntShard, sizeof...(I)> makeShards(
+         BumpAllocator& alloc, std::index_sequence<I...>) {
+      return {{((void)I, ConstantIntShard{alloc})...}};
+   }
+
 public:
    ContextPImpl(BumpAllocator& alloc, Type* const pointerType,
                 Type* const voidType, Type* const labelType,
@@ -21,16 +97,41 @@ public:
            arrayTypes(alloc),
            integerTypes(alloc),
            structTypes(alloc),
+           functionTypeSet(alloc),
+           arrayTypeSet(alloc),
+           integerTypeSet(alloc),
+           structTypeSet(alloc),
+           constantInts(makeShards(
+                 alloc, std::make_index_sequence<NumConstantIntShards>{})),
            pointerType(pointerType),
            voidType(voidType),
            labelType(labelType),
            nullPointer(nullPointer) {}
 
+   /// @brief The shard of the ConstantInt table that key belongs to
+   ConstantIntShard& constantIntShard(ConstantIntKey const& key) {
+      return constantInts[ConstantIntKeyHash{}(key) % NumConstantIntShards];
+   }
+
 public:
+   // The types in the order they were created (i.e., to name the structs)
    std::pmr::vector<FunctionType*> functionTypes;
    std::pmr::vector<ArrayType*> arrayTypes;
    std::pmr::vector<IntegerType*> integerTypes;
    std::pmr::vector<StructType*> structTypes;
+   // The same types, hash-consed by their structural identity
+   TypeSet functionTypeSet;
+   TypeSet arrayTypeSet;
+   TypeSet integerTypeSet;
+   TypeSet structTypeSet;
+   // The integer types of up to 64 bits by bitwidth, so that the lookups of
+   // the common types take no lock
+   std::array<std::atomic<IntegerType*>, 65> integerTypeCache{};
+   // Guards the type tables above in concurrent mode
+   std::shared_mutex typeLock;
+   // The uniqued integer constants, sharded so that threads creating
+   // constants rarely contend on the same lock
+   std::array<ConstantIntShard, NumConstantIntShards> constantInts;
    Type* const pointerType;
    Type* const voidType;
    Type* const labelType;
@@ -48,14 +149,84 @@ public:
    BumpAllocator& alloc() const { return alloc_; }
    ContextPImpl& pimpl() { return *pimpl_; }
    ContextPImpl const& pimpl() const { return *pimpl_; }
-   unsigned getNextValueID() { return value_counter++; }
+   unsigned getNextValueID() {
+      // Outside of concurrent mode, skip the (locked) read-modify-write
+      if(concurrent_) return value_counter.fetch_add(1, std::memory_order_relaxed);
+      auto id = value_counter.load(std::memory_order_relaxed);
+      value_counter.store(id + 1, std::memory_order_relaxed);
+      return id;
+   }
    auto const& TI() const { return TI_; }
 
+   /**
+    * @brief Turns concurrent mode on or off. In concurrent mode, several
+    * threads may create types, constants and values of this context at once
+    * (i.e., to build or transform different functions in parallel): the value
+    * IDs are allocated atomically, the type and constant tables are locked,
+    * the use lists of the values are locked (see utils::UseListLocks), and if
+    * the allocator is backed by a utils::CustomBufferResource, it is switched
+    * to concurrent mode as well, so each thread pool worker allocates out of
+    * its own sub-arena.
+    *
+    * Must not be called while the context is in use by another thread.
+    */
+   void setConcurrent(bool concurrent);
+   bool isConcurrent() const { return concurrent_; }
+
+   /// @brief Keeps the context in concurrent mode for the scope's lifetime,
+   /// then restores the mode it was in (i.e., the scopes may nest)
+   class ConcurrentScope {
+   public:
+      explicit ConcurrentScope(Context& ctx)
+            : ctx_{ctx}, wasConcurrent_{ctx.isConcurrent()} {
+         ctx_.setConcurrent(true);
+      }
+      ConcurrentScope(ConcurrentScope const&) = delete;
+      ConcurrentScope& operator=(ConcurrentScope const&) = delete;
+      ~ConcurrentScope() { ctx_.setConcurrent(wasConcurrent_); }
+
+   private:
+      Context& ctx_;
+      bool const wasConcurrent_;
+   };
+
+   /**
+    * @brief Finds the type matching key in set, or if there is none, creates
+    * it with create() and adds it to set and list.
+    *
+    * @param set The hash-consing table of the types of this kind
+    * @param list The types of this kind, in creation order
+    * @param key The structural identity of the type
+    * @param create Allocates and constructs the type, called at most once
+    */
+   template <typename T, typename F>
+   T* getOrCreateType(TypeSet& set, std::pmr::vector<T*>& list,
+                      TypeKey const& key, F&& create) {
+      // Most lookups find the type, so they only take the lock shared
+      {
+         std::shared_lock guard{pimpl_->typeLock, std::defer_lock};
+         if(concurrent_) guard.lock();
+         if(auto it = set.find(key); it != set.end()) return static_cast<T*>(*it);
+      }
+      std::unique_lock guard{pimpl_->typeLock, std::defer_lock};
+      if(concurrent_) {
+         guard.lock();
+         // Another thread may have created it in the meantime
+         if(auto it = set.find(key); it != set.end())
+            return static_cast<T*>(*it);
+      }
+      T* type = create();
+      list.push_back(type);
+      set.insert(type);
+      return type;
+   }
+
 private:
    BumpAllocator& alloc_;
    target::TargetInfo& TI_;
    ContextPImpl* pimpl_;
-   unsigned value_counter = 0;
+   std::atomic<unsigned> value_counter = 0;
+   bool concurrent_ = false;
 };
 
 } // namespace tir
\ No newline at end of file
@@ -29,6 +29,7 @@ class CompilationUnit;
  */
 class Instruction : public User {
    friend class BasicBlock;
+   friend class Function;
    // Public enum definitions //////////////////////////////////////////////////
 public:
 #define BINOP_KINDS(F) \
@@ -114,7 +115,7 @@ public:
          prev_->next_ = this;
       }
       inst->prev_ = this;
-      parent_ = inst->parent_;
+      setParent(inst->parent_);
       // If this is the first instruction in the BB, update the BB's first pointer
       if(!prev_ && parent_) {
          parent_->first_ = this;
@@ -129,7 +130,7 @@ public:
          next_->prev_ = this;
       }
       inst->next_ = this;
-      parent_ = inst->parent_;
+      setParent(inst->parent_);
       // If this is the last instruction in the BB, update the BB's last pointer
       if(!next_ && parent_) {
          parent_->last_ = this;
@@ -137,6 +138,9 @@ public:
    }
    // Gets the parent BB of this instruction, or nullptr if it has no parent
    auto* parent() const { return parent_; }
+   // Gets the dense number of this instruction within its function, see
+   // ValueMap
+   unsigned localNumber() const { return localNumber_; }
    // Gets the next instruction in the BB, or nullptr if this is the last
    Instruction* next() const { return next_; }
    // Gets the previous instruction in the BB, or nullptr if this is the first
@@ -156,7 +160,7 @@ public:
    /**
     * @brief Removes this instruction from its parent BB if it exists. Also
     * will unlink this instruction from the list, re-linking the previous and
-    * next instructions.
+    * next instructions, and clear the parent BB.
     */
    void eraseFromParent(bool keep = false) {
       assert(!isDestroyed() && "Instruction is already destroyed");
@@ -176,16 +180,29 @@ public:
       }
       // Destroy all references to the parent BB
       next_ = prev_ = nullptr;
+      setParent(nullptr);
       if(!keep) destroy();
    }
-   // Sets the parent BB of this instruction
-   void setParent(BasicBlock* parent) { parent_ = parent; }
+   // Sets the parent BB of this instruction (moving the CFG edges of branches)
+   void setParent(BasicBlock* parent);
    // Is this Value an Instruction?
    bool isInstruction() const override { return true; }
    // Gets the name of the intrinsic kind
    static inline std::string_view getIntrinsicName(IntrinsicKind kind) {
       return IntrinsicKind_to_string(kind, "??");
    }
+   // Gets the name of the binary operator
+   static inline std::string_view getBinOpName(BinOp op) {
+      return BinOp_to_string(op, "unknown");
+   }
+   // Gets the name of the comparison predicate
+   static inline std::string_view getPredicateName(Predicate pred) {
+      return Predicate_to_string(pred, "unknown");
+   }
+   // Gets the name of the cast operator
+   static inline std::string_view getCastOpName(CastOp op) {
+      return CastOp_to_string(op, "unknown");
+   }
    // Does this instruction have side effects (other than users and control flow)?
    virtual bool hasSideEffects() const { return false; }
 
@@ -195,6 +212,7 @@ private:
    Instruction* prev_;
    const DataType data_;
    BasicBlock* parent_;
+   unsigned localNumber_ = NoLocalNumber;
 };
 
 void RegisterAllIntrinsics(CompilationUnit& cu);
@@ -224,10 +242,7 @@ public:
    bool isTerminator() const override { return true; }
    BasicBlock* getSuccessor(unsigned idx) const;
    std::ostream& print(std::ostream& os) const override;
-   void replaceSuccessor(unsigned idx, BasicBlock* newBB) {
-      assert(idx < 2 && "Index out of bounds");
-      replaceChild(idx + 1, newBB);
-   }
+   void replaceSuccessor(unsigned idx, BasicBlock* newBB);
    Value* getCondition() const { return getChild(0); }
 };
 
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <string_view>
+
+#include "tir/CompilationUnit.h"
+
+namespace tir {
+
+/**
+ * @brief Parses TIR in the textual form printed by CompilationUnit::print
+ * into a compilation unit. The grammar is:
+ *
+ *    module   := (struct | global | function)*
+ *    struct   := "type" struct-name "=" "struct" "{" [type ("," type)*] "}"
+ *    global   := "global" type @name ["=" @function]
+ *    function := "function" ["external"] ["noreturn"] type @name
+ *                "(" [%name:type ("," %name:type)*] ")" ["{" block* "}"]
+ *    block    := ^name ":" instruction*
+ *    operand  := %name[:type] | ^name | @name | int:type | null | undef[:type]
+ *
+ * The instructions are as printed by Instruction::print, one per line, and
+ * ';' starts a comment. The functions and globals may be referred to before
+ * they are defined, and so can the values within a function as long as the
+ * reference is typed (i.e., %x.4:i32). The trailing ".N" of a value or block
+ * name is the ID printed to tell values apart, so it is not kept.
+ *
+ * Malformed input is reported by throwing a utils::FatalError, with the line
+ * and column of the error.
+ *
+ * @param CU The compilation unit to add the types, globals and functions to
+ * @param text The text to parse, which must outlive the call only
+ * @param filename The name of the input in the error messages
+ */
+void ParseModule(CompilationUnit& CU, std::string_view text,
+                 std::string_view filename = "<stdin>");
+
+} // namespace tir
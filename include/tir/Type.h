@@ -56,6 +56,8 @@ protected:
 
 protected:
    friend class Context;
+   friend struct TypeKeyHash;
+   friend struct TypeKeyEqual;
    explicit Type(Context* ctx) : Type{0, {}, ctx} {}
    Type(uint32_t data, ChildTypeArray subtypes, Context* ctx)
          : ctx_{ctx}, data_{data}, subtypes_{subtypes} {}
@@ -113,17 +115,25 @@ public:
     * @return IntegerType* The unique integer type with the specified bitwidth.
     */
    static IntegerType* get(Context& ctx, uint32_t bitwidth) {
-      // First, search ctx for existing IntegerType with bitwidth.
-      for(auto* type : ctx.pimpl().integerTypes) {
-         if(type->getData() == bitwidth) {
-            return type;
-         }
+      // Search ctx for existing IntegerType with bitwidth.
+      auto& pimpl = ctx.pimpl();
+      auto* cache = bitwidth < pimpl.integerTypeCache.size()
+                          ? &pimpl.integerTypeCache[bitwidth]
+                          : nullptr;
+      if(cache) {
+         if(auto* type = cache->load(std::memory_order_acquire)) return type;
       }
-      // If not found, create a new IntegerType with bitwidth.
-      void* buf =
-            ctx.alloc().allocate_bytes(sizeof(IntegerType), alignof(IntegerType));
-      auto* type = new(buf) IntegerType{ctx, bitwidth};
-      ctx.pimpl().integerTypes.push_back(type);
+      auto* type = ctx.getOrCreateType(
+            pimpl.integerTypeSet,
+            pimpl.integerTypes,
+            TypeKey{bitwidth, nullptr, nullptr},
+            [&] {
+               // If not found, create a new IntegerType with bitwidth.
+               void* buf = ctx.alloc().allocate_bytes(sizeof(IntegerType),
+                                                      alignof(IntegerType));
+               return new(buf) IntegerType{ctx, bitwidth};
+            });
+      if(cache) cache->store(type, std::memory_order_release);
       return type;
    }
 
@@ -133,8 +143,8 @@ public:
    uint32_t getBitWidth() const { return getData(); }
    uint32_t getSizeInBits() const override { return getBitWidth(); }
    bool isSizeBounded() const override { return true; }
-   [[clang::no_sanitize("shift-exponent")]] uint64_t getMask() const {
-      return (1ULL << getBitWidth()) - 1;
+   uint64_t getMask() const {
+      return getBitWidth() < 64 ? (1ULL << getBitWidth()) - 1 : ~0ULL;
    }
 };
 
@@ -151,35 +161,27 @@ public:
                             utils::range_ref<Type*> types) {
       // Grab the array size
       uint32_t size = 1 + types.size();
-      // First, search ctx for existing FunctionType with types.
-      for(auto* type : ctx.pimpl().functionTypes) {
-         auto data = type->getChildTypes();
-         if(size != data.size) continue;
-         assert(data.size > 0 && "FunctionType has no return type");
-         bool typesEqual = returnTy == data.array[0];
-         uint32_t i = 1;
-         types.for_each([&](Type* ty) {
-            if(data.array[i++] != ty) typesEqual = false;
-         });
-         if(typesEqual) return type;
-      }
-      // If not found, create a new FunctionType with types.
-      void* buf = ctx.alloc().allocate_bytes(sizeof(FunctionType),
-                                             alignof(FunctionType));
-      // Types are stored after the FunctionType object in memory.
-      void* buf2 =
-            ctx.alloc().allocate_bytes(size * sizeof(Type*), alignof(Type*));
-      auto* typesBuf = static_cast<Type**>(buf2);
-      // Copy the types into the buffer.
-      {
-         uint32_t i = 1;
-         typesBuf[0] = returnTy;
-         types.for_each([&](Type* ty) { typesBuf[i++] = ty; });
-      }
-      // Create the FunctionType object.
-      auto* type = new(buf) FunctionType{ctx, typesBuf, size};
-      ctx.pimpl().functionTypes.push_back(type);
-      return type;
+      // Search ctx for existing FunctionType with types.
+      auto& pimpl = ctx.pimpl();
+      return ctx.getOrCreateType(
+            pimpl.functionTypeSet,
+            pimpl.functionTypes,
+            TypeKey{0, returnTy, &types},
+            [&] {
+               // If not found, create a new FunctionType with types.
+               void* buf = ctx.alloc().allocate_bytes(sizeof(FunctionType),
+                                                      alignof(FunctionType));
+               // Types are stored after the FunctionType object in memory.
+               void* buf2 = ctx.alloc().allocate_bytes(size * sizeof(Type*),
+                                                       alignof(Type*));
+               auto* typesBuf = static_cast<Type**>(buf2);
+               // Copy the types into the buffer.
+               uint32_t i = 1;
+               typesBuf[0] = returnTy;
+               types.for_each([&](Type* ty) { typesBuf[i++] = ty; });
+               // Create the FunctionType object.
+               return new(buf) FunctionType{ctx, typesBuf, size};
+            });
    }
 
 public:
@@ -206,23 +208,22 @@ private:
 
 public:
    static ArrayType* get(Context& ctx, Type* elementType, uint32_t numElements) {
-      // First, search ctx for existing ArrayType with elementType and numElements.
-      for(auto* type : ctx.pimpl().arrayTypes) {
-         auto data = type->getChildTypes();
-         if(data.size == 1 && data.array[0] == elementType &&
-            type->getData() == numElements) {
-            return type;
-         }
-      }
-      // If not found, create a new ArrayType with elementType and numElements.
-      void* buf =
-            ctx.alloc().allocate_bytes(sizeof(ArrayType), alignof(ArrayType));
-      void* buf2 = ctx.alloc().allocate_bytes(sizeof(Type*), alignof(Type*));
-      auto* typeBuf = static_cast<Type**>(buf2);
-      typeBuf[0] = elementType;
-      auto* type = new(buf) ArrayType{ctx, typeBuf, numElements};
-      ctx.pimpl().arrayTypes.push_back(type);
-      return type;
+      // Search ctx for existing ArrayType with elementType and numElements.
+      auto& pimpl = ctx.pimpl();
+      return ctx.getOrCreateType(
+            pimpl.arrayTypeSet,
+            pimpl.arrayTypes,
+            TypeKey{numElements, elementType, nullptr},
+            [&] {
+               // If not found, create a new ArrayType.
+               void* buf = ctx.alloc().allocate_bytes(sizeof(ArrayType),
+                                                      alignof(ArrayType));
+               void* buf2 =
+                     ctx.alloc().allocate_bytes(sizeof(Type*), alignof(Type*));
+               auto* typeBuf = static_cast<Type**>(buf2);
+               typeBuf[0] = elementType;
+               return new(buf) ArrayType{ctx, typeBuf, numElements};
+            });
    }
 
 public:
@@ -255,31 +256,23 @@ public:
          assert((!ty->isArrayType() || cast<ArrayType>(ty)->isSizeBounded()) &&
                 "StructType element must be a bounded array type");
       });
-      // First, search ctx for existing StructType with elementTypes.
-      for(auto* type : ctx.pimpl().structTypes) {
-         auto data = type->getChildTypes();
-         if(data.size == size) {
-            bool typesEqual = true;
-            uint32_t i = 0;
-            elementTypes.for_each([&](Type* ty) {
-               if(data.array[i++] != ty) typesEqual = false;
+      // Search ctx for existing StructType with elementTypes.
+      auto& pimpl = ctx.pimpl();
+      return ctx.getOrCreateType(
+            pimpl.structTypeSet,
+            pimpl.structTypes,
+            TypeKey{size, nullptr, &elementTypes},
+            [&] {
+               // If not found, create a new StructType with elementTypes.
+               void* buf = ctx.alloc().allocate_bytes(sizeof(StructType),
+                                                      alignof(StructType));
+               void* buf2 = ctx.alloc().allocate_bytes(size * sizeof(Type*),
+                                                       alignof(Type*));
+               auto* typeBuf = static_cast<Type**>(buf2);
+               uint32_t i = 0;
+               elementTypes.for_each([&](Type* ty) { typeBuf[i++] = ty; });
+               return new(buf) StructType{ctx, typeBuf, size};
             });
-            if(typesEqual) return type;
-         }
-      }
-      // If not found, create a new StructType with elementTypes.
-      void* buf =
-            ctx.alloc().allocate_bytes(sizeof(StructType), alignof(StructType));
-      void* buf2 =
-            ctx.alloc().allocate_bytes(size * sizeof(Type*), alignof(Type*));
-      auto* typeBuf = static_cast<Type**>(buf2);
-      {
-         uint32_t i = 0;
-         elementTypes.for_each([&](Type* ty) { typeBuf[i++] = ty; });
-      }
-      auto* type = new(buf) StructType{ctx, typeBuf, size};
-      ctx.pimpl().structTypes.push_back(type);
-      return type;
    }
 
 public:
@@ -14,12 +14,14 @@ namespace tir {
 class Value;
 class User;
 
+/// @brief The local number of a block or instruction not yet numbered, see
+/// Function::numberValues()
+inline constexpr unsigned NoLocalNumber = ~0u;
+
 /**
  * @brief The base class for all values (i.e., nodes) in the TIR.
  */
 class Value : public utils::GraphNode<User> {
-   using UseEqual = utils::details::UseEqual<User>;
-
 public:
    Value(Context& ctx, Type* type)
          : utils::GraphNode<User>{ctx.alloc()},
@@ -39,6 +41,7 @@ public:
       return stringViewRet;
    }
    auto nameOpt() const { return name_.value(); }
+   bool hasName() const { return name_.has_value(); }
    void setName(std::string_view name) {
       name_ = std::pmr::string{name, ctx_.alloc()};
    }
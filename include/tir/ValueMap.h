@@ -0,0 +1,78 @@
+#pragma once
+
+#include <memory_resource>
+#include <type_traits>
+#include <vector>
+
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Instructions.h"
+
+namespace tir {
+
+namespace details {
+
+/**
+ * @brief A side table from the blocks or instructions of a function to T,
+ * backed by a vector indexed by their local numbers (see
+ * Function::numberValues). The entries not yet set hold a value-initialized
+ * T, so pick a T where that can mean "no entry" (i.e., nullptr).
+ *
+ * @tparam Key Either BasicBlock or Instruction
+ * @tparam T The type of the entries
+ */
+template <typename Key, typename T>
+class LocalNumberMap {
+   static_assert(std::is_same_v<Key, BasicBlock> ||
+                 std::is_same_v<Key, Instruction>);
+
+public:
+   explicit LocalNumberMap(
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+         : data_{resource} {}
+   explicit LocalNumberMap(
+         Function const* fn,
+         std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+         : data_{resource} {
+      reset(fn);
+   }
+   /// @brief Clears the map and sizes it for the (numbered) function fn
+   void reset(Function const* fn) {
+      fn->numberValues();
+      data_.clear();
+      if constexpr(std::is_same_v<Key, BasicBlock>)
+         data_.resize(fn->numBlockNumbers());
+      else
+         data_.resize(fn->numInstNumbers());
+   }
+   /// @brief Gets the entry of key, growing the map if key was numbered
+   /// after the map was sized
+   T& operator[](Key const* key) {
+      auto idx = key->localNumber();
+      assert(idx != NoLocalNumber && "Value is not numbered");
+      if(idx >= data_.size()) data_.resize(idx + 1);
+      return data_[idx];
+   }
+   /// @brief Gets the entry of key, or a value-initialized T if not set
+   T const& lookup(Key const* key) const {
+      static T const empty{};
+      auto idx = key->localNumber();
+      return idx < data_.size() ? data_[idx] : empty;
+   }
+   void clear() { data_.clear(); }
+
+private:
+   std::pmr::vector<T> data_;
+};
+
+} // namespace details
+
+/// @brief Maps the instructions of a function to T, see LocalNumberMap
+template <typename T>
+using ValueMap = details::LocalNumberMap<Instruction, T>;
+
+/// @brief Maps the basic blocks of a function to T, see LocalNumberMap
+template <typename T>
+using BlockMap = details::LocalNumberMap<BasicBlock, T>;
+
+} // namespace tir
@@ -1,26 +1,67 @@
 #pragma once
 
+#include <array>
 #include <cstring>
+#include <memory>
 #include <memory_resource>
+#include <mutex>
+#include <vector>
 
 using BumpAllocator = std::pmr::polymorphic_allocator<std::byte>;
 
 namespace utils {
 
+/**
+ * @brief An arena (bump pointer) memory resource. Memory is carved out of
+ * chunks that grow geometrically up to a cap, and is only freed all at once
+ * by reset() or when the resource is destroyed. Allocations too large for a
+ * chunk get their own buffer on the large object list instead.
+ *
+ * In concurrent mode, each thread pool worker allocates out of its own
+ * sub-arena, so a parallel pass can share one resource between the workers
+ * without locking. Any other thread allocates out of the main sub-arena,
+ * which is then locked.
+ */
 class CustomBufferResource : public std::pmr::memory_resource {
 public:
-   CustomBufferResource() : CustomBufferResource{128 * sizeof(void*)} {}
-   CustomBufferResource(size_t size);
+   struct Options {
+      /// @brief Size of the first chunk (of each sub-arena)
+      size_t initial_size = 128 * sizeof(void*);
+      /// @brief Each new chunk is this many times larger than the last one
+      float growth_factor = 1.5;
+      /// @brief Chunks do not grow past this size. Allocations of more than a
+      /// quarter of it go on the large object list.
+      size_t max_chunk_size = 1024 * 1024;
+      /// @brief Back the buffers of 2 MiB or more with transparent huge pages
+      bool huge_pages = false;
+      /// @brief Allocate out of per-worker sub-arenas
+      bool concurrent = false;
+   };
+
+   /// @brief The byte and chunk counts of the resource
+   struct Stats {
+      /// @brief Bytes allocated since the last reset()
+      size_t bytes_in_use = 0;
+      /// @brief Bytes allocated over the lifetime of the resource
+      size_t bytes_allocated = 0;
+      /// @brief Bytes of buffer space reserved from the system
+      size_t bytes_reserved = 0;
+      size_t num_chunks = 0;
+      size_t num_large_objects = 0;
+      size_t large_object_bytes = 0;
+   };
+
+   CustomBufferResource() : CustomBufferResource{Options{}} {}
+   CustomBufferResource(size_t size)
+         : CustomBufferResource{Options{.initial_size = size}} {}
+   explicit CustomBufferResource(Options const& options);
+   CustomBufferResource(CustomBufferResource const&) = delete;
+   CustomBufferResource& operator=(CustomBufferResource const&) = delete;
 
    void* do_allocate(std::size_t bytes, std::size_t alignment) override;
 
-   inline void reset() {
-      alloc_top_ = 0;
-      cur_buf_ = buffers_.begin();
-#ifdef DEBUG
-      clear_all_buffers();
-#endif
-   }
+   /// @brief Frees all allocations at once, keeping the chunks for reuse
+   void reset();
 
    void destroy() {
       invalid = true;
@@ -29,6 +70,31 @@ public:
 
    void clear_all_buffers();
 
+   /**
+    * @brief Resets the resource and returns its memory to the system. The
+    * pages of the buffers are released with madvise(MADV_DONTNEED), so they
+    * read back as zeros the next time they are touched. The buffers past the
+    * first keep bytes are then freed (the first buffer is always kept).
+    *
+    * @param keep The number of bytes of buffers to keep (per sub-arena)
+    * @return size_t The number of bytes released
+    */
+   size_t release(size_t keep = 0);
+
+   /// @brief Turns concurrent mode on or off, see Options::concurrent. Must
+   /// not be called while allocating.
+   void set_concurrent(bool concurrent) { options_.concurrent = concurrent; }
+
+   /// @brief Gets the byte and chunk counts, must not be called while
+   /// allocating concurrently
+   Stats stats() const;
+   /// @brief Bytes allocated since the last reset()
+   size_t bytes_in_use() const { return stats().bytes_in_use; }
+   /// @brief Bytes allocated over the lifetime of the resource
+   size_t bytes_allocated() const { return stats().bytes_allocated; }
+   /// @brief Bytes of buffer space reserved from the system
+   size_t bytes_reserved() const { return stats().bytes_reserved; }
+
    ~CustomBufferResource();
 
    void do_deallocate(void* p, std::size_t bytes, std::size_t alignment) override {
@@ -46,15 +112,42 @@ public:
    }
 
 private:
-   static constexpr float growth_factor = 1.5;
    struct Buffer {
       size_t size;
       void* buf;
+      // Was the buffer mapped with mmap() instead of malloc()?
+      bool mapped;
+   };
+   struct Arena {
+      std::vector<Buffer> chunks;
+      size_t cur = 0;      // Index of the chunk we allocate out of
+      void* top = nullptr; // Next free byte of the current chunk
+      size_t avail = 0;    // Bytes left in the current chunk
+      size_t in_use = 0;
+      size_t allocated = 0;
+      size_t reserved = 0;
    };
-   void* alloc_top_;
-   size_t avail_;
-   std::vector<Buffer>::iterator cur_buf_;
-   std::vector<Buffer> buffers_;
+   // The sub-arena of worker i is i + 1, the last is shared (and locked) by
+   // the workers that do not get one
+   static constexpr int MaxArenas = 64;
+
+   std::unique_ptr<Arena> new_arena();
+   void* allocate_from(Arena& arena, size_t bytes, size_t alignment);
+   void* allocate_large(size_t bytes, size_t alignment);
+   void reset_arena(Arena& arena);
+   Buffer new_buffer(size_t size);
+   static void free_buffer(Buffer const& buf);
+
+private:
+   Options options_;
+   std::array<std::unique_ptr<Arena>, MaxArenas> arenas_;
+   // Guards the large objects
+   mutable std::mutex lock_;
+   // Guards the main and the shared sub-arenas in concurrent mode
+   std::mutex arena_lock_;
+   std::vector<Buffer> large_;
+   size_t large_in_use_ = 0;
+   size_t large_allocated_ = 0;
    bool invalid = false;
 };
 
@@ -3,10 +3,28 @@
 #pragma once
 
 #include <coroutine>
+#include <cstddef>
+#include <memory>
+#include <memory_resource>
 #include <optional>
 
 namespace utils {
 
+namespace detail {
+
+/**
+ * @brief Allocates a coroutine frame of the given size. Frames come from the
+ * given memory resource if not null. Otherwise, small frames are recycled
+ * through a per-thread free list for each size class, as generators are
+ * created and destroyed at a high rate (i.e., one per AST children() call).
+ */
+void* AllocateFrame(std::size_t size, std::pmr::memory_resource* resource);
+
+/// @brief Frees a frame allocated by AllocateFrame (on any thread)
+void DeallocateFrame(void* frame, std::size_t size) noexcept;
+
+} // namespace detail
+
 template <std::movable T>
 class Generator {
 public:
@@ -24,6 +42,27 @@ public:
       void await_transform() = delete;
       [[noreturn]] static void unhandled_exception() { throw; }
 
+      // The frame is allocated by detail::AllocateFrame. A coroutine whose
+      // first parameters (after the object, for a member function) are
+      // (std::allocator_arg_t, std::pmr::memory_resource*) gets its frame
+      // from that resource instead.
+      static void* operator new(std::size_t size) {
+         return detail::AllocateFrame(size, nullptr);
+      }
+      template <typename... Args>
+      static void* operator new(std::size_t size, std::allocator_arg_t,
+                                std::pmr::memory_resource* resource, Args&&...) {
+         return detail::AllocateFrame(size, resource);
+      }
+      template <typename Class, typename... Args>
+      static void* operator new(std::size_t size, Class&, std::allocator_arg_t,
+                                std::pmr::memory_resource* resource, Args&&...) {
+         return detail::AllocateFrame(size, resource);
+      }
+      static void operator delete(void* frame, std::size_t size) noexcept {
+         detail::DeallocateFrame(frame, size);
+      }
+
       std::optional<T> current_value;
    };
 
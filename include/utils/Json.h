@@ -0,0 +1,24 @@
+#pragma once
+
+#include <iomanip>
+#include <ostream>
+#include <string_view>
+
+namespace utils {
+
+/// @brief Prints str as a quoted and escaped JSON string
+inline void PrintJsonString(std::ostream& os, std::string_view str) {
+   os << '"';
+   for(char c : str) {
+      if(c == '"' || c == '\\')
+         os << '\\' << c;
+      else if(static_cast<unsigned char>(c) < 0x20)
+         os << "\\u" << std::hex << std::setw(4) << std::setfill('0')
+            << static_cast<int>(c) << std::dec << std::setfill(' ');
+      else
+         os << c;
+   }
+   os << '"';
+}
+
+} // namespace utils
@@ -1,8 +1,16 @@
 #pragma once
 
+#include <array>
+#include <chrono>
+#include <deque>
+#include <iosfwd>
+#include <map>
 #include <memory>
+#include <mutex>
+#include <string>
 #include <string_view>
 #include <type_traits>
+#include <typeindex>
 #include <unordered_map>
 #include <vector>
 
@@ -11,6 +19,8 @@
 #include "utils/BumpAllocator.h"
 #include "utils/Error.h"
 #include "utils/Generator.h"
+#include "utils/PerfCounters.h"
+#include "utils/ThreadPool.h"
 #include "utils/Utils.h"
 
 namespace utils {
@@ -26,6 +36,23 @@ concept PassType = std::is_base_of_v<Pass, T>;
 template <typename T>
 concept DispatchType = std::is_base_of_v<PassDispatcher, T>;
 
+/// @brief The format of the pass timing report (--time-passes)
+enum class TimePassesFormat { None, Text, Json };
+
+/// @brief Timing and memory statistics accumulated over all runs of a pass.
+/// Only collected when pass timing or perf counters are enabled on the pass
+/// manager.
+struct PassStatistics {
+   std::chrono::nanoseconds wallTime{0};
+   std::chrono::nanoseconds cpuTime{0};
+   /// @brief The number of times the pass ran (i.e., dispatcher iterations)
+   unsigned iterations = 0;
+   /// @brief Bytes allocated from the pass manager heaps while the pass ran
+   size_t bytesAllocated = 0;
+   /// @brief Hardware event counts, if perf counters are enabled
+   PerfCounts perf;
+};
+
 /* ===--------------------------------------------------------------------=== */
 // Pass
 /* ===--------------------------------------------------------------------=== */
@@ -55,6 +82,20 @@ public:
    bool ShouldPreserve() const { return preserve; }
    /// @brief Garbage collect any persistent resources. This is a FIXME(kevin)!
    virtual void GC() {};
+   /// @brief Returns true if GC() may also be called while the pass is valid,
+   /// when the memory budget is exceeded. The pass must then recompute what
+   /// it freed on demand (i.e., cached analysis results).
+   virtual bool CanGCEarly() const { return false; }
+   /**
+    * @brief Returns true if the pass may run at the same time as the other
+    * passes (see PassManager::SetSerialPasses). The pass must then only write
+    * to its own state and heaps, and only read the results of its
+    * dependencies. Passes that return false never run at the same time as
+    * each other.
+    */
+   virtual bool IsConcurrentSafe() const { return false; }
+   /// @brief The statistics collected for this pass, see PassStatistics
+   PassStatistics const& Stats() const { return stats_; }
 
 public:
    enum class Lifetime { Managed, Temporary, TemporaryNoReuse };
@@ -73,7 +114,8 @@ protected:
    /// @brief Gets a single pass by name. Throws if no pass is found.
    Pass& GetPass(std::string_view name);
 
-   /// @brief Gets all passes of type T. Throws if no pass is found.
+   /// @brief Gets all passes of type T, if any (e.g., there are no AstBuilder
+   /// passes when the TIR is loaded from bitcode instead).
    /// @tparam T The type of the pass
    /// @return A generator that yields all passes of type T
    template <PassType T>
@@ -92,7 +134,10 @@ protected:
    CustomBufferResource* NewHeap(Lifetime lifetime);
 
    /**
-    * @brief Obtains a new bump allocator given the lifetime
+    * @brief Obtains a new bump allocator given the lifetime. When called on a
+    * thread pool worker, the workers share one heap per lifetime (in
+    * concurrent mode, so each worker allocates out of its own sub-arena) until
+    * the pass finishes running.
     *
     * @param lifetime The lifetime of the bump allocator
     * @return BumpAllocator& The bump allocator
@@ -105,6 +150,12 @@ protected:
       return cast<T>(dispatcher);
    }
 
+   /// @brief Gets the dispatcher if it is of type T, nullptr otherwise
+   template <DispatchType T>
+   T* GetDispatcherIf() {
+      return dyn_cast<T>(dispatcher);
+   }
+
 protected:
    friend class PassManager;
    /// @brief Overload to state the dependencies of this pass
@@ -127,7 +178,12 @@ private:
    bool enabled = false;
    int topoIdx = -1;
    PassDispatcher* dispatcher = nullptr;
-   std::vector<BumpAllocator> allocs_;
+   // A deque, as allocators are handed out by reference
+   std::deque<BumpAllocator> allocs_;
+   // The allocator shared by the workers, per lifetime, while running in
+   // parallel (see NewAlloc)
+   std::map<Lifetime, BumpAllocator*> workerAllocs_;
+   PassStatistics stats_;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -139,6 +195,13 @@ public:
    virtual ~PassDispatcher() = default;
    virtual std::string_view Name() = 0;
    virtual bool CanDispatch(Pass& pass) = 0;
+   /**
+    * @brief Iterates over the items (e.g., functions) to run the chunk on.
+    * The passes run on an item once the iteration has moved past it, i.e.,
+    * at the next yield or at the end of the iteration, so that the pass
+    * manager knows which item is the last one. Hence, a dispatcher of
+    * several items must yield before it moves to each one, not after.
+    */
    virtual Generator<void*> Iterate(PassManager&) = 0;
 };
 
@@ -174,6 +237,43 @@ public:
    Pass const* LastRun() const { return lastRun_; }
    /// @brief Sets whether the pass manager should reuse heaps
    void SetHeapReuse(bool reuse) { reuseHeaps_ = reuse; }
+   /// @brief Sets the number of bytes of free heaps kept around for reuse.
+   /// Past this, the memory of the heaps freed is returned to the system.
+   void SetHeapRetainLimit(size_t bytes) { heapRetainLimit_ = bytes; }
+   /**
+    * @brief Sets a soft limit on the resident memory of the process (0 for no
+    * limit). When exceeded after a pass, the memory of all free heaps is
+    * returned to the system, and then the passes that can (see
+    * Pass::CanGCEarly) are garbage collected.
+    */
+   void SetMemoryBudget(size_t bytes) { memoryBudget_ = bytes; }
+   /// @brief Enables pass timing. The report is printed to stderr when the
+   /// pass manager is destroyed, see PrintTimingReport().
+   void SetTimePasses(TimePassesFormat format) { timePasses_ = format; }
+   /// @brief Prints the pass timing report, sorted by wall time
+   void PrintTimingReport(std::ostream& os) const;
+   /// @brief Enables counting hardware events per pass (see PerfCounterGroup).
+   /// The report is printed to stderr when the pass manager is destroyed.
+   /// @return False if the counters are unavailable, then nothing is counted
+   bool EnablePerfCounters();
+   /// @brief Prints the hardware event counts of each pass, sorted by cycles
+   void PrintPerfCounterReport(std::ostream& os) const;
+   /// @brief Sets the number of threads passes may run on. Dispatchers that
+   /// run passes in parallel only accept passes if this is more than 1.
+   /// Must be called before Init().
+   void SetNumThreads(unsigned numThreads);
+   /// @brief The number of threads passes may run on
+   unsigned NumThreads() const { return pool_ ? pool_->NumThreads() : 1; }
+   /// @brief Gets the thread pool, only valid if NumThreads() > 1
+   ThreadPool& Pool() { return *pool_; }
+   /**
+    * @brief Runs the passes one at a time in topological order, even with
+    * more than one thread. Otherwise, the independent passes of the default
+    * dispatcher run on the thread pool as soon as their dependencies are
+    * done (see Pass::IsConcurrentSafe). Either way, the passes report the
+    * same diagnostics in the same order.
+    */
+   void SetSerialPasses(bool serial) { serialPasses_ = serial; }
    /// @brief Adds a pass to the pass manager
    /// @tparam T The type of the pass
    /// @param ...args The remaining arguments to pass to the pass constructor.
@@ -195,8 +295,7 @@ public:
    T& FindPass();
    /// @brief Gets a single pass by name. Throws if no pass is found.
    Pass& FindPass(std::string_view name) {
-      for(auto& pass : passes_)
-         if(!pass->Name().empty() && pass->Name() == name) return *pass;
+      if(auto* pass = findPassByName(name)) return *pass;
       throw FatalError("Pass not found: " + std::string{name});
    }
    /// @brief
@@ -215,9 +314,7 @@ public:
    }
    /// @returns True if the pass manager has a pass with the given name
    bool HasPass(std::string_view name) {
-      for(auto& pass : passes_)
-         if(!pass->Name().empty() && pass->Name() == name) return true;
-      return false;
+      return findPassByName(name) != nullptr;
    }
 
 private:
@@ -230,12 +327,27 @@ private:
    // Internal function to get all passes of a type
    template <PassType T>
    Generator<T*> getPasses(Pass& pass);
+   // Gets the (memoized) list of passes that are a T, in pass order
+   template <PassType T>
+   std::vector<Pass*> const& passesOfType();
+   // Gets the first pass with the given (non-empty) name, or nullptr
+   Pass* findPassByName(std::string_view name) const;
 
 private:
    void runPassLifeCycle(Pass& pass, int left, int right, bool lastIter);
+   bool canRunChunkParallel(Chunk const& chunk) const;
+   bool runChunkParallel(int left, int right);
+   void runPassTimed(Pass& pass);
    void addDependency(Pass& pass, Pass& depends);
    void validate() const;
-   HeapResource& findHeapFor(Pass* pass, Pass::Lifetime);
+   HeapResource& findHeapFor(Pass* pass, Pass::Lifetime,
+                             bool exclusive = false);
+   void setHeapOwner(HeapResource& heap, Pass* owner);
+   void releaseHeap(HeapResource& heap);
+   void pushFreeHeap(HeapResource& heap, bool trim = true);
+   HeapResource* popFreeHeap(size_t sizeHint);
+   void takeHeap(HeapResource& heap);
+   void enforceMemoryBudget(bool collectPasses = true);
 
 private:
    enum class State {
@@ -256,6 +368,11 @@ private:
       Pass* owner = nullptr;
       Pass::Lifetime lifetime = Pass::Lifetime::Managed;
       unsigned refcount = 0;
+      // Is the heap on the free lists? If so, on freeHeaps_[freeClass]
+      bool idle = false;
+      unsigned freeClass = 0;
+      // Was the heap freed by Reset()? Then its memory may still be read from
+      bool pinned = false;
       std::unique_ptr<T> resource{nullptr};
       HeapResource(std::unique_ptr<T>&& resource)
             : resource{std::move(resource)} {}
@@ -270,10 +387,39 @@ private:
    std::vector<std::unique_ptr<Pass>> passes_;
    std::vector<Chunk> passChunks_;
    std::vector<std::unique_ptr<PassDispatcher>> dispatchers_;
-   std::vector<HeapResource> heaps_;
+   // A deque, as the heaps are referred to by pointer
+   std::deque<HeapResource> heaps_;
+   // The heaps owned by each pass
+   std::unordered_map<Pass const*, std::vector<HeapResource*>> ownedHeaps_;
+   // Heaps that were freed (refcount 0), by log2 of their reserved bytes
+   static constexpr unsigned NumHeapClasses = 48;
+   std::array<std::vector<HeapResource*>, NumHeapClasses> freeHeaps_;
+   // Bytes reserved by the idle heaps
+   size_t idleHeapBytes_ = 0;
+   size_t heapRetainLimit_ = 64 * 1024 * 1024;
+   size_t memoryBudget_ = 0;
+   // Most bytes used by a heap of each pass, to pick a heap of the right size
+   std::unordered_map<Pass const*, size_t> heapSizeHints_;
+   // Passes that may be garbage collected while valid
+   std::vector<Pass*> earlyGCPasses_;
+   // Passes indexed by name and (lazily) by the type requested
+   std::unordered_map<std::string_view, Pass*> passesByName_;
+   std::unordered_map<std::type_index, std::vector<Pass*>> passesByType_;
+   std::mutex passesByTypeLock_;
    diagnostics::DiagnosticEngine diag_;
    Pass* lastRun_ = nullptr;
    bool reuseHeaps_;
+   bool serialPasses_ = false;
+   // How many places (per thread) a pass may start ahead of the earliest
+   // unfinished pass in a parallel chunk, see runChunkParallel
+   static constexpr int RunAheadPerThread = 4;
+   TimePassesFormat timePasses_ = TimePassesFormat::None;
+   // Largest number of bytes in use across the heaps after a pass ran
+   size_t heapPeakInUse_ = 0;
+   std::unique_ptr<PerfCounterGroup> perfCounters_;
+   std::unique_ptr<ThreadPool> pool_;
+   // Guards the heaps while passes run on the thread pool
+   std::mutex heapLock_;
    State state_ = State::Uninitialized;
    std::unordered_map<Pass*, GraphEdge> depGraph_;
 };
@@ -302,6 +448,9 @@ T& PassManager::AddPass(Args&&... args) {
    using namespace std;
    passes_.emplace_back(make_unique<T>(*this, std::forward<Args>(args)...));
    T& result = *cast<T*>(passes_.back().get());
+   // Index the pass, the first pass registered with a name wins
+   if(!result.Name().empty()) passesByName_.try_emplace(result.Name(), &result);
+   passesByType_.clear();
    return result;
 }
 
@@ -312,19 +461,25 @@ void PassManager::AddDispatcher(Args&&... args) {
 }
 
 template <PassType T>
-T& PassManager::getPass(bool checkInit) {
-   T* result = nullptr;
-   for(auto& pass : passes_) {
-      if(auto* p = dyn_cast<T*>(pass.get())) {
-         if(result != nullptr)
-            throw FatalError("Multiple passes of type: " +
-                             std::string(typeid(T).name()));
-         result = p;
-      }
+std::vector<Pass*> const& PassManager::passesOfType() {
+   std::lock_guard guard{passesByTypeLock_};
+   auto [it, inserted] = passesByType_.try_emplace(std::type_index{typeid(T)});
+   if(inserted) {
+      for(auto& pass : passes_)
+         if(dyn_cast<T*>(pass.get())) it->second.push_back(pass.get());
    }
-   if(result == nullptr) {
+   return it->second;
+}
+
+template <PassType T>
+T& PassManager::getPass(bool checkInit) {
+   auto const& passes = passesOfType<T>();
+   if(passes.size() > 1)
+      throw FatalError("Multiple passes of type: " + std::string(typeid(T).name()));
+   if(passes.empty()) {
       throw FatalError("Pass not found: " + std::string(typeid(T).name()));
    }
+   T* result = cast<T*>(passes.front());
    // FIXME(kevin): This check needs to be fixed
    if(checkInit && result->state == Pass::State::Running) {
       throw FatalError("Cannot use FindPass() while a pass is running");
@@ -344,19 +499,14 @@ T& PassManager::getPass(Pass& pass) {
 
 template <PassType T>
 Generator<T*> PassManager::getPasses(Pass&) {
-   bool found = false;
-   for(auto& pass : passes_) {
-      if(auto* p = dyn_cast<T*>(pass.get())) {
-         // If the requester is running, the result must be valid
-         if(p->state == Pass::State::Running && p->state != Pass::State::Valid) {
-            throw FatalError("Pass not valid: " + std::string(typeid(T).name()));
-         }
-         co_yield p;
-         found = true;
+   for(auto* pass : passesOfType<T>()) {
+      auto* p = cast<T*>(pass);
+      // If the requester is running, the result must be valid
+      if(p->state == Pass::State::Running && p->state != Pass::State::Valid) {
+         throw FatalError("Pass not valid: " + std::string(typeid(T).name()));
       }
+      co_yield p;
    }
-   if(!found)
-      throw FatalError("Pass of type not found: " + std::string(typeid(T).name()));
 }
 
 /* ===--------------------------------------------------------------------=== */
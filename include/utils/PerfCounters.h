@@ -0,0 +1,74 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+
+namespace utils {
+
+/// @brief The hardware events counted by PerfCounterGroup
+enum class PerfEvent {
+   Cycles,
+   Instructions,
+   L1DMisses,
+   LLCMisses,
+   BranchMisses,
+   Count
+};
+
+/// @brief Gets the short name of the hardware event, i.e., "cycles"
+std::string_view PerfEventName(PerfEvent event);
+
+/// @brief Hardware event counts, indexed by PerfEvent
+struct PerfCounts {
+   std::array<uint64_t, static_cast<size_t>(PerfEvent::Count)> values{};
+
+   uint64_t& operator[](PerfEvent e) { return values[static_cast<size_t>(e)]; }
+   uint64_t operator[](PerfEvent e) const {
+      return values[static_cast<size_t>(e)];
+   }
+   PerfCounts& operator+=(PerfCounts const& other) {
+      for(size_t i = 0; i < values.size(); i++) values[i] += other.values[i];
+      return *this;
+   }
+};
+
+/**
+ * @brief A group of hardware performance counters (see perf_event_open(2))
+ * counting the user-space events of the calling thread. The counters run
+ * freely once opened: take a Read() before and after a region and subtract.
+ * Counts are scaled if the kernel had to multiplex the counters.
+ *
+ * Opening fails gracefully (i.e., not on Linux, in a container, or with
+ * perf_event_paranoid too high), in which case nothing is counted. Events the
+ * CPU does not support are reported as unavailable and read as zero.
+ */
+class PerfCounterGroup final {
+public:
+   PerfCounterGroup() = default;
+   PerfCounterGroup(PerfCounterGroup const&) = delete;
+   PerfCounterGroup& operator=(PerfCounterGroup const&) = delete;
+   ~PerfCounterGroup();
+
+   /// @brief Opens and starts the counters on the calling thread
+   /// @return True if at least the cycle counter could be opened
+   bool Open();
+   /// @brief Returns true if the counter group is open
+   bool IsOpen() const { return fds_[0] != -1; }
+   /// @brief Returns true if the event is being counted
+   bool IsAvailable(PerfEvent event) const {
+      return fds_[static_cast<size_t>(event)] != -1;
+   }
+   /// @brief Reads the (scaled) running totals of the counters
+   PerfCounts Read() const;
+
+private:
+   static constexpr size_t NumEvents = static_cast<size_t>(PerfEvent::Count);
+   // The file descriptor of each event, or -1 if it is not being counted
+   std::array<int, NumEvents> fds_{-1, -1, -1, -1, -1};
+   // The index of each event in the group read buffer, or -1
+   std::array<int, NumEvents> slot_{-1, -1, -1, -1, -1};
+   int numOpen_ = 0;
+};
+
+} // namespace utils
@@ -0,0 +1,152 @@
+#pragma once
+
+#include <algorithm>
+#include <memory_resource>
+#include <span>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+#include "utils/Assert.h"
+#include "utils/Generator.h"
+
+namespace utils {
+
+/**
+ * @brief A persistent, structurally shared table of pointers. A table is
+ * represented as a (possibly null) parent table plus a delta: a sorted list
+ * of slots overridden from the parent and a list of slots appended after
+ * the parent's slots. Slot numbers are therefore stable down the chain of
+ * tables, i.e., slot i of a parent is slot i of all of its children.
+ *
+ * A nullptr entry is a tombstone: the slot exists but iteration skips it.
+ *
+ * The parent must be complete (i.e., never modified again) before a child
+ * table is derived from it, so tables are built in topological order.
+ *
+ * Lookups resolve through the delta chain until the table is flattened,
+ * after which they are O(1). A table should be flattened once it is
+ * complete, and a table with an empty delta shares the flattened storage of
+ * its parent.
+ *
+ * @tparam T The pointer type stored in the table
+ */
+template <typename T>
+   requires std::is_pointer_v<T>
+class PersistentTable final {
+public:
+   explicit PersistentTable(PersistentTable const* parent = nullptr,
+                            std::pmr::memory_resource* mr =
+                                  std::pmr::get_default_resource())
+         : parent_{parent},
+           base_{parent ? parent->size() : 0},
+           overrides_{mr},
+           appended_{mr},
+           flat_{mr} {}
+
+   PersistentTable(PersistentTable const&) = delete;
+   PersistentTable& operator=(PersistentTable const&) = delete;
+   PersistentTable(PersistentTable&&) = delete;
+   PersistentTable& operator=(PersistentTable&&) = delete;
+
+public:
+   /// @brief The table this table was derived from, or nullptr
+   PersistentTable const* parent() const { return parent_; }
+   /// @brief The total number of slots, including tombstones
+   size_t size() const { return base_ + appended_.size(); }
+   /// @brief Returns true if this table does not change its parent
+   bool isDeltaEmpty() const { return overrides_.empty() && appended_.empty(); }
+
+   /// @brief Gets the entry at the given slot (may be a tombstone)
+   T at(size_t slot) const {
+      assert(slot < size() && "Slot out of range");
+      if(flattened_) return flatRef()[slot];
+      for(auto* t = this; t; t = t->parent_) {
+         if(t->flattened_) return t->flatRef()[slot];
+         if(slot >= t->base_) return t->appended_[slot - t->base_];
+         if(auto* e = t->findOverride(slot)) return e->second;
+      }
+      std::unreachable();
+   }
+
+   /// @brief Replaces the parent's entry at the given slot in this table
+   void override(size_t slot, T value) {
+      assert(!flattened_ && "Cannot modify a flattened table");
+      if(slot >= base_) {
+         appended_[slot - base_] = value;
+         return;
+      }
+      auto it = std::lower_bound(
+            overrides_.begin(), overrides_.end(), slot, [](auto const& e, size_t s) {
+               return e.first < s;
+            });
+      if(it != overrides_.end() && it->first == slot)
+         it->second = value;
+      else
+         overrides_.emplace(it, slot, value);
+   }
+
+   /// @brief Appends a new slot to this table and returns its index
+   size_t append(T value) {
+      assert(!flattened_ && "Cannot modify a flattened table");
+      appended_.push_back(value);
+      return size() - 1;
+   }
+
+   /// @brief Iterates the live (non-tombstone) entries in slot order
+   Generator<T> entries() const {
+      if(flattened_) {
+         for(auto value : flatRef())
+            if(value) co_yield value;
+      } else {
+         for(size_t i = 0; i < size(); i++)
+            if(auto value = at(i)) co_yield value;
+      }
+   }
+
+   /// @brief Flattens the table (and its ancestors) so lookups become O(1)
+   /// @return A view over all the slots, including tombstones
+   std::span<T const> flatten() const {
+      if(flattened_) return flatRef();
+      if(parent_) parent_->flatten();
+      if(parent_ && isDeltaEmpty()) {
+         shared_ = parent_;
+      } else {
+         flat_.reserve(size());
+         if(parent_) {
+            auto parentFlat = parent_->flatRef();
+            flat_.assign(parentFlat.begin(), parentFlat.end());
+         }
+         for(auto [slot, value] : overrides_) flat_[slot] = value;
+         flat_.insert(flat_.end(), appended_.begin(), appended_.end());
+      }
+      flattened_ = true;
+      return flatRef();
+   }
+
+private:
+   std::pair<size_t, T> const* findOverride(size_t slot) const {
+      auto it = std::lower_bound(
+            overrides_.begin(), overrides_.end(), slot, [](auto const& e, size_t s) {
+               return e.first < s;
+            });
+      if(it != overrides_.end() && it->first == slot) return &*it;
+      return nullptr;
+   }
+
+   std::span<T const> flatRef() const {
+      return shared_ ? shared_->flatRef() : std::span<T const>{flat_};
+   }
+
+private:
+   PersistentTable const* parent_;
+   size_t base_;
+   std::pmr::vector<std::pair<size_t, T>> overrides_;
+   std::pmr::vector<T> appended_;
+   // The flattened slots, or the table whose flattened slots are shared
+   mutable std::pmr::vector<T> flat_;
+   mutable PersistentTable const* shared_ = nullptr;
+   mutable bool flattened_ = false;
+};
+
+} // namespace utils
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <string_view>
+
+namespace utils {
+
+/**
+ * @brief A named, thread-safe event counter belonging to a group (usually the
+ * name of the pass that owns it). Counters are registered when constructed
+ * and are only incremented while statistics are enabled (see --stats).
+ * Declare counters with static storage duration using the STATISTIC macro.
+ */
+class Statistic final {
+public:
+   Statistic(std::string_view group, std::string_view name,
+             std::string_view desc);
+   Statistic(Statistic const&) = delete;
+   Statistic& operator=(Statistic const&) = delete;
+
+   Statistic& operator++() { return *this += 1; }
+   Statistic& operator+=(uint64_t n) {
+      if(Enabled()) value_.fetch_add(n, std::memory_order_relaxed);
+      return *this;
+   }
+   uint64_t value() const { return value_.load(std::memory_order_relaxed); }
+   std::string_view group() const { return group_; }
+   std::string_view name() const { return name_; }
+   std::string_view desc() const { return desc_; }
+
+   /// @brief Returns true if statistics are being collected
+   static bool Enabled() { return enabled_.load(std::memory_order_relaxed); }
+   /// @brief Enables or disables collecting statistics
+   static void SetEnabled(bool enabled) { enabled_ = enabled; }
+
+private:
+   struct NoRegister {};
+   friend Statistic& GetStatistic(std::string_view, std::string_view,
+                                  std::string_view);
+   Statistic(std::string_view group, std::string_view name,
+             std::string_view desc, NoRegister)
+         : group_{group}, name_{name}, desc_{desc} {}
+
+private:
+   std::string_view group_, name_, desc_;
+   std::atomic<uint64_t> value_{0};
+   static inline std::atomic<bool> enabled_{false};
+};
+
+/**
+ * @brief Gets (or creates) the counter with the given group and name, for
+ * counters whose names are only known at runtime. The strings are copied.
+ */
+Statistic& GetStatistic(std::string_view group, std::string_view name,
+                        std::string_view desc);
+
+/// @brief Prints all the non-zero counters, sorted by group and name
+void PrintStatistics(std::ostream& os);
+
+} // namespace utils
+
+/**
+ * @brief Declares a static counter VAR in the group GROUP with description
+ * DESC. The name of the counter is the name of the variable.
+ */
+#define STATISTIC(VAR, GROUP, DESC) \
+   static utils::Statistic VAR { GROUP, #VAR, DESC }
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace utils {
+
+/**
+ * @brief A fixed-size pool of worker threads with work stealing. Each worker
+ * owns a deque of tasks: it pops from the front of its own deque and, once it
+ * runs dry, steals from the back of the other workers' deques. This balances
+ * uneven tasks (i.e., functions of very different sizes) without a single
+ * contended queue.
+ */
+class ThreadPool final {
+public:
+   explicit ThreadPool(unsigned numThreads);
+   ThreadPool(ThreadPool const&) = delete;
+   ThreadPool& operator=(ThreadPool const&) = delete;
+   ~ThreadPool();
+
+   /// @brief The number of worker threads
+   unsigned NumThreads() const { return workers_.size(); }
+
+   /**
+    * @brief Runs fn(i) for every i in [0, n) on the workers and waits for all
+    * of them to finish. If any call throws, the first exception is rethrown
+    * on the calling thread once all tasks are done. Must not be called from
+    * a worker thread.
+    */
+   void ParallelFor(size_t n, std::function<void(size_t)> const& fn);
+
+   /// @brief The index of the calling worker, or -1 if not called on a worker
+   static int CurrentWorker();
+
+private:
+   struct Worker {
+      std::mutex lock;
+      std::deque<size_t> tasks;
+      std::thread thread;
+   };
+   void workerLoop(unsigned id);
+   bool popTask(unsigned id, size_t& task);
+
+private:
+   std::vector<std::unique_ptr<Worker>> workers_;
+   std::mutex lock_;
+   std::condition_variable wake_;
+   std::condition_variable done_;
+   std::function<void(size_t)> const* job_ = nullptr;
+   size_t generation_ = 0;
+   std::atomic<size_t> remaining_{0};
+   std::exception_ptr error_;
+   bool stop_ = false;
+};
+
+} // namespace utils
@@ -0,0 +1,65 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <string>
+#include <string_view>
+
+namespace utils::trace {
+
+/**
+ * @brief Starts recording trace events for the whole process. The events are
+ * written to the file at path in the Chrome trace-event format (readable by
+ * chrome://tracing and Perfetto) when Finish() is called or at exit.
+ *
+ * @param path The path of the JSON file to write
+ */
+void Start(std::string path);
+
+/// @brief Writes the recorded events and stops recording
+void Finish();
+
+namespace detail {
+extern std::atomic<bool> enabled;
+void RecordSpan(std::string_view name, std::string_view cat,
+                std::string_view detail, std::chrono::steady_clock::time_point start,
+                std::chrono::steady_clock::time_point end);
+void RecordInstant(std::string_view name, std::string_view cat,
+                   std::string_view detail);
+} // namespace detail
+
+/// @brief Returns true if trace events are being recorded
+inline bool Enabled() { return detail::enabled.load(std::memory_order_relaxed); }
+
+/**
+ * @brief Records a complete ("X") event spanning the lifetime of this object.
+ * The strings are copied only when the span ends, so they must outlive it.
+ * This is a no-op if tracing is disabled when the span is created.
+ */
+class Span final {
+public:
+   Span(std::string_view name, std::string_view cat, std::string_view detail = {})
+         : name_{name}, cat_{cat}, detail_{detail}, active_{Enabled()} {
+      if(active_) start_ = std::chrono::steady_clock::now();
+   }
+   Span(Span const&) = delete;
+   Span& operator=(Span const&) = delete;
+   ~Span() {
+      if(active_)
+         detail::RecordSpan(
+               name_, cat_, detail_, start_, std::chrono::steady_clock::now());
+   }
+
+private:
+   std::string_view name_, cat_, detail_;
+   std::chrono::steady_clock::time_point start_;
+   bool active_;
+};
+
+/// @brief Records an instant ("i") event, if tracing is enabled
+inline void Instant(std::string_view name, std::string_view cat,
+                    std::string_view detail = {}) {
+   if(Enabled()) detail::RecordInstant(name, cat, detail);
+}
+
+} // namespace utils::trace
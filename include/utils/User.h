@@ -1,14 +1,20 @@
 #pragma once
 
+#include <array>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <iterator>
+#include <mutex>
 #include <ranges>
-#include <unordered_set>
+#include <vector>
 
 #include "utils/Assert.h" // IWYU pragma: keep
 #include "utils/BumpAllocator.h"
 #include "utils/Generator.h"
 
 /* ===--------------------------------------------------------------------=== */
-// Use and hashing Use{}
+// Use
 /* ===--------------------------------------------------------------------=== */
 
 namespace utils {
@@ -19,37 +25,156 @@ class GraphNode;
 template <typename T>
 class GraphNodeUser;
 
+/**
+ * @brief Striped locks guarding the use lists of the graph nodes, so uses can
+ * be added and removed from several threads at once (i.e., by instructions of
+ * different functions using the same constant). A node is mapped to a lock by
+ * its address. Nothing is locked unless concurrent mode is on, see
+ * tir::Context::setConcurrent().
+ *
+ * Only the linking and unlinking of the uses is guarded: walking the uses of
+ * a node while other threads change them is still a race.
+ */
+class UseListLocks final {
+public:
+   /// @brief Turns concurrent mode on or off. Calls nest, so concurrent mode
+   /// stays on until every call turning it on is matched by one turning it off.
+   static void SetConcurrent(bool concurrent) {
+      concurrent_.fetch_add(concurrent ? 1 : -1, std::memory_order_relaxed);
+   }
+
+   /// @brief Locks the use list of node, if in concurrent mode
+   static std::unique_lock<std::mutex> Lock(void const* node) {
+      if(concurrent_.load(std::memory_order_relaxed) == 0) return {};
+      // Nodes are larger than 16 bytes, so the low bits tell little apart
+      auto index = (reinterpret_cast<uintptr_t>(node) >> 4) % NumLocks;
+      return std::unique_lock{locks_[index].lock};
+   }
+
+private:
+   static constexpr size_t NumLocks = 64;
+   // Padded to a cache line each, so neighbouring locks do not false-share
+   struct alignas(64) Stripe {
+      std::mutex lock;
+   };
+   static inline std::atomic<int> concurrent_ = 0;
+   static inline std::array<Stripe, NumLocks> locks_;
+};
+
 /**
  * @brief Defines a use of a graph node by another graph node. The user
- * of the node is of type T. The fromIndex is the index of the use of the
- * current node in the user's children vector.
+ * of the node is of type T. The uses are stored in the user's children
+ * vector, and the uses of a node are linked together in an intrusive doubly
+ * linked list, so adding and removing a use is O(1) and never allocates.
+ * The list is ordered from the most recently added use to the oldest one.
  *
  * @tparam T The type of the user class.
  */
 template <typename T>
-struct Use {
-   T* const user;
-   const unsigned fromIndex;
-};
+class Use {
+   friend class GraphNode<T>;
+   friend class GraphNodeUser<T>;
+   using Node = GraphNode<T>;
 
-namespace details {
-template <typename T>
-struct UseEqual {
-   bool operator()(const Use<T>& lhs, const Use<T>& rhs) const {
-      return lhs.user == rhs.user && lhs.fromIndex == rhs.fromIndex;
+public:
+   Use(Node* value, T* user) : value_{value}, user_{user} {}
+   // Copies are not linked into the list of the node, see GraphNodeUser
+   Use(Use const& other) noexcept : value_{other.value_}, user_{other.user_} {}
+   Use& operator=(Use const& other) noexcept {
+      assert(!prev_ && "cannot assign to a linked use");
+      value_ = other.value_;
+      user_ = other.user_;
+      return *this;
    }
-};
-} // namespace details
+   /// @brief The node being used
+   Node* get() const { return value_; }
+   /// @brief The user of the node
+   T* user() const { return user_; }
+   /// @brief The index of the use in the user's children vector
+   unsigned fromIndex() const {
+      auto const& children = static_cast<GraphNodeUser<T> const*>(user_)->children_;
+      return static_cast<unsigned>(this - children.data());
+   }
+   /// @brief The next use of the same node
+   Use* next() const { return next_; }
 
-} // namespace utils
+private:
+   void link() {
+      if(!value_) return;
+      auto guard = UseListLocks::Lock(value_);
+      next_ = value_->uses_.head;
+      if(next_) next_->prev_ = &next_;
+      prev_ = &value_->uses_.head;
+      value_->uses_.head = this;
+      value_->uses_.size++;
+   }
+   void unlink() {
+      if(!value_) return;
+      // The neighbouring uses may update prev_, so read it under the lock
+      auto guard = UseListLocks::Lock(value_);
+      if(!prev_) return;
+      *prev_ = next_;
+      if(next_) next_->prev_ = prev_;
+      next_ = nullptr;
+      prev_ = nullptr;
+      value_->uses_.size--;
+   }
+   void set(Node* value) {
+      unlink();
+      value_ = value;
+      link();
+   }
+
+private:
+   Node* value_;
+   T* user_;
+   Use* next_ = nullptr;
+   // Points to the next_ field of the previous use, or to the list head
+   Use** prev_ = nullptr;
+};
 
+/**
+ * @brief A view of the uses of a graph node, see GraphNode::uses()
+ */
 template <typename T>
-struct std::hash<utils::Use<T>> {
-   std::size_t operator()(const utils::Use<T>& use) const {
-      return std::hash<T*>{}(use.user) ^ std::hash<unsigned>{}(use.fromIndex);
-   }
+class UseList {
+public:
+   class Iter {
+   public:
+      using value_type = Use<T>;
+      using difference_type = std::ptrdiff_t;
+      Iter() = default;
+      explicit Iter(Use<T>* use) : use_{use} {}
+      Use<T> const& operator*() const { return *use_; }
+      Use<T> const* operator->() const { return use_; }
+      Iter& operator++() {
+         use_ = use_->next();
+         return *this;
+      }
+      Iter operator++(int) {
+         auto copy = *this;
+         ++*this;
+         return copy;
+      }
+      bool operator==(Iter const&) const = default;
+
+   private:
+      Use<T>* use_ = nullptr;
+   };
+
+   UseList(Use<T>* head, std::size_t size) : head_{head}, size_{size} {}
+   Iter begin() const { return Iter{head_}; }
+   Iter end() const { return Iter{}; }
+   std::size_t size() const { return size_; }
+   bool empty() const { return size_ == 0; }
+
+private:
+   Use<T>* head_;
+   std::size_t size_;
 };
 
+} // namespace utils
+
 /* ===--------------------------------------------------------------------=== */
 // GraphNode
 /* ===--------------------------------------------------------------------=== */
@@ -61,23 +186,36 @@ struct std::hash<utils::Use<T>> {
  */
 template <typename T>
 class utils::GraphNode {
+   friend class Use<T>;
+
 public:
-   GraphNode(BumpAllocator& alloc) : uses_{alloc} {}
+   GraphNode(BumpAllocator&) {}
    virtual ~GraphNode() = default;
-   void addUse(Use<T> use) { uses_.insert(use); }
-   void removeUse(Use<T> use) { uses_.erase(use); }
-   auto uses() const { return std::views::all(uses_); }
-   void replaceAllUsesWith(GraphNode* newValue);
+   auto uses() const { return UseList<T>{uses_.head, uses_.size}; }
+   virtual void replaceAllUsesWith(GraphNode* newValue);
+   // The next use is fetched before yielding, so the current use may be
+   // removed while iterating
    utils::Generator<T*> users() {
-      for(auto user : uses_) co_yield static_cast<T*>(user.user);
+      for(auto* use = uses_.head; use;) {
+         auto* next = use->next();
+         co_yield use->user();
+         use = next;
+      }
    }
    utils::Generator<T const*> users() const {
-      for(auto use : uses_) co_yield static_cast<T*>(use.user);
+      for(auto* use = uses_.head; use;) {
+         auto* next = use->next();
+         co_yield use->user();
+         use = next;
+      }
    }
-   auto numUsers() const { return uses_.size(); }
+   auto numUsers() const { return uses_.size; }
 
 protected:
-   std::pmr::unordered_set<Use<T>, std::hash<Use<T>>, details::UseEqual<T>> uses_;
+   struct {
+      Use<T>* head = nullptr;
+      std::size_t size = 0;
+   } uses_;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -88,64 +226,86 @@ protected:
  * @brief Base class for graph nodes that have children (i.e., they "use"
  * other nodes). You must also separately inherit from GraphNode.
  *
+ * The children are stored as Use records, linked into the use lists of the
+ * children. Whenever the records move (i.e., the vector grows, or a child is
+ * inserted or removed in the middle), the moved records are unlinked first
+ * and linked again after.
+ *
  * @tparam T The type of the user class.
  */
 template <typename T>
 class utils::GraphNodeUser {
    friend class GraphNode<T>;
+   friend class Use<T>;
    using Node = GraphNode<T>;
 
 public:
    GraphNodeUser(BumpAllocator& alloc) : children_{alloc} {}
-   auto children() const { return std::views::all(children_); }
+   GraphNodeUser(GraphNodeUser const&) = delete;
+   GraphNodeUser& operator=(GraphNodeUser const&) = delete;
+   auto children() const {
+      return children_ | std::views::transform([](Use<T> const& use) {
+                return use.get();
+             });
+   }
    auto numChildren() const { return children_.size(); }
    Node* getRawChild(unsigned idx) const {
       assert(idx < numChildren() && "Index out of bounds");
-      return children_[idx];
+      return children_[idx].get();
    }
    void removeChild(unsigned idx) {
-      auto child = getRawChild(idx);
-      child->removeUse({static_cast<T*>(this), idx});
-      children_.erase(children_.begin() + idx);
+      assert(idx < numChildren() && "Index out of bounds");
+      relinkAfter(idx, [&] { children_.erase(children_.begin() + idx); });
    }
 
 protected:
    void addChild(Node* operand) {
-      children_.push_back(operand);
-      if(!operand) return;
-      operand->addUse({static_cast<T*>(this), (unsigned)numChildren() - 1});
+      addChild(operand, static_cast<unsigned>(numChildren()));
    }
    void addChild(Node* operand, unsigned idx) {
-      children_.insert(children_.begin() + idx, operand);
-      if(!operand) return;
-      operand->addUse({static_cast<T*>(this), idx});
+      assert(idx <= numChildren() && "Index out of bounds");
+      // All the records move if the vector grows
+      unsigned first = children_.size() == children_.capacity() ? 0 : idx;
+      relinkAfter(first, [&] {
+         children_.emplace(children_.begin() + idx, operand, static_cast<T*>(this));
+      });
    }
    void replaceChild(unsigned idx, Node* operand) {
       assert(idx < numChildren() && "Index out of bounds");
-      children_[idx]->removeUse({static_cast<T*>(this), idx});
-      children_[idx] = operand;
-      if(!operand) return;
-      operand->addUse({static_cast<T*>(this), idx});
+      children_[idx].set(operand);
+   }
+   /// @brief Removes the children from index idx on
+   void truncateChildren(unsigned idx) {
+      for(unsigned i = idx; i < numChildren(); i++) children_[i].unlink();
+      children_.erase(children_.begin() + idx, children_.end());
    }
    void destroy() {
       assert(!destroyed_);
-      unsigned idx = 0;
-      for(auto child : children_) {
-         if(!child) continue;
-         child->removeUse({static_cast<T*>(this), idx++});
-      }
+      for(auto& use : children_) use.unlink();
    }
    bool isDestroyed() const { return destroyed_; }
 
+private:
+   // Runs fn, which may move the records from index first on (and add new,
+   // unlinked ones), then links the records from first on again
+   template <typename F>
+   void relinkAfter(unsigned first, F&& fn) {
+      for(unsigned i = first; i < numChildren(); i++) children_[i].unlink();
+      fn();
+      for(unsigned i = first; i < numChildren(); i++) children_[i].link();
+   }
+
 protected:
-   std::pmr::vector<Node*> children_;
+   std::pmr::vector<Use<T>> children_;
    bool destroyed_ = false;
 };
 
 template <typename T>
 void utils::GraphNode<T>::replaceAllUsesWith(GraphNode<T>* newValue) {
-   std::vector<Use<T>> uses_copy{uses_.begin(), uses_.end()};
-   for(auto use : uses_copy) {
-      use.user->replaceChild(use.fromIndex, newValue);
+   if(newValue == this) return;
+   // Each replaceChild() unlinks the head of the list
+   while(auto* use = uses_.head) {
+      auto* user = static_cast<GraphNodeUser<T>*>(use->user());
+      user->replaceChild(use->fromIndex(), newValue);
    }
 }
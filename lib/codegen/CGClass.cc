@@ -8,18 +8,8 @@
 namespace codegen {
 
 void CodeGenerator::emitVTable(ast::ClassDecl const* decl) {
-   int numEntries = 0;
-   for(auto* method : hc.getInheritedMethods(decl)) {
-      numEntries = std::max(numEntries, vtableIndexMap[method]);
-   }
-   std::vector<tir::Type*> fieldTypes{(unsigned)numEntries + 1};
-   // 1. TypeID
-   fieldTypes[0] = (tir::Type::getInt32Ty(ctx));
-   // 2. Fill the rest with function pointers
-   for(int i = 1; i < numEntries + 1; i++) {
-      fieldTypes[i] = tir::Type::getPointerTy(ctx);
-   }
-   tir::StructType* vtableType = tir::StructType::get(ctx, fieldTypes);
+   // The vtable is the TypeID followed by the function pointers
+   tir::StructType* vtableType = layouts_.get(decl).vtableType;
    tir::Value* vtableGlobal;
    // Create a vtable global variable for the class (mangled)
    {
@@ -50,7 +40,7 @@ void CodeGenerator::emitVTable(ast::ClassDecl const* decl) {
    // storing it? */ gep);
    for(auto* method : hc.getInheritedMethods(decl)) {
       auto gep = builder.createGEPInstr(
-            vtableGlobal, vtableType, {vtableIndexMap[method]});
+            vtableGlobal, vtableType, {layouts_.vtableIndex(method)});
       builder.createStoreInstr(gvMap[method], gep);
    }
    builder.createReturnInstr();
@@ -59,38 +49,14 @@ void CodeGenerator::emitVTable(ast::ClassDecl const* decl) {
 void CodeGenerator::emitClassDecl(ast::ClassDecl const* decl) {
    // 1. Emit the function declarations
    for(auto* method : decl->methods()) emitFunctionDecl(method);
-   // 2. Emit any static fields as globals
-   // 3. Construct the class struct type as well
-   std::vector<tir::Type*> fieldTypes{};
-   // 3a) Add the VTable pointer field
-   fieldTypes.push_back(tir::Type::getPointerTy(ctx));
-   // 3b) Inherited members first
-   for(auto* field : hc.getInheritedMembersInOrder(decl)) {
-      fieldTypes.push_back(emitType(field->type()));
-      if(fieldIndexMap.contains(field)) {
-         assert(fieldIndexMap[field] == static_cast<int>(fieldTypes.size() - 1));
-      } else {
-         fieldIndexMap[field] = fieldTypes.size() - 1;
-      }
-   }
-   // 3c) Member and static fields
+   // 2. Emit any static fields as globals, the member fields are laid out
+   //    by the class layout
    for(auto* field : decl->fields()) {
-      auto ty = emitType(field->type());
-      // 3c.i) Static fields
-      if(field->modifiers().isStatic()) {
-         Mangler m{nr};
-         m.MangleDecl(field);
-         gvMap[field] = cu.CreateGlobalVariable(ty, m.getMangledName());
-      }
-      // 3c.ii) Member fields
-      else {
-         fieldTypes.push_back(ty);
-         fieldIndexMap[field] = fieldTypes.size() - 1;
-      }
-   }
-   // 4. Create the struct type and map it
-   if(!fieldTypes.empty()) {
-      typeMap[decl] = tir::StructType::get(ctx, fieldTypes);
+      if(!field->modifiers().isStatic()) continue;
+      Mangler m{nr};
+      m.MangleDecl(field);
+      gvMap[field] =
+            cu.CreateGlobalVariable(emitType(field->type()), m.getMangledName());
    }
 }
 
@@ -0,0 +1,134 @@
+#include "codegen/ClassLayout.h"
+
+#include <algorithm>
+
+#include "codegen/CodeGen.h"
+
+namespace codegen {
+
+static ast::ClassDecl const* getSuperClass(ast::ClassDecl const* decl) {
+   for(auto* superClass : decl->superClasses()) {
+      if(!superClass) continue;
+      auto* superDecl = dyn_cast_or_null<ast::ClassDecl>(superClass->decl());
+      return superDecl != decl ? superDecl : nullptr;
+   }
+   return nullptr;
+}
+
+void ClassLayoutTable::build(ast::LinkingUnit const* lu) {
+   layouts_.reset(lu->numDecls());
+   fields_.reset(lu->numDecls());
+   // 1. Assign the vtable slots, which every layout depends on
+   assignVTableSlots(lu);
+   // 2. Compute the layouts, superclasses first
+   for(auto* cu : lu->compliationUnits()) {
+      for(auto* decl : cu->decls()) {
+         if(auto* classDecl = dyn_cast<ast::ClassDecl>(decl))
+            computeLayout(classDecl);
+      }
+   }
+}
+
+ClassLayout const& ClassLayoutTable::computeLayout(ast::ClassDecl const* decl) {
+   if(auto* layout = layouts_.find(decl)) return *layout;
+   // 1. Start from the superclass layout, or just the vtable pointer
+   ClassLayout const* parent = nullptr;
+   if(auto* superDecl = getSuperClass(decl)) parent = &computeLayout(superDecl);
+   std::vector<tir::Type*> fieldTypes{};
+   std::vector<uint32_t> fieldOffsets{};
+   uint32_t size = 0;
+   if(parent) {
+      fieldTypes = parent->fieldTypes;
+      fieldOffsets = parent->fieldOffsets;
+      size = parent->sizeInBits;
+   } else {
+      fieldTypes.push_back(tir::Type::getPointerTy(ctx));
+      fieldOffsets.push_back(0);
+      size = fieldTypes.back()->getSizeInBits();
+   }
+   // 2. Append the member fields, static fields are globals instead. The
+   // struct is packed, so each field starts where the previous one ends.
+   for(auto* field : decl->fields()) {
+      if(field->modifiers().isStatic()) continue;
+      fieldTypes.push_back(cg.emitType(field->type()));
+      fieldOffsets.push_back(size);
+      fields_[field] = FieldLayout{(int)fieldTypes.size() - 1, size};
+      size += fieldTypes.back()->getSizeInBits();
+   }
+   // 3. Size the vtable for the methods of the class
+   int numEntries = 0;
+   for(auto* method : hc.getInheritedMethods(decl))
+      numEntries = std::max(numEntries, vtableIndex(method));
+   std::vector<tir::Type*> vtableTypes{(unsigned)numEntries + 1};
+   vtableTypes[0] = tir::Type::getInt32Ty(ctx);
+   for(int i = 1; i < numEntries + 1; i++)
+      vtableTypes[i] = tir::Type::getPointerTy(ctx);
+   // 4. Create the struct types and memoize the layout
+   auto* type = tir::StructType::get(ctx, fieldTypes);
+   auto* vtableType = tir::StructType::get(ctx, vtableTypes);
+   return layouts_[decl] = ClassLayout{parent,
+                                       std::move(fieldTypes),
+                                       std::move(fieldOffsets),
+                                       size,
+                                       type,
+                                       numEntries,
+                                       vtableType};
+}
+
+void ClassLayoutTable::assignVTableSlots(ast::LinkingUnit const* lu) {
+   auto inferenceGraph = InterferenceGraph{};
+   // 1. Build the interface method graph
+   for(auto* cu : lu->compliationUnits()) {
+      for(auto* decl : cu->decls()) {
+         if(auto* id = dyn_cast<ast::InterfaceDecl>(decl)) {
+            for(auto* method : hc.getInheritedMethods(id)) {
+               for(auto* method2 : hc.getInheritedMethods(id)) {
+                  if(method == method2) continue;
+                  inferenceGraph[method].insert(method2);
+               }
+            }
+         } else if(auto* cd = dyn_cast<ast::ClassDecl>(decl)) {
+            for(auto* method : hc.getInheritedMethods(cd)) {
+               for(auto* method2 : hc.getInheritedMethods(cd)) {
+                  if(method == method2) continue;
+                  inferenceGraph[method].insert(method2);
+               }
+            }
+         }
+      }
+   }
+   // 2. Colour the graph and assign indices
+   vtableIndex_.reset(lu->numDecls());
+   colorInterferenceGraph(inferenceGraph);
+}
+
+void ClassLayoutTable::colorInterferenceGraph(InterferenceGraph& graph) {
+   // Colour the methods in declaration order, as the order of the graph
+   // depends on their addresses and so would the slots
+   std::vector<ast::MethodDecl const*> methods;
+   for(auto& [key, val] : graph) methods.push_back(key);
+   std::ranges::sort(methods, {}, &ast::MethodDecl::id);
+   for(auto* key : methods) {
+      auto const& val = graph[key];
+      if(vtableIndex_.contains(key)) continue; // Already coloured
+      if(val.empty()) {
+         vtableIndex_[key] = 1;
+         continue;
+      } // No neighbours, color it 1
+      std::unordered_set<int> usedColors;
+      for(auto* neighbour : val) {
+         if(vtableIndex_.contains(neighbour)) {
+            usedColors.insert(vtableIndex_[neighbour]);
+         }
+      }
+      // colour it with the first available colour
+      for(int i = 1;; ++i) {
+         if(usedColors.count(i) == 0) {
+            vtableIndex_[key] = i;
+            break;
+         }
+      }
+   }
+}
+
+} // namespace codegen
@@ -13,7 +13,7 @@ using CG = CodeGenerator;
 
 CG::CodeGenerator(tir::Context& ctx, tir::CompilationUnit& cu,
                   semantic::NameResolver& nr, semantic::HierarchyChecker& hc)
-      : ctx{ctx}, cu{cu}, nr{nr}, hc{hc} {
+      : ctx{ctx}, cu{cu}, layouts_{ctx, *this, hc}, nr{nr}, hc{hc} {
    arrayType_ = tir::StructType::get(ctx,
                                      {// Length
                                       tir::Type::getInt32Ty(ctx),
@@ -48,10 +48,14 @@ tir::Type* CG::emitType(ast::Type const* type) {
 }
 
 void CG::run(ast::LinkingUnit const* lu) {
+   // 0. Size the side tables for the declarations in the linking unit
+   gvMap.reset(lu->numDecls());
+   rttiMap.reset(lu->numDecls());
+   vtableMap.reset(lu->numDecls());
    // 1. Populate the RTTI mappings
    populateRtti(lu);
-   // 2. Populate method index table
-   populateMethodIndexTable(lu);
+   // 2. Compute the class layouts and vtable slots
+   layouts_.build(lu);
    // 2. Generate the class structs
    for(auto* cu : lu->compliationUnits()) {
       for(auto* decl : cu->decls()) {
@@ -102,81 +106,25 @@ void CG::emitSetArrayPtr(tir::Value* ptr, tir::Value* arr) {
 }
 
 void CG::populateRtti(ast::LinkingUnit const* lu) {
-   int highestRtti = 0;
    // For each class and interface, add an entry to the RTTI map
+   std::vector<ast::Decl const*> types;
    for(auto* cu : lu->compliationUnits()) {
       for(auto* decl : cu->decls()) {
-         if(auto* classDecl = dyn_cast<ast::ClassDecl>(decl)) {
-            rttiMap[classDecl] = highestRtti++;
-         } else if(auto* iface = dyn_cast<ast::InterfaceDecl>(decl)) {
-            rttiMap[iface] = highestRtti++;
+         if(dyn_cast<ast::ClassDecl>(decl) || dyn_cast<ast::InterfaceDecl>(decl)) {
+            rttiMap[decl] = types.size();
+            types.push_back(decl);
          }
       }
    }
    // Create the RTTI table
-   rttiTable.resize(highestRtti, std::vector<bool>(highestRtti, false));
+   int highestRtti = types.size();
+   rttiTable.assign(highestRtti, std::vector<bool>(highestRtti, false));
    // Now populate the RTTI table (Ti, Tj)
-   for(auto& [key, val] : rttiMap) {
-      for(auto& [key2, val2] : rttiMap) {
-         rttiTable[val][val2] = hc.isSubType(key, key2);
+   for(int i = 0; i < highestRtti; i++) {
+      for(int j = 0; j < highestRtti; j++) {
+         rttiTable[i][j] = hc.isSubType(types[i], types[j]);
       }
    }
 }
 
-void CG::populateMethodIndexTable(ast::LinkingUnit const* lu) {
-   auto inferenceGraph =
-         std::unordered_map<const ast::MethodDecl*,
-                            std::unordered_set<const ast::MethodDecl*>>{};
-   // 1. Build the interface method graph
-   for(auto* cu : lu->compliationUnits()) {
-      for(auto* decl : cu->decls()) {
-         if(auto* id = dyn_cast<ast::InterfaceDecl>(decl)) {
-            for(auto* method : hc.getInheritedMethods(id)) {
-               for(auto* method2 : hc.getInheritedMethods(id)) {
-                  if(method == method2) continue;
-                  inferenceGraph[method].insert(method2);
-               }
-            }
-         } else if(auto* cd = dyn_cast<ast::ClassDecl>(decl)) {
-            for(auto* method : hc.getInheritedMethods(cd)) {
-               for(auto* method2 : hc.getInheritedMethods(cd)) {
-                  if(method == method2) continue;
-                  inferenceGraph[method].insert(method2);
-               }
-            }
-         }
-      }
-   }
-   // 2. Colour the graph and assign indices
-   vtableIndexMap.clear();
-   colorInterferenceGraph(inferenceGraph);
-}
-
-void CG::colorInterferenceGraph(
-      std::unordered_map<const ast::MethodDecl*,
-                         std::unordered_set<const ast::MethodDecl*>>& graph) {
-         for (auto& [key, val] : graph) {
-            if (vtableIndexMap.count(key)) continue; // Already coloured
-            if (val.empty()) {
-               vtableIndexMap[key] = 1;
-               // std::cout << key->name() << " -> 0\n";
-               continue;
-            } // No neighbours, color it 1
-            std::unordered_set<int> usedColors;
-            for(auto* neighbour : val) {
-               if(vtableIndexMap.count(neighbour)) {
-                  usedColors.insert(vtableIndexMap[neighbour]);
-               }
-            }
-            // colour it with the first available colour
-            for(int i = 1; ; ++i) {
-               if(usedColors.count(i) == 0) {
-                  vtableIndexMap[key] = i;
-                  // std::cout << key->name() << " -> " << i << "\n";
-                  break;
-               }
-            }
-         }
-      }
-
 } // namespace codegen
\ No newline at end of file
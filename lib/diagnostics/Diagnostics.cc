@@ -0,0 +1,97 @@
+#include "diagnostics/Diagnostics.h"
+
+#include <algorithm>
+#include <memory>
+#include <ranges>
+#include <string>
+#include <tuple>
+#include <utility>
+#include <vector>
+
+namespace diagnostics {
+
+namespace {
+
+// Unique across all engines, so a thread never mistakes the buffer it cached
+// for one of a previous region (or of a previous engine at the same address)
+std::atomic<uint64_t> NextGeneration{1};
+
+} // namespace
+
+thread_local size_t DiagnosticEngine::currentTask_ = NoTask;
+thread_local bool DiagnosticEngine::taskHasErrors_ = false;
+
+DiagnosticStorage& DiagnosticEngine::reportParallel(SourceRange loc, bool isError) {
+   // The buffer the current thread reports into, valid for one region only
+   thread_local struct {
+      uint64_t generation = 0;
+      ThreadBuffer* buffer = nullptr;
+   } cache;
+   if(cache.generation != generation_) {
+      // First report of this thread in the region: publish a new buffer
+      auto* buffer = new ThreadBuffer{};
+      buffer->next = buffers_.load(std::memory_order_relaxed);
+      while(!buffers_.compare_exchange_weak(buffer->next,
+                                            buffer,
+                                            std::memory_order_release,
+                                            std::memory_order_relaxed))
+         ;
+      cache.generation = generation_;
+      cache.buffer = buffer;
+   }
+   auto& diags = cache.buffer->diags;
+   return diags.emplace_back(currentTask_, diags.size(), isError, loc).storage;
+}
+
+void DiagnosticEngine::beginParallel() {
+   assert(!parallel_ && "parallel regions do not nest");
+   generation_ = NextGeneration.fetch_add(1, std::memory_order_relaxed);
+   parallel_ = true;
+}
+
+void DiagnosticEngine::endParallel(size_t lastTask) {
+   assert(parallel_ && "not in a parallel region");
+   parallel_ = false;
+   // 1. Gather the diagnostics of all the threads, but the discarded ones
+   std::vector<PendingDiagnostic*> diags;
+   auto* buffer = buffers_.exchange(nullptr, std::memory_order_acquire);
+   std::vector<std::unique_ptr<ThreadBuffer>> owned;
+   for(; buffer; buffer = buffer->next) {
+      owned.emplace_back(buffer);
+      for(auto& diag : buffer->diags)
+         if(diag.task == NoTask || diag.task <= lastTask) diags.push_back(&diag);
+   }
+   // 2. Sort them by task, then by the order they were reported in. A task
+   // runs on a single thread, so this is the order of a serial run. The
+   // diagnostics reported outside of a task are ordered by file name, line
+   // and column, as the threads may have reported them in any order. The
+   // keys are computed once, as the file names are built as strings.
+   auto key = [](PendingDiagnostic const* diag) {
+      auto loc = diag->storage.location().range_start();
+      bool tasked = diag->task != NoTask;
+      return std::tuple{diag->task,
+                        tasked ? diag->seq : 0,
+                        tasked ? std::string{}
+                               : SourceManager::getFileName(loc.file()),
+                        loc.line(),
+                        loc.column(),
+                        diag->seq};
+   };
+   std::vector<std::pair<decltype(key(nullptr)), PendingDiagnostic*>> keyed;
+   keyed.reserve(diags.size());
+   for(auto* diag : diags) keyed.emplace_back(key(diag), diag);
+   std::ranges::sort(keyed, {}, &decltype(keyed)::value_type::first);
+   // 3. Record them as if they had been reported in that order
+   for(auto* diag : keyed | std::views::values) {
+      auto& list = diag->isError ? errors_ : warnings_;
+      list.emplace_after(list.before_begin(), diag->storage);
+   }
+}
+
+DiagnosticEngine::~DiagnosticEngine() {
+   // Only left over if a region did not end
+   for(auto* buffer = buffers_.load(); buffer;)
+      delete std::exchange(buffer, buffer->next);
+}
+
+} // namespace diagnostics
@@ -410,10 +410,8 @@ bool ER::isMethodMoreSpecific(ast::MethodDecl const* a,
    // Let b be declared in U with parameter types Ui
    // Then a > b when for all i, Ti > Ui and T > U
    // Where two types A > B when A converts to B
-   auto T = alloc.new_object<ast::ReferenceType>(cast<ast::Decl>(a->parent()),
-                                                 SourceRange{});
-   auto U = alloc.new_object<ast::ReferenceType>(cast<ast::Decl>(b->parent()),
-                                                 SourceRange{});
+   auto T = Sema->BuildReferenceType(cast<ast::Decl>(a->parent()));
+   auto U = Sema->BuildReferenceType(cast<ast::Decl>(b->parent()));
    if(!TR->isAssignableTo(T, U)) return false;
    assert(a->parameters().size() == b->parameters().size());
    for(size_t i = 0; i < a->parameters().size(); i++) {
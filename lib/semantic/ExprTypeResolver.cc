@@ -57,8 +57,19 @@ bool ExprTypeResolver::isReferenceOrArrType(const Type* type) const {
 //       3.3.4 Array type to another array type given the element type is a
 //       widening REFERENCE conversion
 bool ExprTypeResolver::isAssignableTo(const Type* lhs, const Type* rhs) const {
+   lhs = sema.GetCanonicalType(lhs);
+   rhs = sema.GetCanonicalType(rhs);
    // step 1
-   if(*lhs == *rhs) return true;
+   if(lhs == rhs) return true;
+   auto key = TypePair{lhs, rhs};
+   if(auto it = assignableCache_.find(key); it != assignableCache_.end())
+      return it->second;
+   bool result = isAssignableToImpl(lhs, rhs);
+   assignableCache_.emplace(key, result);
+   return result;
+}
+
+bool ExprTypeResolver::isAssignableToImpl(const Type* lhs, const Type* rhs) const {
 
    auto leftPrimitive = dyn_cast<const ast::BuiltInType*>(lhs);
    auto rightPrimitive = dyn_cast<const ast::BuiltInType*>(rhs);
@@ -145,7 +156,9 @@ bool ExprTypeResolver::isAssignableTo(const Type* lhs, const Type* rhs) const {
 
 bool ExprTypeResolver::isValidCast(const Type* exprType,
                                    const Type* castType) const {
-   if(*exprType == *castType) return true;
+   exprType = sema.GetCanonicalType(exprType);
+   castType = sema.GetCanonicalType(castType);
+   if(exprType == castType) return true;
 
    // identity conversion: java.lang.String <-> primitive type string
    if(isTypeString(castType) && (isTypeString(exprType) || exprType->isNull())) {
@@ -226,7 +239,7 @@ Type const* ExprTypeResolver::mapValue(ExprValue& node) const {
       return ty;
    } else {
       assert(node.isTypeResolved() && "ExprValue type is not resolved");
-      return node.type();
+      return sema.GetCanonicalType(node.type());
    }
 }
 
@@ -415,7 +428,7 @@ Type const* ExprTypeResolver::evalMethodCall(MethodOp& op, const Type* method,
    }
 
    // Return nullptr if the method has no return type
-   return op.resolveResultType(methodType->returnType());
+   return op.resolveResultType(sema.GetCanonicalType(methodType->returnType()));
 }
 
 Type const* ExprTypeResolver::evalNewObject(NewOp& op, const Type* object,
@@ -439,7 +452,7 @@ Type const* ExprTypeResolver::evalNewObject(NewOp& op, const Type* object,
       i++;
    }
 
-   return op.resolveResultType(constructor->returnType());
+   return op.resolveResultType(sema.GetCanonicalType(constructor->returnType()));
 }
 
 Type const* ExprTypeResolver::evalNewArray(NewArrayOp& op, const Type* array,
@@ -468,7 +481,7 @@ Type const* ExprTypeResolver::evalArrayAccess(ArrayAccessOp& op, const Type* arr
             << "is type " << index->toString();
    }
 
-   return op.resolveResultType(arrayType->getElementType());
+   return op.resolveResultType(sema.GetCanonicalType(arrayType->getElementType()));
 }
 
 Type const* ExprTypeResolver::evalCast(CastOp& op, const Type* type,
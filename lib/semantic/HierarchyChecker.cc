@@ -1,5 +1,7 @@
 #include "semantic/HierarchyChecker.h"
 
+#include <algorithm>
+#include <memory>
 #include <utility>
 
 #include "ast/AstNode.h"
@@ -45,7 +47,7 @@ bool HierarchyChecker::isSubType(ast::Decl const* sub, ast::Decl const* super) {
 bool HierarchyChecker::isSuperClass(ast::ClassDecl const* super,
                                     ast::ClassDecl const* sub) {
    if(super == sub) return true;
-   for(auto superClass : inheritanceMap_[sub]) {
+   for(auto superClass : getDirectSupers(sub)) {
       if(auto directSuper = dyn_cast<ast::ClassDecl>(superClass)) {
          if(isSuperClass(super, directSuper)) return true;
       }
@@ -56,7 +58,7 @@ bool HierarchyChecker::isSuperClass(ast::ClassDecl const* super,
 bool HierarchyChecker::isSuperInterface(ast::InterfaceDecl const* super,
                                         ast::Decl const* sub) {
    if(super == sub) return true;
-   for(auto superInterface : inheritanceMap_[sub]) {
+   for(auto superInterface : getDirectSupers(sub)) {
       if(isSuperInterface(super, superInterface)) return true;
    }
    return false;
@@ -64,26 +66,56 @@ bool HierarchyChecker::isSuperInterface(ast::InterfaceDecl const* super,
 
 void HierarchyChecker::setInheritedMembersHelper(ast::ClassDecl const* node,
                                                  ast::Decl const* parent) {
-   for(auto member : getInheritedMembers(parent)) {
+   // Derive the field table from the parent's, so the parent's slots are shared
+   auto* entry = memberInheritancesMap_.find(parent);
+   FieldTable const* parentTable = entry ? entry->get() : nullptr;
+   auto& table = newFieldTable(node, parentTable);
+   if(!parentTable) return;
+   for(size_t slot = 0; slot < parentTable->size(); slot++) {
+      auto member = parentTable->at(slot);
+      if(!member) continue;
       bool isHidden = false;
       for(auto memberInherited : node->fields()) {
          if(memberInherited->name() == member->name()) {
             isHidden = true;
          }
       }
-      if(!isHidden) memberInheritancesMap_[node].push_back(member);
+      // Hidden fields are tombstoned, the slot itself is kept
+      if(isHidden) table.override(slot, nullptr);
    }
 }
 
+utils::Generator<ast::MethodDecl const*> HierarchyChecker::getSuperMethods(
+      std::pmr::vector<ast::Decl const*> const& supers) const {
+   for(auto super : supers)
+      for(auto method : getInheritedMethods(super)) co_yield method;
+}
+
+HierarchyChecker::MethodTable const* HierarchyChecker::getPrimaryTable(
+      std::pmr::vector<ast::Decl const*> const& supers) const {
+   // A class always derives from its superclass' table
+   for(auto super : supers)
+      if(dyn_cast<ast::ClassDecl>(super)) return &getMethodTable(super);
+   // Otherwise, share the largest superinterface table
+   MethodTable const* primary = nullptr;
+   for(auto super : supers) {
+      auto& table = getMethodTable(super);
+      if(!primary || table.size() > primary->size()) primary = &table;
+   }
+   return primary;
+}
+
 void HierarchyChecker::checkMethodInheritanceHelper(
       ast::Decl const* node, std::pmr::unordered_set<ast::Decl const*>& visited) {
    // Mark the node as visited
    visited.insert(node);
-   std::pmr::vector<ast::MethodDecl const*> inheritedMethods;
-   memberInheritancesMap_[node] = std::pmr::vector<ast::FieldDecl const*>{};
+   // The direct supertypes whose tables have been computed. Because the
+   // supertypes are visited first, the tables are built in topological order.
+   std::pmr::vector<ast::Decl const*> supers;
    auto nodeAsClass = dyn_cast<ast::ClassDecl>(node);
+   ast::ClassDecl const* superClassDecl = nullptr;
 
-   for(auto super : inheritanceMap_[node]) {
+   for(auto super : getDirectSupers(node)) {
       if(auto superClass = dyn_cast<ast::ClassDecl>(super)) {
          if(!visited.count(superClass)) {
             checkMethodInheritanceHelper(superClass, visited);
@@ -93,10 +125,8 @@ void HierarchyChecker::checkMethodInheritanceHelper(
                   << superClass->name();
             continue;
          }
-         for(auto method : getInheritedMethods(superClass)) {
-            inheritedMethods.emplace_back(method);
-         }
-         setInheritedMembersHelper(nodeAsClass, superClass);
+         supers.push_back(superClass);
+         superClassDecl = superClass;
       } else if(auto superInterface = dyn_cast<ast::InterfaceDecl>(super)) {
          if(!visited.count(superInterface)) {
             checkMethodInheritanceHelper(superInterface, visited);
@@ -106,31 +136,36 @@ void HierarchyChecker::checkMethodInheritanceHelper(
                   << superInterface->name();
             continue;
          }
-         for(auto method : getInheritedMethods(superInterface)) {
-            inheritedMethods.emplace_back(method);
-         }
+         supers.push_back(superInterface);
       } else if(super != nullptr) {
          std::unreachable();
       }
    }
+   // Build the field table, then append the class' own fields to it
+   if(nodeAsClass && superClassDecl) {
+      setInheritedMembersHelper(nodeAsClass, superClassDecl);
+   } else {
+      newFieldTable(node, nullptr);
+   }
    if(auto classDecl = dyn_cast<ast::ClassDecl>(node)) {
-      checkClassMethod(classDecl, inheritedMethods);
+      checkClassMethod(classDecl, supers);
       checkClassConstructors(classDecl);
       if(diag.Verbose(2)) {
          diag.ReportDebug(2) << "Class: " << classDecl->name() << std::endl;
          diag.ReportDebug(2) << "Inherited fields: " << std::endl;
-         for(auto member : memberInheritancesMap_[node]) {
+         for(auto member : getInheritedMembers(node)) {
             diag.ReportDebug(2) << "\t" << member->name() << std::endl;
          }
       }
    } else if(auto interfaceDecl = dyn_cast<ast::InterfaceDecl>(node)) {
-      checkInterfaceMethod(interfaceDecl, inheritedMethods);
+      checkInterfaceMethod(interfaceDecl, supers);
    }
    if(nodeAsClass) {
-      for(auto member : nodeAsClass->fields()) {
-         memberInheritancesMap_[node].push_back(member);
-      }
+      auto& table = *memberInheritancesMap_.at(node);
+      for(auto member : nodeAsClass->fields()) table.append(member);
    }
+   // The tables are complete, so flatten them for the lookups that follow
+   memberInheritancesMap_.at(node)->flatten();
 }
 
 void HierarchyChecker::checkMethodInheritance() {
@@ -149,8 +184,30 @@ void HierarchyChecker::checkMethodInheritance() {
    }
 }
 
+HierarchyChecker::MethodTable& HierarchyChecker::newMethodTable(
+      ast::Decl const* decl, MethodTable const* parent) {
+   auto& table = methodInheritanceMap_[decl];
+   if(!table) table = std::make_unique<MethodTable>(parent);
+   return *table;
+}
+
+HierarchyChecker::FieldTable& HierarchyChecker::newFieldTable(
+      ast::Decl const* decl, FieldTable const* parent) {
+   auto& table = memberInheritancesMap_[decl];
+   if(!table) table = std::make_unique<FieldTable>(parent);
+   return *table;
+}
+
+void HierarchyChecker::addDirectSuper(ast::Decl const* decl,
+                                      ast::Decl const* super) {
+   auto& supers = inheritanceMap_[decl];
+   if(std::ranges::find(supers, super) == supers.end()) supers.push_back(super);
+}
+
 void HierarchyChecker::checkInheritance() {
-   inheritanceMap_.clear();
+   inheritanceMap_.reset(lu_->numDecls());
+   methodInheritanceMap_.reset(lu_->numDecls());
+   memberInheritancesMap_.reset(lu_->numDecls());
    for(auto cu : lu_->compliationUnits()) {
       auto body = cu->body();
       // if the body is null, continue to the next iteration
@@ -173,11 +230,10 @@ void HierarchyChecker::checkInheritance() {
                      << "A class must not extend a final class"
                      << classDecl->name();
             }
-            inheritanceMap_[classDecl].insert(superClassDecl);
+            addDirectSuper(classDecl, superClassDecl);
          } else if(auto objectClass = classDecl->superClasses()[1]) {
             // if the class does not extend any class, it extends the object class
-            inheritanceMap_[classDecl].insert(
-                  cast<ast::ClassDecl>(objectClass->decl()));
+            addDirectSuper(classDecl, cast<ast::ClassDecl>(objectClass->decl()));
          }
 
          // check if interfaces are valid
@@ -198,7 +254,7 @@ void HierarchyChecker::checkInheritance() {
                diag.ReportError(classDecl->location())
                      << "A class must not implement a class" << classDecl->name();
             } else {
-               inheritanceMap_[classDecl].insert(interfaceDecl);
+               addDirectSuper(classDecl, interfaceDecl);
             }
          }
       } else if(auto interfaceDecl = dyn_cast<ast::InterfaceDecl>(body)) {
@@ -219,7 +275,7 @@ void HierarchyChecker::checkInheritance() {
                      << "A interface must not extend a class"
                      << superInterface->name();
             } else {
-               inheritanceMap_[interfaceDecl].insert(superInterface);
+               addDirectSuper(interfaceDecl, superInterface);
             }
             // print debug information
             if(diag.Verbose(2)) {
@@ -235,12 +291,11 @@ void HierarchyChecker::checkInheritance() {
 
 void HierarchyChecker::checkClassMethod(
       ast::ClassDecl const* classDecl,
-      std::pmr::vector<ast::MethodDecl const*>& inheritedMethods) {
-   std::pmr::vector<ast::MethodDecl const*> allMethods;
+      std::pmr::vector<ast::Decl const*> const& supers) {
    std::pmr::vector<ast::MethodDecl const*> inheritedNotOverriden;
+   std::pmr::unordered_set<ast::MethodDecl const*> inheritedKept;
    // check for duplicate methods
    for(auto method : classDecl->methods()) {
-      allMethods.emplace_back(method);
       for(auto other : classDecl->methods()) {
          if(method == other) continue;
          if(isSameMethodSignature(method, other)) {
@@ -265,7 +320,7 @@ void HierarchyChecker::checkClassMethod(
    }
 
    // check for method replacement
-   for(auto const* other : inheritedMethods) {
+   for(auto const* other : getSuperMethods(supers)) {
       bool isOverriden = false;
       for(auto const* method : classDecl->methods()) {
          if(!isSameMethodSignature(method, other)) continue;
@@ -333,17 +388,47 @@ void HierarchyChecker::checkClassMethod(
                << "method is inherited from here" << method->location()
                << "abstract method is declared here";
       } else if(isImplemented == !method->modifiers().isAbstract()) {
-         allMethods.emplace_back(method);
+         inheritedKept.insert(method);
       }
    }
-   // record the inherited methods
-   setInheritedMethods(classDecl, allMethods);
+
+   // record the inherited methods as a delta over the superclass table:
+   // overridden slots are replaced, dropped slots are tombstoned and the
+   // new methods are appended.
+   auto* primary = getPrimaryTable(supers);
+   auto& table = newMethodTable(classDecl, primary);
+   std::pmr::unordered_set<ast::MethodDecl const*> placed;
+   for(size_t slot = 0; primary && slot < primary->size(); slot++) {
+      auto const* other = primary->at(slot);
+      if(!other) continue;
+      ast::MethodDecl const* replacement = nullptr;
+      for(auto const* method : classDecl->methods()) {
+         if(isSameMethodSignature(method, other)) replacement = method;
+      }
+      if(!replacement && inheritedKept.contains(other)) {
+         placed.insert(other);
+         continue;
+      }
+      if(replacement && placed.insert(replacement).second) {
+         table.override(slot, replacement);
+      } else {
+         table.override(slot, nullptr);
+      }
+   }
+   for(auto const* method : classDecl->methods()) {
+      if(placed.insert(method).second) table.append(method);
+   }
+   for(auto const* method : inheritedNotOverriden) {
+      if(!inheritedKept.contains(method)) continue;
+      if(placed.insert(method).second) table.append(method);
+   }
+   table.flatten();
 
    // print debug information
    if(diag.Verbose(2)) {
       diag.ReportDebug(2) << "Class: " << classDecl->name();
       diag.ReportDebug(2) << "Inherited methods: ";
-      for(auto method : allMethods) {
+      for(auto method : getInheritedMethods(classDecl)) {
          if(auto parent = dyn_cast<ast::ClassDecl>(method->parent())) {
             diag.ReportDebug(2)
                   << "\t" << method->name() << " -> " << parent->name();
@@ -371,11 +456,12 @@ void HierarchyChecker::checkClassConstructors(ast::ClassDecl const* classDecl) {
 
 void HierarchyChecker::checkInterfaceMethod(
       ast::InterfaceDecl const* interfaceDecl,
-      std::pmr::vector<ast::MethodDecl const*>& inheritedMethods) {
-   std::pmr::vector<ast::MethodDecl const*> allMethods;
+      std::pmr::vector<ast::Decl const*> const& supers) {
+   // Inherited method -> the method of this interface that overrides it
+   std::pmr::unordered_map<ast::MethodDecl const*, ast::MethodDecl const*>
+         overriddenBy;
 
    for(auto method : interfaceDecl->methods()) {
-      allMethods.emplace_back(method);
       for(auto other : interfaceDecl->methods()) {
          if(method == other) continue;
          if(isSameMethodSignature(method, other)) {
@@ -412,8 +498,7 @@ void HierarchyChecker::checkInterfaceMethod(
       }
    }
 
-   for(auto method : inheritedMethods) {
-      bool isOverriden = false;
+   for(auto method : getSuperMethods(supers)) {
       for(auto other : interfaceDecl->methods()) {
          if(isSameMethodSignature(method, other)) {
             if(method->returnTy() != other->returnTy()) {
@@ -422,15 +507,39 @@ void HierarchyChecker::checkInterfaceMethod(
                         "signature. "
                      << method->name();
             } else {
-               isOverriden = true;
+               overriddenBy[method] = other;
             }
          }
       }
-      if(!isOverriden) allMethods.emplace_back(method);
    }
 
-   for(auto method : allMethods) {
-      for(auto other : allMethods) {
+   // record the inherited methods as a delta over the primary superinterface
+   auto* primary = getPrimaryTable(supers);
+   auto& table = newMethodTable(interfaceDecl, primary);
+   std::pmr::unordered_set<ast::MethodDecl const*> placed;
+   for(size_t slot = 0; primary && slot < primary->size(); slot++) {
+      auto const* method = primary->at(slot);
+      if(!method) continue;
+      auto it = overriddenBy.find(method);
+      if(it == overriddenBy.end()) {
+         if(!placed.insert(method).second) table.override(slot, nullptr);
+      } else if(placed.insert(it->second).second) {
+         table.override(slot, it->second);
+      } else {
+         table.override(slot, nullptr);
+      }
+   }
+   for(auto method : interfaceDecl->methods()) {
+      if(placed.insert(method).second) table.append(method);
+   }
+   for(auto method : getSuperMethods(supers)) {
+      if(overriddenBy.contains(method)) continue;
+      if(placed.insert(method).second) table.append(method);
+   }
+   table.flatten();
+
+   for(auto method : getInheritedMethods(interfaceDecl)) {
+      for(auto other : getInheritedMethods(interfaceDecl)) {
          if(method == other) continue;
          if(isSameMethodSignature(method, other) &&
             method->returnTy() != other->returnTy()) {
@@ -442,14 +551,12 @@ void HierarchyChecker::checkInterfaceMethod(
       }
    }
 
-   // record the inherited methods
-   setInheritedMethods(interfaceDecl, allMethods);
-
    // print debug information
    if(diag.Verbose(2)) {
       diag.ReportDebug(2) << "Interface: " << interfaceDecl->name();
       diag.ReportDebug(2) << "Inherited methods:";
-      for(auto method : allMethods) diag.ReportDebug(2) << "\t" << method->name();
+      for(auto method : getInheritedMethods(interfaceDecl))
+         diag.ReportDebug(2) << "\t" << method->name();
    }
 }
 
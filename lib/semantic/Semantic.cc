@@ -12,7 +12,7 @@ namespace ast {
 using std::string;
 
 Semantic::Semantic(BumpAllocator& alloc, diagnostics::DiagnosticEngine& diag)
-      : alloc{alloc}, diag{diag} {
+      : alloc{alloc}, diag{diag}, referenceTypes_{alloc}, arrayTypes_{alloc} {
    // Preallocate java.lang.Object type
    {
       auto ty = BuildUnresolvedType(SourceRange{});
@@ -32,25 +32,70 @@ UnresolvedType* Semantic::BuildUnresolvedType(SourceRange loc) {
    return alloc.new_object<UnresolvedType>(alloc, loc);
 }
 
+// The types written in the source keep their own node, so diagnostics can
+// point at them. Only their canonical type is shared, see GetCanonicalType().
+
 ArrayType* Semantic::BuildArrayType(Type* elementType, SourceRange loc) {
    return alloc.new_object<ArrayType>(alloc, elementType, loc);
 }
 
 BuiltInType* Semantic::BuildBuiltInType(parsetree::BasicType::Type type,
                                         SourceRange loc) {
-   return alloc.new_object<BuiltInType>(type, loc);
+   return alloc.new_object<BuiltInType>(BuiltInType::KindFrom(type), loc);
 }
 
 BuiltInType* Semantic::BuildBuiltInType(parsetree::Literal::Type type) {
-   return alloc.new_object<BuiltInType>(type);
+   return BuildBuiltInType(BuiltInType::KindFrom(type));
 }
 
 BuiltInType* Semantic::BuildBuiltInType(ast::BuiltInType::Kind type) {
-   return alloc.new_object<BuiltInType>(type, SourceRange{});
+   auto& ty = builtinTypes_[static_cast<size_t>(type)];
+   if(!ty) {
+      ty = alloc.new_object<BuiltInType>(type, SourceRange{});
+      ty->canonical_ = ty;
+   }
+   return ty;
 }
 
 ReferenceType* Semantic::BuildReferenceType(Decl const* decl) {
-   return alloc.new_object<ReferenceType>(decl, SourceRange{});
+   auto& ty = referenceTypes_[decl];
+   if(!ty) {
+      ty = alloc.new_object<ReferenceType>(decl, SourceRange{});
+      ty->canonical_ = ty;
+   }
+   return ty;
+}
+
+/* ===--------------------------------------------------------------------=== */
+// Type uniquing
+/* ===--------------------------------------------------------------------=== */
+
+ArrayType* Semantic::GetArrayType(Type const* elementType) {
+   elementType = GetCanonicalType(elementType);
+   auto& ty = arrayTypes_[elementType];
+   if(!ty) {
+      // Canonical element types are resolved, so they are never mutated
+      ty = alloc.new_object<ArrayType>(alloc, const_cast<Type*>(elementType));
+      ty->canonical_ = ty;
+   }
+   return ty;
+}
+
+Type const* Semantic::GetCanonicalType(Type const* type) {
+   if(!type) return nullptr;
+   if(type->canonical_) return type->canonical_;
+   if(!type->isResolved() || type->isInvalid()) return type;
+   Type const* canonical = type;
+   if(auto ty = dyn_cast<BuiltInType>(type)) {
+      canonical = BuildBuiltInType(ty->getKind());
+   } else if(auto ty = dyn_cast<ReferenceType>(type)) {
+      canonical = BuildReferenceType(ty->decl());
+   } else if(auto ty = dyn_cast<ArrayType>(type)) {
+      canonical = GetArrayType(ty->getElementType());
+   }
+   // Synthetic method types are not uniqued, they map to themselves
+   type->canonical_ = canonical;
+   return canonical;
 }
 
 /* ===--------------------------------------------------------------------=== */
@@ -124,7 +169,31 @@ LinkingUnit* Semantic::BuildLinkingUnit(
    compilationUnits.push_back(
          BuildCompilationUnit(javaLangPackage, imports, SourceRange(), nullptr));
 
-   return alloc.new_object<LinkingUnit>(alloc, compilationUnits);
+   auto lu = alloc.new_object<LinkingUnit>(alloc, compilationUnits);
+   AssignDeclIds(lu);
+   return lu;
+}
+
+void Semantic::AssignDeclIds(LinkingUnit* lu) {
+   uint32_t nextId = 0;
+   auto assign = [&nextId](Decl* decl) { decl->id_ = nextId++; };
+   auto assignMethod = [&assign](MethodDecl* method) {
+      assign(method);
+      for(auto* local : method->locals()) assign(local);
+   };
+   for(auto* cu : lu->compliationUnits()) {
+      auto* body = cu->mut_bodyAsDecl();
+      if(!body) continue;
+      assign(body);
+      if(auto* classDecl = dyn_cast<ClassDecl>(body)) {
+         for(auto* field : classDecl->fields()) assign(field);
+         for(auto* method : classDecl->methods()) assignMethod(method);
+         for(auto* ctor : classDecl->constructors()) assignMethod(ctor);
+      } else if(auto* interfaceDecl = dyn_cast<InterfaceDecl>(body)) {
+         for(auto* method : interfaceDecl->methods()) assignMethod(method);
+      }
+   }
+   lu->numDecls_ = nextId;
 }
 
 CompilationUnit* Semantic::BuildCompilationUnit(
@@ -1,6 +1,8 @@
 #include "tir/BasicBlock.h"
 
+#include <algorithm>
 #include <sstream>
+#include <vector>
 
 #include "tir/Constant.h"
 #include "tir/Context.h"
@@ -13,7 +15,10 @@ BasicBlock::BasicBlock(Context& ctx, Function* parent)
       : Value{ctx, Type::getLabelTy(ctx)},
         first_{nullptr},
         last_{nullptr},
-        parent_{parent} {
+        parent_{parent},
+        succs_{ctx.alloc()},
+        succCounts_{ctx.alloc()},
+        preds_{ctx.alloc()} {
    parent->addBlock(this);
    setName("bb");
 }
@@ -57,7 +62,7 @@ void BasicBlock::appendAfterEnd(Instruction* instr) {
    } else {
       first_ = last_ = instr;
    }
-   instr->parent_ = this;
+   instr->setParent(this);
 }
 
 void BasicBlock::insertBeforeBegin(Instruction* instr) {
@@ -67,7 +72,7 @@ void BasicBlock::insertBeforeBegin(Instruction* instr) {
    } else {
       first_ = last_ = instr;
    }
-   instr->parent_ = this;
+   instr->setParent(this);
 }
 
 Instruction* BasicBlock::getFirstInsertionPoint() const {
@@ -115,27 +120,58 @@ int BasicBlock::printDotNode(utils::DotPrinter& dp) const {
    return id;
 }
 
-utils::Generator<BasicBlock*> BasicBlock::successors() const {
-   assert(terminator() && "Basic block has no terminator");
-   auto term = dyn_cast<BranchInst>(terminator());
-   if(term) {
-      co_yield term->getSuccessor(0);
-      if(term->getSuccessor(0) != term->getSuccessor(1)) {
-         co_yield term->getSuccessor(1);
-      }
+void BasicBlock::replaceAllUsesWith(GraphNode* newValue) {
+   auto* newBB = cast<BasicBlock>(static_cast<Value*>(newValue));
+   // Grab the branches first, as the uses are unlinked as they are replaced
+   std::vector<BranchInst*> branches;
+   for(auto* user : users()) {
+      auto* br = dyn_cast<BranchInst>(user);
+      if(!br || !br->parent()) continue;
+      if(std::ranges::find(branches, br) != branches.end()) continue;
+      branches.push_back(br);
+      br->parent()->removeBranchEdges(br);
    }
+   Value::replaceAllUsesWith(newBB);
+   for(auto* br : branches) br->parent()->addBranchEdges(br);
 }
 
-utils::Generator<BasicBlock*> BasicBlock::predecessors() const {
-   std::unordered_set<BasicBlock*> visited;
-   for(auto user : users()) {
-      if(auto term = dyn_cast<BranchInst>(user)) {
-         visited.insert(term->parent());
-      }
+void BasicBlock::addBranchEdges(BranchInst* br) {
+   addEdge(br->getSuccessor(0));
+   addEdge(br->getSuccessor(1));
+   // Order the successors as the branch does, with the true successor first
+   for(int i = 1; i >= 0; i--) {
+      auto it = std::ranges::find(succs_, br->getSuccessor(i));
+      auto idx = it - succs_.begin();
+      std::rotate(succs_.begin(), it, it + 1);
+      std::rotate(succCounts_.begin(), succCounts_.begin() + idx,
+                  succCounts_.begin() + idx + 1);
    }
-   for(auto pred : visited) {
-      co_yield pred;
+}
+
+void BasicBlock::removeBranchEdges(BranchInst* br) {
+   removeEdge(br->getSuccessor(0));
+   removeEdge(br->getSuccessor(1));
+}
+
+void BasicBlock::addEdge(BasicBlock* succ) {
+   auto it = std::ranges::find(succs_, succ);
+   if(it != succs_.end()) {
+      succCounts_[it - succs_.begin()]++;
+      return;
    }
+   succs_.push_back(succ);
+   succCounts_.push_back(1);
+   succ->preds_.push_back(this);
+}
+
+void BasicBlock::removeEdge(BasicBlock* succ) {
+   auto it = std::ranges::find(succs_, succ);
+   assert(it != succs_.end() && "Edge does not exist");
+   auto idx = it - succs_.begin();
+   if(--succCounts_[idx] > 0) return;
+   succs_.erase(it);
+   succCounts_.erase(succCounts_.begin() + idx);
+   std::erase(succ->preds_, this);
 }
 
 utils::Generator<PhiNode*> BasicBlock::phis() const {
@@ -151,6 +187,8 @@ utils::Generator<PhiNode*> BasicBlock::phis() const {
 
 void BasicBlock::releaseAllReferences() {
    for(auto* inst : *this) {
+      // Drops the CFG edges of the branches
+      inst->setParent(nullptr);
       inst->destroy();
    }
 }
@@ -0,0 +1,791 @@
+#include "tir/Bitcode.h"
+
+#include <algorithm>
+#include <fstream>
+#include <iterator>
+#include <ranges>
+#include <utility>
+
+#include "tir/BasicBlock.h"
+#include "tir/Instructions.h"
+#include "utils/Error.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
+
+#if defined(__linux__)
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+STATISTIC(NumFunctionsRead, "bitcode", "Number of functions read from bitcode");
+STATISTIC(NumBodiesMaterialized,
+          "bitcode",
+          "Number of function bodies materialized from bitcode");
+
+namespace tir {
+
+namespace {
+
+constexpr char Magic[4] = {'T', 'I', 'R', 'B'};
+
+// The types with a fixed index in the type table (i.e., not encoded)
+constexpr unsigned NumBuiltinTypes = 3;
+
+enum class TypeCode : uint8_t { Integer, Array, Struct, Function };
+
+enum class GlobalCode : uint8_t { Variable, Function };
+
+enum class Opcode : uint8_t {
+   Br,
+   Ret,
+   Store,
+   Load,
+   Call,
+   Binary,
+   Cmp,
+   ICast,
+   Alloca,
+   GetElementPtr,
+   Phi
+};
+
+/**
+ * @brief The kind of value an operand refers to, stored in the low bits of
+ * the operand. The rest of the operand is the index of the value in its
+ * table (i.e., an instruction is its position within the function), except:
+ *  - ForwardInst is followed by the type of the instruction, as it is read
+ *    before the instruction exists.
+ *  - Int is the index of the type, followed by the zero-extended value.
+ *  - Special is 0 for null or 1 + the index of the type for undef.
+ */
+enum class OperandKind : uint8_t {
+   Inst,
+   ForwardInst,
+   Arg,
+   Block,
+   Global,
+   Intrinsic,
+   Int,
+   Special
+};
+constexpr unsigned OperandKindBits = 3;
+
+/* ===--------------------------------------------------------------------=== */
+// BitcodeWriter
+/* ===--------------------------------------------------------------------=== */
+
+class BitcodeWriter {
+   using Buffer = std::vector<uint8_t>;
+
+public:
+   explicit BitcodeWriter(CompilationUnit& CU) : CU_{CU} {}
+   void write(std::ostream& os);
+
+private:
+   void writeTypes(Buffer& out);
+   void writeGlobal(Buffer& out, std::string_view name, GlobalObject* go);
+   void writeBody(Buffer& out, Function* fn);
+   void writeOperand(Buffer& out, Value* val, unsigned curInst);
+   unsigned typeID(Type* ty) const;
+   unsigned stringID(std::string_view str);
+   void writeName(Buffer& out, Value const* val) {
+      emitVarint(out, val->hasName() ? stringID(val->name()) + 1 : 0);
+   }
+   void numberType(Type* ty);
+   static void emitVarint(Buffer& out, uint64_t value) {
+      do {
+         uint8_t byte = value & 0x7f;
+         value >>= 7;
+         out.push_back(byte | (value ? 0x80 : 0));
+      } while(value);
+   }
+   static void emitFixed(Buffer& out, uint64_t value, unsigned bytes) {
+      for(unsigned i = 0; i < bytes; i++) out.push_back((value >> (8 * i)) & 0xff);
+   }
+
+private:
+   CompilationUnit& CU_;
+   std::vector<Type*> types_;
+   std::unordered_map<Type const*, unsigned> typeIDs_;
+   std::vector<std::string_view> strings_;
+   std::unordered_map<std::string_view, unsigned> stringIDs_;
+   std::unordered_map<Value const*, unsigned> globalIDs_;
+   std::unordered_map<Function const*, Instruction::IntrinsicKind> intrinsics_;
+   // The local values of the function being written
+   std::unordered_map<Value const*, unsigned> localIDs_;
+};
+
+void BitcodeWriter::write(std::ostream& os) {
+   CU_.materializeAll();
+   using IK = Instruction::IntrinsicKind;
+   for(int i = 0; i < static_cast<int>(IK::LAST_MEMBER); i++)
+      intrinsics_.emplace(CU_.getIntrinsic(static_cast<IK>(i)), static_cast<IK>(i));
+
+   // 1. Number the types, the children always come before their parents
+   auto& pimpl = CU_.ctx().pimpl();
+   numberType(pimpl.pointerType);
+   numberType(pimpl.voidType);
+   numberType(pimpl.labelType);
+   for(auto* ty : pimpl.integerTypes) numberType(ty);
+   for(auto* ty : pimpl.structTypes) numberType(ty);
+   for(auto* ty : pimpl.arrayTypes) numberType(ty);
+   for(auto* ty : pimpl.functionTypes) numberType(ty);
+
+   // 2. Number the globals, then write them and the bodies (which also fills
+   // the string table, so the strings are written last)
+   std::vector<std::pair<std::string_view, GlobalObject*>> globals;
+   for(auto [name, go] : CU_.global_objects_kv()) {
+      globalIDs_.emplace(go, globals.size());
+      globals.emplace_back(name, go);
+   }
+   Buffer globalsBuf, bodiesBuf;
+   std::vector<std::pair<uint64_t, uint64_t>> index;
+   emitVarint(globalsBuf, globals.size());
+   for(auto [name, go] : globals) {
+      writeGlobal(globalsBuf, name, go);
+      auto* fn = dyn_cast<Function>(go);
+      if(!fn || !fn->hasBody()) continue;
+      auto begin = bodiesBuf.size();
+      writeBody(bodiesBuf, fn);
+      index.emplace_back(begin, bodiesBuf.size() - begin);
+   }
+   Buffer typesBuf;
+   writeTypes(typesBuf);
+   Buffer stringsBuf;
+   emitVarint(stringsBuf, strings_.size());
+   for(auto str : strings_) {
+      emitVarint(stringsBuf, str.size());
+      stringsBuf.insert(stringsBuf.end(), str.begin(), str.end());
+   }
+
+   // 3. Lay out the module, the index points past itself to the bodies
+   Buffer header;
+   header.insert(header.end(), std::begin(Magic), std::end(Magic));
+   emitFixed(header, BitcodeVersion, 4);
+   uint64_t bodiesBegin = header.size() + stringsBuf.size() + typesBuf.size() +
+                          globalsBuf.size() + index.size() * 16;
+   Buffer indexBuf;
+   for(auto [offset, size] : index) {
+      emitFixed(indexBuf, bodiesBegin + offset, 8);
+      emitFixed(indexBuf, size, 8);
+   }
+   for(auto* buf :
+       {&header, &stringsBuf, &typesBuf, &globalsBuf, &indexBuf, &bodiesBuf})
+      os.write(reinterpret_cast<char const*>(buf->data()), buf->size());
+}
+
+void BitcodeWriter::numberType(Type* ty) {
+   if(typeIDs_.contains(ty)) return;
+   if(auto* arr = dyn_cast<ArrayType>(ty)) {
+      numberType(arr->getElementType());
+   } else if(auto* st = dyn_cast<StructType>(ty)) {
+      for(auto* elem : st->getElements()) numberType(elem);
+   } else if(auto* fty = dyn_cast<FunctionType>(ty)) {
+      numberType(fty->getReturnType());
+      for(auto* param : fty->getParamTypes()) numberType(param);
+   }
+   typeIDs_.emplace(ty, types_.size());
+   types_.push_back(ty);
+}
+
+unsigned BitcodeWriter::typeID(Type* ty) const {
+   auto it = typeIDs_.find(ty);
+   assert(it != typeIDs_.end() && "Type is not from the context of the unit");
+   return it->second;
+}
+
+unsigned BitcodeWriter::stringID(std::string_view str) {
+   auto [it, inserted] = stringIDs_.try_emplace(str, strings_.size());
+   if(inserted) strings_.push_back(str);
+   return it->second;
+}
+
+void BitcodeWriter::writeTypes(Buffer& out) {
+   emitVarint(out, types_.size() - NumBuiltinTypes);
+   for(size_t i = NumBuiltinTypes; i < types_.size(); i++) {
+      auto* ty = types_[i];
+      if(auto* ity = dyn_cast<IntegerType>(ty)) {
+         out.push_back(static_cast<uint8_t>(TypeCode::Integer));
+         emitVarint(out, ity->getBitWidth());
+      } else if(auto* arr = dyn_cast<ArrayType>(ty)) {
+         out.push_back(static_cast<uint8_t>(TypeCode::Array));
+         emitVarint(out, arr->getLength());
+         emitVarint(out, typeID(arr->getElementType()));
+      } else if(auto* st = dyn_cast<StructType>(ty)) {
+         out.push_back(static_cast<uint8_t>(TypeCode::Struct));
+         emitVarint(out, st->numElements());
+         for(auto* elem : st->getElements()) emitVarint(out, typeID(elem));
+      } else if(auto* fty = dyn_cast<FunctionType>(ty)) {
+         out.push_back(static_cast<uint8_t>(TypeCode::Function));
+         emitVarint(out, fty->numParams());
+         emitVarint(out, typeID(fty->getReturnType()));
+         for(auto* param : fty->getParamTypes()) emitVarint(out, typeID(param));
+      } else {
+         assert(false && "Unknown type");
+      }
+   }
+}
+
+void BitcodeWriter::writeGlobal(Buffer& out, std::string_view name,
+                                GlobalObject* go) {
+   if(auto* gv = dyn_cast<GlobalVariable>(go)) {
+      out.push_back(static_cast<uint8_t>(GlobalCode::Variable));
+      emitVarint(out, stringID(name));
+      emitVarint(out, typeID(gv->type()));
+      auto* init = gv->initializer();
+      emitVarint(out, init ? globalIDs_.at(init) + 1 : 0);
+      return;
+   }
+   auto* fn = cast<Function>(go);
+   out.push_back(static_cast<uint8_t>(GlobalCode::Function));
+   emitVarint(out, stringID(name));
+   emitVarint(out, typeID(fn->type()));
+   emitVarint(out, static_cast<Function::Attrs::T>(fn->attrs().all));
+   emitVarint(out, fn->hasBody());
+   for(auto* arg : fn->args()) writeName(out, arg);
+}
+
+void BitcodeWriter::writeBody(Buffer& out, Function* fn) {
+   // Number the blocks and instructions in layout order
+   localIDs_.clear();
+   unsigned numBlocks = 0, numInsts = 0;
+   for(auto* bb : fn->body()) {
+      localIDs_.emplace(bb, numBlocks++);
+      for(auto* inst : *bb) localIDs_.emplace(inst, numInsts++);
+   }
+   emitVarint(out, numBlocks);
+   for(auto* bb : fn->body()) {
+      writeName(out, bb);
+      unsigned size = 0;
+      for([[maybe_unused]] auto* inst : *bb) size++;
+      emitVarint(out, size);
+   }
+   unsigned curInst = 0;
+   for(auto* bb : fn->body()) {
+      for(auto* inst : *bb) {
+         Opcode op;
+         Type* ty = inst->type();
+         unsigned data = 0;
+         if(dyn_cast<BranchInst>(inst)) {
+            op = Opcode::Br;
+         } else if(dyn_cast<ReturnInst>(inst)) {
+            op = Opcode::Ret;
+         } else if(dyn_cast<StoreInst>(inst)) {
+            op = Opcode::Store;
+         } else if(dyn_cast<LoadInst>(inst)) {
+            op = Opcode::Load;
+         } else if(dyn_cast<CallInst>(inst)) {
+            op = Opcode::Call;
+         } else if(auto* bin = dyn_cast<BinaryInst>(inst)) {
+            op = Opcode::Binary;
+            data = static_cast<unsigned>(bin->binop());
+         } else if(auto* cmp = dyn_cast<CmpInst>(inst)) {
+            op = Opcode::Cmp;
+            data = static_cast<unsigned>(cmp->predicate());
+         } else if(auto* icast = dyn_cast<ICastInst>(inst)) {
+            op = Opcode::ICast;
+            data = static_cast<unsigned>(icast->castop());
+         } else if(auto* alloca = dyn_cast<AllocaInst>(inst)) {
+            op = Opcode::Alloca;
+            ty = alloca->allocatedType();
+         } else if(auto* gep = dyn_cast<GetElementPtrInst>(inst)) {
+            op = Opcode::GetElementPtr;
+            ty = gep->getContainedType();
+         } else if(dyn_cast<PhiNode>(inst)) {
+            op = Opcode::Phi;
+         } else {
+            assert(false && "Unknown instruction");
+            std::unreachable();
+         }
+         out.push_back(static_cast<uint8_t>(op));
+         emitVarint(out, typeID(ty));
+         emitVarint(out, data);
+         emitVarint(out, inst->numChildren());
+         for(unsigned i = 0; i < inst->numChildren(); i++)
+            writeOperand(out, inst->getChild(i), curInst);
+         writeName(out, inst);
+         curInst++;
+      }
+   }
+}
+
+void BitcodeWriter::writeOperand(Buffer& out, Value* val, unsigned curInst) {
+   auto emit = [&out](OperandKind kind, uint64_t index) {
+      emitVarint(out, (index << OperandKindBits) | static_cast<uint64_t>(kind));
+   };
+   if(val->isInstruction() || val->isBasicBlock()) {
+      auto it = localIDs_.find(val);
+      assert(it != localIDs_.end() && "Operand is from another function");
+      if(val->isBasicBlock()) {
+         emit(OperandKind::Block, it->second);
+      } else if(it->second < curInst) {
+         emit(OperandKind::Inst, it->second);
+      } else {
+         emit(OperandKind::ForwardInst, it->second);
+         emitVarint(out, typeID(val->type()));
+      }
+   } else if(auto* arg = dyn_cast<Argument>(val)) {
+      emit(OperandKind::Arg, arg->index());
+   } else if(auto* ci = dyn_cast<ConstantInt>(val)) {
+      emit(OperandKind::Int, typeID(ci->type()));
+      emitVarint(out, ci->zextValue());
+   } else if(auto* fn = dyn_cast<Function>(val); fn && intrinsics_.contains(fn)) {
+      emit(OperandKind::Intrinsic, static_cast<uint64_t>(intrinsics_.at(fn)));
+   } else if(auto it = globalIDs_.find(val); it != globalIDs_.end()) {
+      emit(OperandKind::Global, it->second);
+   } else if(dyn_cast<ConstantNullPointer>(val)) {
+      emit(OperandKind::Special, 0);
+   } else if(dyn_cast<Undef>(val)) {
+      emit(OperandKind::Special, typeID(val->type()) + 1);
+   } else {
+      assert(false && "Unknown operand");
+   }
+}
+
+} // namespace
+
+void WriteBitcode(CompilationUnit& CU, std::ostream& os) {
+   utils::trace::Span span{"WriteBitcode", "bitcode"};
+   BitcodeWriter{CU}.write(os);
+}
+
+/* ===--------------------------------------------------------------------=== */
+// BitcodeReader
+/* ===--------------------------------------------------------------------=== */
+
+/// @brief Reads the primitives of the encoding from a range of the module
+class BitcodeReader::Cursor {
+public:
+   explicit Cursor(std::span<uint8_t const> data)
+         : pos_{data.data()}, end_{data.data() + data.size()} {}
+   bool atEnd() const { return pos_ == end_; }
+   uint8_t byte() {
+      check(1);
+      return *pos_++;
+   }
+   uint64_t varint() {
+      uint64_t value = 0;
+      for(unsigned shift = 0; shift < 64; shift += 7) {
+         uint8_t b = byte();
+         value |= static_cast<uint64_t>(b & 0x7f) << shift;
+         if(!(b & 0x80)) return value;
+      }
+      throw utils::FatalError("Malformed TIR bitcode: varint is too long");
+   }
+   uint64_t fixed(unsigned bytes) {
+      check(bytes);
+      uint64_t value = 0;
+      for(unsigned i = 0; i < bytes; i++)
+         value |= static_cast<uint64_t>(pos_[i]) << (8 * i);
+      pos_ += bytes;
+      return value;
+   }
+   std::span<uint8_t const> bytes(uint64_t size) {
+      check(size);
+      std::span<uint8_t const> ret{pos_, static_cast<size_t>(size)};
+      pos_ += size;
+      return ret;
+   }
+
+private:
+   void check(uint64_t size) const {
+      if(size > static_cast<uint64_t>(end_ - pos_))
+         throw utils::FatalError("Malformed TIR bitcode: unexpected end of data");
+   }
+
+private:
+   uint8_t const* pos_;
+   uint8_t const* end_;
+};
+
+namespace {
+
+[[noreturn]] void Malformed(std::string const& what) {
+   throw utils::FatalError("Malformed TIR bitcode: " + what);
+}
+
+// Converts the data of an instruction to a member of E, which it must be
+template <typename E>
+E ToEnum(uint64_t data, char const* what) {
+   if(data >= static_cast<uint64_t>(E::LAST_MEMBER))
+      Malformed(std::string{"unknown "} + what);
+   return static_cast<E>(data);
+}
+
+} // namespace
+
+BitcodeReader::BitcodeReader(CompilationUnit& CU, std::span<uint8_t const> data)
+      : CU_{CU}, data_{data} {}
+
+BitcodeReader::~BitcodeReader() {
+#if defined(__linux__)
+   if(mapping_) munmap(mapping_, data_.size());
+#endif
+}
+
+std::unique_ptr<BitcodeReader> BitcodeReader::OpenFile(CompilationUnit& CU,
+                                                       std::string const& path) {
+   auto reader = std::make_unique<BitcodeReader>(CU, std::span<uint8_t const>{});
+#if defined(__linux__)
+   // Map the module, so the bodies never materialized are never paged in
+   if(int fd = open(path.c_str(), O_RDONLY); fd >= 0) {
+      struct stat st;
+      if(fstat(fd, &st) == 0 && st.st_size > 0) {
+         void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+         if(p != MAP_FAILED) {
+            reader->mapping_ = p;
+            reader->data_ = {static_cast<uint8_t const*>(p),
+                             static_cast<size_t>(st.st_size)};
+         }
+      }
+      close(fd);
+      if(reader->mapping_) return reader;
+   }
+#endif
+   std::ifstream file{path, std::ios::binary};
+   if(!file) throw utils::FatalError("Cannot open TIR bitcode file " + path);
+   reader->buffer_.assign(std::istreambuf_iterator<char>{file},
+                          std::istreambuf_iterator<char>{});
+   reader->data_ = reader->buffer_;
+   return reader;
+}
+
+std::string_view BitcodeReader::readString(Cursor& cur) const {
+   auto id = cur.varint();
+   if(id >= strings_.size()) Malformed("string index out of range");
+   return strings_[id];
+}
+
+Type* BitcodeReader::readType(Cursor& cur) const {
+   auto id = cur.varint();
+   if(id >= types_.size()) Malformed("type index out of range");
+   return types_[id];
+}
+
+void BitcodeReader::load() {
+   utils::trace::Span span{"LoadBitcode", "bitcode"};
+   auto& ctx = CU_.ctx();
+   Cursor cur{data_};
+
+   // 1. Check the header
+   auto magic = cur.bytes(sizeof(Magic));
+   if(!std::equal(magic.begin(), magic.end(), std::begin(Magic)))
+      Malformed("not a TIR bitcode module");
+   if(auto version = cur.fixed(4); version != BitcodeVersion) {
+      throw utils::FatalError("Unsupported TIR bitcode version " +
+                              std::to_string(version));
+   }
+
+   // 2. Read the string table, the strings are views into the module
+   strings_.resize(cur.varint());
+   for(auto& str : strings_) {
+      auto bytes = cur.bytes(cur.varint());
+      str = {reinterpret_cast<char const*>(bytes.data()), bytes.size()};
+   }
+
+   // 3. Read the type table, in the order the types were created
+   types_ = {Type::getPointerTy(ctx), Type::getVoidTy(ctx), Type::getLabelTy(ctx)};
+   auto numTypes = cur.varint();
+   for(uint64_t i = 0; i < numTypes; i++) {
+      Type* ty = nullptr;
+      switch(static_cast<TypeCode>(cur.byte())) {
+         case TypeCode::Integer:
+            ty = IntegerType::get(ctx, cur.varint());
+            break;
+         case TypeCode::Array: {
+            auto length = cur.varint();
+            ty = ArrayType::get(ctx, readType(cur), length);
+            break;
+         }
+         case TypeCode::Struct: {
+            std::vector<Type*> elems(cur.varint());
+            for(auto& elem : elems) elem = readType(cur);
+            ty = StructType::get(ctx, elems);
+            break;
+         }
+         case TypeCode::Function: {
+            std::vector<Type*> params(cur.varint());
+            auto* ret = readType(cur);
+            for(auto& param : params) param = readType(cur);
+            ty = FunctionType::get(ctx, ret, params);
+            break;
+         }
+         default:
+            Malformed("unknown type code");
+      }
+      types_.push_back(ty);
+   }
+
+   // 4. Read the globals, the initializers may refer to later globals
+   std::vector<std::pair<GlobalVariable*, uint64_t>> initializers;
+   std::vector<Function*> withBody;
+   globals_.resize(cur.varint());
+   for(auto& go : globals_) {
+      auto code = static_cast<GlobalCode>(cur.byte());
+      auto name = readString(cur);
+      auto* ty = readType(cur);
+      if(code == GlobalCode::Variable) {
+         auto* gv = CU_.CreateGlobalVariable(ty, name);
+         if(!gv) Malformed("redefinition of global " + std::string{name});
+         initializers.emplace_back(gv, cur.varint());
+         go = gv;
+      } else if(code == GlobalCode::Function) {
+         auto* fty = dyn_cast<FunctionType>(ty);
+         if(!fty) Malformed("function type expected");
+         auto* fn = CU_.CreateFunction(fty, name);
+         if(!fn) Malformed("redefinition of function " + std::string{name});
+         auto attrs = static_cast<Function::Attrs::T>(cur.varint());
+         fn->setAttrs(Function::Attrs{.all{attrs}});
+         if(cur.varint()) withBody.push_back(fn);
+         for(auto* arg : fn->args())
+            if(auto id = cur.varint()) {
+               if(id > strings_.size()) Malformed("string index out of range");
+               arg->setName(strings_[id - 1]);
+            }
+         go = fn;
+         ++NumFunctionsRead;
+      } else {
+         Malformed("unknown global code");
+      }
+   }
+   for(auto [gv, init] : initializers) {
+      if(!init) continue;
+      if(init > globals_.size() || !dyn_cast<Function>(globals_[init - 1]))
+         Malformed("initializer is not a function");
+      gv->setInitializer(cast<Function>(globals_[init - 1]));
+   }
+
+   // 5. Read the index of the bodies, they are read when materialized
+   for(auto* fn : withBody) {
+      auto offset = cur.fixed(8);
+      auto size = cur.fixed(8);
+      if(offset > data_.size() || size > data_.size() - offset)
+         Malformed("function body out of range");
+      bodies_.emplace(fn, data_.subspan(offset, size));
+   }
+}
+
+void BitcodeReader::materialize(Function* fn) {
+   auto it = bodies_.find(fn);
+   if(it == bodies_.end()) return;
+   auto body = it->second;
+   bodies_.erase(it);
+   utils::trace::Span span{"Materialize", "bitcode", fn->name()};
+   readBody(fn, body);
+   ++NumBodiesMaterialized;
+}
+
+void BitcodeReader::materializeAll() {
+   // Read in the order of the globals, so the unit is the same either way
+   for(auto* go : globals_)
+      if(auto* fn = dyn_cast<Function>(go)) materialize(fn);
+}
+
+void BitcodeReader::readBody(Function* fn, std::span<uint8_t const> body) {
+   auto& ctx = CU_.ctx();
+   Cursor cur{body};
+   auto readName = [&](Value* val) {
+      if(auto id = cur.varint()) {
+         if(id > strings_.size()) Malformed("string index out of range");
+         val->setName(strings_[id - 1]);
+      }
+   };
+
+   // 1. Create the blocks, in reverse as the function prepends them (but the
+   // entry block first, which is the last in layout order)
+   std::vector<BasicBlock*> blocks(cur.varint());
+   std::vector<uint64_t> blockSizes(blocks.size());
+   if(blocks.empty()) Malformed("function body has no blocks");
+   for(size_t i = blocks.size(); i-- > 0;)
+      blocks[i] = BasicBlock::Create(ctx, fn);
+   for(size_t i = 0; i < blocks.size(); i++) {
+      readName(blocks[i]);
+      blockSizes[i] = cur.varint();
+   }
+
+   // 2. Create the instructions, the forward references are placeholders
+   // until the instruction referred to is created
+   std::vector<Instruction*> insts;
+   std::unordered_map<uint64_t, Value*> forwardRefs;
+   auto readOperand = [&]() -> Value* {
+      auto ref = cur.varint();
+      auto index = ref >> OperandKindBits;
+      switch(static_cast<OperandKind>(ref & ((1 << OperandKindBits) - 1))) {
+         case OperandKind::Inst:
+            if(index >= insts.size()) Malformed("instruction index out of range");
+            return insts[index];
+         case OperandKind::ForwardInst: {
+            auto* ty = readType(cur);
+            auto [it, inserted] = forwardRefs.try_emplace(index, nullptr);
+            if(inserted) it->second = Undef::Create(ctx, ty);
+            return it->second;
+         }
+         case OperandKind::Arg:
+            if(index >= fn->numParams()) Malformed("argument index out of range");
+            return fn->arg(index);
+         case OperandKind::Block:
+            if(index >= blocks.size()) Malformed("block index out of range");
+            return blocks[index];
+         case OperandKind::Global:
+            if(index >= globals_.size()) Malformed("global index out of range");
+            return globals_[index];
+         case OperandKind::Intrinsic: {
+            using IK = Instruction::IntrinsicKind;
+            if(index >= static_cast<uint64_t>(IK::LAST_MEMBER))
+               Malformed("unknown intrinsic");
+            return CU_.getIntrinsic(static_cast<IK>(index));
+         }
+         case OperandKind::Int: {
+            if(index >= types_.size() || !types_[index]->isIntegerType())
+               Malformed("integer type expected");
+            return ConstantInt::Create(ctx, types_[index], cur.varint());
+         }
+         case OperandKind::Special:
+            if(index == 0) return Constant::CreateNullPointer(ctx);
+            if(index > types_.size()) Malformed("type index out of range");
+            return Undef::Create(ctx, types_[index - 1]);
+         default:
+            Malformed("unknown operand kind");
+      }
+   };
+   auto asBlock = [](Value* val) {
+      auto* bb = dyn_cast<BasicBlock>(val);
+      if(!bb) Malformed("block operand expected");
+      return bb;
+   };
+   auto asValue = [](Value* val) {
+      if(val->isBasicBlock()) Malformed("value operand expected");
+      return val;
+   };
+   auto asInt = [&](Value* val) {
+      if(!asValue(val)->type()->isIntegerType())
+         Malformed("integer operand expected");
+      return val;
+   };
+   // The operands of binary and compare instructions have the same type
+   auto expectSameType = [](Value* lhs, Value* rhs) {
+      if(lhs->type() != rhs->type()) Malformed("operand types differ");
+   };
+   auto* ptrTy = Type::getPointerTy(ctx);
+   std::vector<Value*> ops;
+   for(size_t b = 0; b < blocks.size(); b++) {
+      for(uint64_t n = 0; n < blockSizes[b]; n++) {
+         auto op = static_cast<Opcode>(cur.byte());
+         auto* ty = readType(cur);
+         auto data = cur.varint();
+         ops.resize(cur.varint());
+         for(auto& val : ops) val = readOperand();
+         auto expect = [&](size_t min, size_t max) {
+            if(ops.size() < min || ops.size() > max)
+               Malformed("wrong number of operands");
+         };
+         Instruction* inst = nullptr;
+         switch(op) {
+            case Opcode::Br:
+               expect(3, 3);
+               inst = BranchInst::Create(
+                     ctx, asInt(ops[0]), asBlock(ops[1]), asBlock(ops[2]));
+               break;
+            case Opcode::Ret:
+               expect(0, 1);
+               inst = ReturnInst::Create(
+                     ctx, ops.empty() ? nullptr : asValue(ops[0]));
+               break;
+            case Opcode::Store:
+               expect(2, 2);
+               inst = StoreInst::Create(ctx, asValue(ops[0]), asValue(ops[1]));
+               break;
+            case Opcode::Load:
+               expect(1, 1);
+               inst = LoadInst::Create(ctx, ty, asValue(ops[0]));
+               break;
+            case Opcode::Call:
+               expect(1, ops.size());
+               if(auto* callee = dyn_cast<Function>(ops[0])) {
+                  if(ops.size() - 1 != callee->numParams())
+                     Malformed("wrong number of arguments");
+               } else {
+                  Malformed("callee is not a function");
+               }
+               for(auto* arg : ops | std::views::drop(1)) asValue(arg);
+               inst = CallInst::Create(ctx, ops[0], ops | std::views::drop(1));
+               break;
+            case Opcode::Binary:
+               expect(2, 2);
+               expectSameType(asInt(ops[0]), asInt(ops[1]));
+               if(data == static_cast<uint64_t>(Instruction::BinOp::None))
+                  Malformed("unknown binary operator");
+               inst = BinaryInst::Create(
+                     ctx,
+                     ToEnum<Instruction::BinOp>(data, "binary operator"),
+                     ops[0],
+                     ops[1]);
+               break;
+            case Opcode::Cmp:
+               expect(2, 2);
+               expectSameType(asValue(ops[0]), asValue(ops[1]));
+               inst = CmpInst::Create(
+                     ctx,
+                     ToEnum<Instruction::Predicate>(data, "predicate"),
+                     ops[0],
+                     ops[1]);
+               break;
+            case Opcode::ICast:
+               expect(1, 1);
+               if(!ty->isIntegerType()) Malformed("integer type expected");
+               inst = ICastInst::Create(ctx,
+                                        ToEnum<Instruction::CastOp>(data, "cast"),
+                                        asInt(ops[0]),
+                                        ty);
+               break;
+            case Opcode::Alloca:
+               expect(0, 0);
+               inst = AllocaInst::Create(ctx, ty);
+               break;
+            case Opcode::GetElementPtr:
+               expect(1, ops.size());
+               if(!ty->isStructType() && !ty->isArrayType())
+                  Malformed("struct or array type expected");
+               for(auto* idx : ops | std::views::drop(1)) {
+                  if(asInt(idx)->type()->getSizeInBits() != ptrTy->getSizeInBits())
+                     Malformed("index is not as wide as a pointer");
+               }
+               inst = GetElementPtrInst::Create(
+                     ctx, asValue(ops[0]), ty, ops | std::views::drop(1));
+               break;
+            case Opcode::Phi: {
+               if(ops.size() % 2) Malformed("wrong number of operands");
+               std::vector<Value*> values;
+               std::vector<BasicBlock*> preds;
+               for(size_t i = 0; i < ops.size(); i += 2) {
+                  if(asValue(ops[i])->type() != ty)
+                     Malformed("phi value of the wrong type");
+                  values.push_back(ops[i]);
+                  preds.push_back(asBlock(ops[i + 1]));
+               }
+               inst = PhiNode::Create(ctx, ty, values, preds);
+               break;
+            }
+            default:
+               Malformed("unknown opcode");
+         }
+         readName(inst);
+         blocks[b]->appendAfterEnd(inst);
+         insts.push_back(inst);
+      }
+   }
+   if(!cur.atEnd()) Malformed("trailing data after function body");
+
+   // 3. Resolve the forward references
+   for(auto [index, placeholder] : forwardRefs) {
+      if(index >= insts.size()) Malformed("instruction index out of range");
+      // The uses were checked against the type of the placeholder
+      if(placeholder->type() != insts[index]->type())
+         Malformed("forward reference of the wrong type");
+      placeholder->replaceAllUsesWith(insts[index]);
+   }
+}
+
+} // namespace tir
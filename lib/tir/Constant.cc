@@ -2,6 +2,7 @@
 
 #include <iostream>
 #include <queue>
+#include <unordered_set>
 
 #include "tir/BasicBlock.h"
 #include "tir/Type.h"
@@ -23,7 +24,7 @@ std::ostream& ConstantNullPointer::print(std::ostream& os) const {
 }
 
 std::ostream& Undef::print(std::ostream& os) const {
-   os << "undef";
+   os << "undef:" << *type();
    return os;
 }
 
@@ -34,6 +35,7 @@ std::ostream& ConstantInt::print(std::ostream& os) const {
 
 std::ostream& GlobalVariable::print(std::ostream& os) const {
    os << "global " << *type() << " @" << name();
+   if(initializer_) os << " = @" << initializer_->name();
    return os;
 }
 
@@ -63,8 +65,15 @@ std::ostream& Function::print(std::ostream& os) const {
    os << ")";
    if(hasBody()) {
       os << " {\n";
+      // The unreachable blocks are printed last, so the function can be
+      // parsed back (i.e., the phis may still refer to them)
+      std::unordered_set<BasicBlock const*> printed;
       for(auto* bb : reversePostOrder()) {
          bb->print(os) << "\n";
+         printed.insert(bb);
+      }
+      for(auto* bb : body()) {
+         if(!printed.contains(bb)) bb->print(os) << "\n";
       }
       os << "}\n";
    }
@@ -112,6 +121,15 @@ utils::Generator<BasicBlock*> Function::reversePostOrder() const {
    }
 }
 
+void Function::numberValues() const {
+   if(numbered_) return;
+   for(auto* bb : body()) {
+      bb->localNumber_ = numBlockNumbers_++;
+      for(auto* inst : *bb) inst->localNumber_ = numInstNumbers_++;
+   }
+   numbered_ = true;
+}
+
 void Function::removeBlock(BasicBlock* block) {
    assert(block->parent() == this && "Block does not belong to this function");
    assert(block != entryBB_ && "Cannot remove the entry block");
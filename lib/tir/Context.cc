@@ -5,6 +5,7 @@
 #include "tir/Constant.h"
 #include "tir/Type.h"
 #include "tir/Value.h"
+#include "utils/User.h"
 
 namespace tir {
 
@@ -30,4 +31,12 @@ Context::Context(BumpAllocator& alloc, target::TargetInfo& TI)
          ContextPImpl{alloc, pointerType, voidType, labelType, nullPointer};
 }
 
+void Context::setConcurrent(bool concurrent) {
+   if(concurrent == concurrent_) return;
+   concurrent_ = concurrent;
+   utils::UseListLocks::SetConcurrent(concurrent);
+   if(auto* heap = dynamic_cast<utils::CustomBufferResource*>(alloc_.resource()))
+      heap->set_concurrent(concurrent);
+}
+
 } // namespace tir
\ No newline at end of file
@@ -7,7 +7,10 @@
 namespace tir {
 
 static std::ostream& printNameOrConst(std::ostream& os, Value const* val) {
-   if(val->isConstant()) {
+   if(auto* go = dyn_cast<GlobalObject>(val)) {
+      // Refer to the global objects by name, not by their definition
+      os << "@" << go->name();
+   } else if(val->isConstant()) {
       os << *val;
    } else {
       if(val->type()->isLabelType())
@@ -50,6 +53,20 @@ void RegisterAllIntrinsics(CompilationUnit& CU) {
    CU.CreateIntrinsic(I::check_null, FTy::get(ctx, VoidTy, {PtrTy}));
 }
 
+/* ===--------------------------------------------------------------------=== */
+// Instruction implementation
+/* ===--------------------------------------------------------------------=== */
+
+void Instruction::setParent(BasicBlock* parent) {
+   if(parent == parent_) return;
+   auto* br = dyn_cast<BranchInst>(this);
+   if(br && parent_) parent_->removeBranchEdges(br);
+   parent_ = parent;
+   if(br && parent_) parent_->addBranchEdges(br);
+   if(parent_ && localNumber_ == NoLocalNumber)
+      parent_->parent()->numberInstruction(this);
+}
+
 /* ===--------------------------------------------------------------------=== */
 // BranchInst implementation
 /* ===--------------------------------------------------------------------=== */
@@ -76,6 +93,13 @@ BasicBlock* BranchInst::getSuccessor(unsigned idx) const {
    return cast<BasicBlock>(getChild(idx + 1));
 }
 
+void BranchInst::replaceSuccessor(unsigned idx, BasicBlock* newBB) {
+   assert(idx < 2 && "Index out of bounds");
+   if(parent()) parent()->removeBranchEdges(this);
+   replaceChild(idx + 1, newBB);
+   if(parent()) parent()->addBranchEdges(this);
+}
+
 /* ===--------------------------------------------------------------------=== */
 // ReturnInst implementation
 /* ===--------------------------------------------------------------------=== */
@@ -289,15 +313,14 @@ PhiNode::PhiNode(Context& ctx, Type* type, utils::range_ref<Value*> values,
                  utils::range_ref<BasicBlock*> preds)
       : Instruction{ctx, type} {
    assert(values.size() == preds.size() && "PhiNode values and preds mismatch");
+   // The operands are interleaved as value, pred, value, pred, ...
+   std::vector<Value*> vals;
+   vals.reserve(values.size());
+   values.for_each([&vals](Value* val) { vals.push_back(val); });
    unsigned i = 0;
-   values.for_each([this, &i](Value* val) {
-      addChild(val, i);
-      i += 2;
-   });
-   i = 1;
-   preds.for_each([this, &i](BasicBlock* bb) {
-      addChild(bb, i);
-      i += 2;
+   preds.for_each([this, &vals, &i](BasicBlock* bb) {
+      addChild(vals[i++]);
+      addChild(bb);
    });
 }
 
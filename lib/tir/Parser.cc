@@ -0,0 +1,672 @@
+#include "tir/Parser.h"
+
+#include <algorithm>
+#include <cctype>
+#include <charconv>
+#include <optional>
+#include <sstream>
+#include <string>
+#include <tuple>
+#include <unordered_map>
+#include <vector>
+
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Instructions.h"
+#include "utils/Error.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
+
+STATISTIC(NumFunctionsParsed, "tir-parser", "Number of functions parsed");
+STATISTIC(NumInstructionsParsed, "tir-parser", "Number of instructions parsed");
+
+namespace tir {
+
+namespace {
+
+enum class TokenKind { Ident, Local, Label, Global, Int, Punct, End };
+
+struct Token {
+   TokenKind kind;
+   // The text of the token, without the sigil of the names (i.e., %)
+   std::string_view text;
+   unsigned line;
+   unsigned col;
+   bool is(char c) const { return kind == TokenKind::Punct && text[0] == c; }
+   bool is(std::string_view keyword) const {
+      return kind == TokenKind::Ident && text == keyword;
+   }
+};
+
+bool IsDigit(char c) { return std::isdigit(static_cast<unsigned char>(c)); }
+
+bool IsNameChar(char c) {
+   return std::isalnum(static_cast<unsigned char>(c)) || c == '_' || c == '.' ||
+          c == '$';
+}
+
+// Strips the ".N" ID printed after a value name (see Value::printName), the
+// name is empty if the value had none
+std::string_view StripID(std::string_view name) {
+   auto dot = name.find_last_of('.');
+   auto id = dot == std::string_view::npos ? name : name.substr(dot + 1);
+   if(id.empty() || !std::all_of(id.begin(), id.end(), IsDigit)) return name;
+   return dot == std::string_view::npos ? std::string_view{}
+                                        : name.substr(0, dot);
+}
+
+// Finds the enum member named name in lower case (as the instructions are
+// printed), given the function to get the name of a member
+template <typename Enum>
+std::optional<Enum> FindEnum(std::string_view name,
+                             std::string_view (*getName)(Enum)) {
+   for(int i = 0; i < static_cast<int>(Enum::LAST_MEMBER); i++) {
+      auto member = static_cast<Enum>(i);
+      auto str = getName(member);
+      if(std::equal(str.begin(), str.end(), name.begin(), name.end(),
+                    [](char a, char b) { return std::tolower(a) == b; }))
+         return member;
+   }
+   return std::nullopt;
+}
+
+std::string TypeName(Type const* ty) {
+   std::ostringstream ss;
+   ss << *ty;
+   return ss.str();
+}
+
+/**
+ * @brief Parses a module in two passes. The first reads the types, globals
+ * and function signatures, skipping over the bodies, and the second reads
+ * the bodies. That way, the functions can be called before they are defined.
+ */
+class ModuleParser final {
+public:
+   ModuleParser(CompilationUnit& CU, std::string_view text,
+                std::string_view filename)
+         : CU_{CU}, ctx_{CU.ctx()}, text_{text}, filename_{filename} {
+      next();
+   }
+
+   void parse() {
+      // 1. Read the top-level definitions
+      while(tok_.kind != TokenKind::End) {
+         if(tok_.is("type")) {
+            parseStruct();
+         } else if(tok_.is("global")) {
+            parseGlobal();
+         } else if(tok_.is("function")) {
+            parseFunctionHeader();
+         } else {
+            error(tok_, "expected a type, global or function definition");
+         }
+      }
+      // 2. Resolve the initializers, now that all the functions are known
+      for(auto& [gv, init] : initializers_) {
+         auto* fn = CU_.findFunction(init.text);
+         if(!fn) error(init, "undefined function @" + std::string{init.text});
+         gv->setInitializer(fn);
+      }
+      // 3. Read the function bodies
+      for(auto& body : bodies_) {
+         seek(body.start);
+         parseBody(body);
+      }
+   }
+
+private:
+   // The lexer state, to come back to a function body after skipping it
+   struct Position {
+      size_t pos;
+      unsigned line;
+      size_t lineStart;
+      Token tok;
+   };
+   struct PendingBody {
+      Function* fn;
+      std::vector<Token> args;
+      Position start;
+   };
+   struct BlockEntry {
+      BasicBlock* bb;
+      Token use;
+      bool defined;
+   };
+   struct ForwardRef {
+      Value* placeholder;
+      Token use;
+   };
+
+   /* ===-----------------------------------------------------------------=== */
+   // Lexer
+   /* ===-----------------------------------------------------------------=== */
+
+   void skipSpace() {
+      while(pos_ < text_.size()) {
+         char c = text_[pos_];
+         if(c == '\n') {
+            line_++;
+            lineStart_ = pos_ + 1;
+         } else if(c == ';') {
+            // Comments run to the end of the line
+            while(pos_ + 1 < text_.size() && text_[pos_ + 1] != '\n') pos_++;
+         } else if(!std::isspace(static_cast<unsigned char>(c))) {
+            return;
+         }
+         pos_++;
+      }
+   }
+
+   void next() {
+      skipSpace();
+      Token tok{TokenKind::End, {}, line_,
+                static_cast<unsigned>(pos_ - lineStart_ + 1)};
+      auto start = pos_;
+      auto peek = [&](size_t i) {
+         return pos_ + i < text_.size() ? text_[pos_ + i] : '\0';
+      };
+      if(pos_ == text_.size()) {
+         // End of input
+      } else if(char c = peek(0); c == '%' || c == '^' || c == '@') {
+         tok.kind = c == '%'   ? TokenKind::Local
+                    : c == '^' ? TokenKind::Label
+                               : TokenKind::Global;
+         start = ++pos_;
+         while(IsNameChar(peek(0))) pos_++;
+         if(pos_ == start)
+            error(tok, std::string{"expected a name after '"} + c + "'");
+      } else if(IsDigit(c) || (c == '-' && IsDigit(peek(1)))) {
+         tok.kind = TokenKind::Int;
+         pos_++;
+         while(IsDigit(peek(0))) pos_++;
+      } else if(std::isalpha(static_cast<unsigned char>(c)) || c == '_') {
+         tok.kind = TokenKind::Ident;
+         while(IsNameChar(peek(0))) pos_++;
+      } else if(std::string_view{"=:,(){}[]"}.find(c) !=
+                std::string_view::npos) {
+         tok.kind = TokenKind::Punct;
+         pos_++;
+      } else {
+         error(tok, std::string{"unexpected character '"} + c + "'");
+      }
+      tok.text = text_.substr(start, pos_ - start);
+      tok_ = tok;
+   }
+
+   Position mark() const { return {pos_, line_, lineStart_, tok_}; }
+
+   // Skips to the '}' ending the function body without lexing it, which is
+   // faster as there are no braces within a body
+   void skipBody() {
+      skipSpace();
+      while(pos_ < text_.size() && text_[pos_] != '}') {
+         pos_++;
+         skipSpace();
+      }
+      next();
+   }
+
+   void seek(Position const& position) {
+      pos_ = position.pos;
+      line_ = position.line;
+      lineStart_ = position.lineStart;
+      tok_ = position.tok;
+   }
+
+   [[noreturn]] void error(Token const& tok, std::string const& msg) const {
+      throw utils::FatalError(std::string{filename_} + ":" +
+                              std::to_string(tok.line) + ":" +
+                              std::to_string(tok.col) + ": " + msg);
+   }
+
+   Token consume() {
+      auto tok = tok_;
+      next();
+      return tok;
+   }
+
+   bool consumeIf(char c) {
+      if(!tok_.is(c)) return false;
+      next();
+      return true;
+   }
+
+   bool consumeIf(std::string_view keyword) {
+      if(!tok_.is(keyword)) return false;
+      next();
+      return true;
+   }
+
+   void expect(char c) {
+      if(!consumeIf(c)) error(tok_, std::string{"expected '"} + c + "'");
+   }
+
+   void expect(std::string_view keyword) {
+      if(!consumeIf(keyword))
+         error(tok_, "expected '" + std::string{keyword} + "'");
+   }
+
+   Token expect(TokenKind kind, char const* what) {
+      if(tok_.kind != kind) error(tok_, std::string{"expected "} + what);
+      return consume();
+   }
+
+   uint64_t intValue(Token const& tok) const {
+      // Negative values wrap around, they are masked to the type anyways
+      bool negative = tok.text[0] == '-';
+      auto digits = tok.text.substr(negative ? 1 : 0);
+      uint64_t value = 0;
+      auto [ptr, ec] =
+            std::from_chars(digits.data(), digits.data() + digits.size(), value);
+      if(ec != std::errc{}) error(tok, "integer out of range");
+      return negative ? -value : value;
+   }
+
+   /* ===-----------------------------------------------------------------=== */
+   // Types and globals
+   /* ===-----------------------------------------------------------------=== */
+
+   // type := iN | ptr | void | label | struct-name | "[" int "x" type "]"
+   Type* parseType() {
+      auto tok = tok_;
+      if(consumeIf('[')) {
+         auto length = intValue(expect(TokenKind::Int, "an array length"));
+         expect("x");
+         auto* elem = parseType();
+         expect(']');
+         return ArrayType::get(ctx_, elem, length);
+      }
+      if(tok.kind != TokenKind::Ident) error(tok, "expected a type");
+      next();
+      auto name = tok.text;
+      if(name == "ptr") return Type::getPointerTy(ctx_);
+      if(name == "void") return Type::getVoidTy(ctx_);
+      if(name == "label") return Type::getLabelTy(ctx_);
+      if(name.size() > 1 && name[0] == 'i' &&
+         std::all_of(name.begin() + 1, name.end(), IsDigit)) {
+         uint32_t bits = 0;
+         std::from_chars(name.data() + 1, name.data() + name.size(), bits);
+         if(bits == 0 || bits > 64) error(tok, "unsupported integer width");
+         return IntegerType::get(ctx_, bits);
+      }
+      if(auto it = structs_.find(name); it != structs_.end()) return it->second;
+      error(tok, "unknown type " + std::string{name});
+   }
+
+   // struct := "type" struct-name "=" "struct" "{" [type ("," type)*] "}"
+   void parseStruct() {
+      next();
+      auto name = expect(TokenKind::Ident, "a struct name");
+      expect('=');
+      expect("struct");
+      expect('{');
+      std::vector<Type*> elems;
+      if(!tok_.is('}')) {
+         do elems.push_back(parseType());
+         while(consumeIf(','));
+      }
+      expect('}');
+      if(!structs_.emplace(name.text, StructType::get(ctx_, elems)).second)
+         error(name, "redefinition of type " + std::string{name.text});
+   }
+
+   GlobalObject* findGlobal(std::string_view name) {
+      if(auto* fn = CU_.findFunction(name)) return fn;
+      if(auto* gv = CU_.findGlobalVariable(name)) return gv;
+      if(auto kind = FindEnum(name, &Instruction::getIntrinsicName))
+         return CU_.getIntrinsic(*kind);
+      return nullptr;
+   }
+
+   void checkUndefined(Token const& name) {
+      if(findGlobal(name.text))
+         error(name, "redefinition of @" + std::string{name.text});
+   }
+
+   // global := "global" type @name ["=" @function]
+   void parseGlobal() {
+      next();
+      auto* ty = parseType();
+      auto name = expect(TokenKind::Global, "a global name");
+      checkUndefined(name);
+      auto* gv = CU_.CreateGlobalVariable(ty, name.text);
+      if(consumeIf('='))
+         initializers_.emplace_back(
+               gv, expect(TokenKind::Global, "an initializer function"));
+   }
+
+   // function := "function" ["external"] ["noreturn"] type @name
+   //             "(" [%name:type ("," %name:type)*] ")" ["{" block* "}"]
+   void parseFunctionHeader() {
+      next();
+      bool external = consumeIf("external");
+      bool noreturn = consumeIf("noreturn");
+      auto* ret = parseType();
+      auto name = expect(TokenKind::Global, "a function name");
+      expect('(');
+      std::vector<Token> args;
+      std::vector<Type*> params;
+      if(!tok_.is(')')) {
+         do {
+            args.push_back(expect(TokenKind::Local, "an argument"));
+            expect(':');
+            params.push_back(parseType());
+         } while(consumeIf(','));
+      }
+      expect(')');
+      checkUndefined(name);
+      auto* fnTy = FunctionType::get(ctx_, ret, params);
+      auto* fn = CU_.CreateFunction(fnTy, name.text);
+      if(external) fn->setAttrs(Function::Attrs{.external = true});
+      if(noreturn) fn->setAttrs(Function::Attrs{.noreturn = true});
+      for(size_t i = 0; i < args.size(); i++)
+         if(auto argName = StripID(args[i].text); !argName.empty())
+            fn->arg(i)->setName(argName);
+      ++NumFunctionsParsed;
+      if(!tok_.is('{')) return;
+      // Skip over the body, it is read once all the functions are known
+      bodies_.push_back({fn, std::move(args), mark()});
+      skipBody();
+      expect('}');
+   }
+
+   /* ===-----------------------------------------------------------------=== */
+   // Function bodies
+   /* ===-----------------------------------------------------------------=== */
+
+   // body := block* "}", where block := ^name ":" instruction*
+   void parseBody(PendingBody const& body) {
+      utils::trace::Span span{"ParseFunction", "tir-parser", body.fn->name()};
+      fn_ = body.fn;
+      locals_.clear();
+      blocks_.clear();
+      forwardRefs_.clear();
+      for(size_t i = 0; i < body.args.size(); i++)
+         define(body.args[i], fn_->arg(i));
+      expect('{');
+      if(tok_.kind != TokenKind::Label) error(tok_, "expected a block");
+      while(tok_.kind == TokenKind::Label) {
+         auto label = consume();
+         expect(':');
+         auto& ref = getBlock(label);
+         if(ref.defined)
+            error(label, "redefinition of block ^" + std::string{label.text});
+         ref.defined = true;
+         while(tok_.kind != TokenKind::Label && !tok_.is('}')) {
+            if(tok_.kind == TokenKind::End) error(tok_, "expected '}'");
+            parseInstruction(ref.bb);
+         }
+      }
+      expect('}');
+      // Report the first use of a value or block never defined
+      std::optional<Token> undefined;
+      auto firstUse = [&](Token const& tok) {
+         if(!undefined || std::tie(tok.line, tok.col) <
+                                std::tie(undefined->line, undefined->col))
+            undefined = tok;
+      };
+      for(auto& [name, ref] : forwardRefs_) firstUse(ref.use);
+      for(auto& [name, ref] : blocks_)
+         if(!ref.defined) firstUse(ref.use);
+      if(undefined) {
+         auto what = undefined->kind == TokenKind::Label ? "block ^" : "value %";
+         error(*undefined, "use of undefined " + std::string{what} +
+                                 std::string{undefined->text});
+      }
+   }
+
+   BlockEntry& getBlock(Token const& tok) {
+      auto [it, inserted] = blocks_.try_emplace(tok.text);
+      if(inserted) {
+         // The first block created is the entry block
+         it->second = {BasicBlock::Create(ctx_, fn_), tok, false};
+         if(auto name = StripID(tok.text); !name.empty())
+            it->second.bb->setName(name);
+      }
+      return it->second;
+   }
+
+   void define(Token const& tok, Value* val) {
+      if(!locals_.emplace(tok.text, val).second)
+         error(tok, "redefinition of %" + std::string{tok.text});
+      if(auto name = StripID(tok.text); !name.empty() && !val->isFunctionArg())
+         val->setName(name);
+      auto it = forwardRefs_.find(tok.text);
+      if(it == forwardRefs_.end()) return;
+      auto* placeholder = it->second.placeholder;
+      if(placeholder->type() != val->type()) {
+         error(it->second.use, "%" + std::string{tok.text} + " is used as " +
+                                     TypeName(placeholder->type()) +
+                                     " but defined as " + TypeName(val->type()));
+      }
+      placeholder->replaceAllUsesWith(val);
+      forwardRefs_.erase(it);
+   }
+
+   /**
+    * @brief Parses an operand. The type of undef is hint when omitted, and a
+    * value may be used before it is defined if its type is given.
+    *
+    * operand := %name[:type] | ^name | @name | int:type | null | undef[:type]
+    */
+   Value* parseOperand(Type* hint = nullptr) {
+      auto tok = consume();
+      switch(tok.kind) {
+         case TokenKind::Local: {
+            Type* ty = consumeIf(':') ? parseType() : nullptr;
+            auto it = locals_.find(tok.text);
+            Value* val = it != locals_.end() ? it->second : nullptr;
+            if(!val) {
+               auto ref = forwardRefs_.find(tok.text);
+               if(ref != forwardRefs_.end()) {
+                  val = ref->second.placeholder;
+               } else if(ty) {
+                  // A placeholder until the value is defined, see define()
+                  val = Undef::Create(ctx_, ty);
+                  forwardRefs_.emplace(tok.text, ForwardRef{val, tok});
+               } else {
+                  error(tok, "use of undefined value %" + std::string{tok.text});
+               }
+            }
+            if(ty && val->type() != ty) {
+               error(tok, "%" + std::string{tok.text} + " has type " +
+                                TypeName(val->type()) + ", not " + TypeName(ty));
+            }
+            return val;
+         }
+         case TokenKind::Label:
+            return getBlock(tok).bb;
+         case TokenKind::Global:
+            if(auto* go = findGlobal(tok.text)) return go;
+            error(tok, "undefined global @" + std::string{tok.text});
+         case TokenKind::Int: {
+            expect(':');
+            auto tyTok = tok_;
+            auto* ty = parseType();
+            if(!ty->isIntegerType()) error(tyTok, "expected an integer type");
+            return ConstantInt::Create(ctx_, ty, intValue(tok));
+         }
+         case TokenKind::Ident:
+            if(tok.text == "null") return Constant::CreateNullPointer(ctx_);
+            if(tok.text == "undef") {
+               auto* ty = consumeIf(':') ? parseType() : hint;
+               if(!ty) error(tok, "the type of undef is missing");
+               return Undef::Create(ctx_, ty);
+            }
+            [[fallthrough]];
+         default:
+            error(tok, "expected an operand");
+      }
+   }
+
+   BasicBlock* parseBlockOperand() {
+      if(tok_.kind != TokenKind::Label) error(tok_, "expected a block");
+      return getBlock(consume()).bb;
+   }
+
+   template <typename Enum>
+   Enum parseEnum(std::string_view (*getName)(Enum), char const* what) {
+      auto tok = expect(TokenKind::Ident, what);
+      if(auto member = FindEnum(tok.text, getName)) return *member;
+      error(tok, "unknown " + std::string{what} + " " + std::string{tok.text});
+   }
+
+   // instruction := [%name "="] opcode operands, see Instruction::print
+   void parseInstruction(BasicBlock* bb) {
+      std::optional<Token> def;
+      if(tok_.kind == TokenKind::Local) {
+         def = consume();
+         expect('=');
+      }
+      auto op = expect(TokenKind::Ident, "an instruction");
+      auto* ptrTy = Type::getPointerTy(ctx_);
+      Instruction* inst = nullptr;
+      if(op.text == "br") {
+         auto* cond = parseOperand(Type::getInt1Ty(ctx_));
+         expect(',');
+         auto* trueBB = parseBlockOperand();
+         expect(',');
+         auto* falseBB = parseBlockOperand();
+         inst = BranchInst::Create(ctx_, cond, trueBB, falseBB);
+      } else if(op.text == "ret") {
+         // The value is optional, and there is one instruction per line
+         Value* val = nullptr;
+         if(tok_.line == op.line && !tok_.is('}'))
+            val = parseOperand(fn_->getReturnType());
+         inst = ReturnInst::Create(ctx_, val);
+      } else if(op.text == "store") {
+         auto* val = parseOperand();
+         expect("to");
+         inst = StoreInst::Create(ctx_, val, parseOperand(ptrTy));
+      } else if(op.text == "load") {
+         expect(':');
+         auto* ty = parseType();
+         inst = LoadInst::Create(ctx_, ty, parseOperand(ptrTy));
+      } else if(op.text == "call") {
+         auto* ty = consumeIf(':') ? parseType() : Type::getVoidTy(ctx_);
+         auto calleeTok = tok_;
+         auto* callee = dyn_cast<Function>(parseOperand());
+         if(!callee) error(calleeTok, "the callee must be a function");
+         if(callee->getReturnType() != ty) {
+            error(calleeTok, "@" + std::string{calleeTok.text} + " returns " +
+                                   TypeName(callee->getReturnType()));
+         }
+         std::vector<Value*> args;
+         expect('(');
+         if(!tok_.is(')')) {
+            do {
+               auto* hint = args.size() < callee->numParams()
+                                  ? callee->getParamType(args.size())
+                                  : nullptr;
+               args.push_back(parseOperand(hint));
+            } while(consumeIf(','));
+         }
+         expect(')');
+         if(args.size() != callee->numParams()) {
+            error(calleeTok, "@" + std::string{calleeTok.text} + " takes " +
+                                   std::to_string(callee->numParams()) +
+                                   " arguments");
+         }
+         // Printed after the calls to noreturn functions, which are implied
+         consumeIf("noreturn");
+         inst = CallInst::Create(ctx_, callee, args);
+      } else if(op.text == "cmp") {
+         expect(':');
+         parseType();
+         auto pred = parseEnum(&Instruction::getPredicateName, "predicate");
+         auto* lhs = parseOperand();
+         expect(',');
+         auto* rhs = parseOperand(lhs->type());
+         inst = CmpInst::Create(ctx_, pred, lhs, rhs);
+      } else if(op.text == "alloca") {
+         expect("type");
+         inst = AllocaInst::Create(ctx_, parseType());
+      } else if(op.text == "icast") {
+         auto castop = parseEnum(&Instruction::getCastOpName, "cast");
+         auto* val = parseOperand();
+         expect("to");
+         expect("type");
+         inst = ICastInst::Create(ctx_, castop, val, parseType());
+      } else if(op.text == "getelementptr") {
+         expect("type");
+         auto tyTok = tok_;
+         auto* ty = parseType();
+         if(!ty->isStructType() && !ty->isArrayType())
+            error(tyTok, "expected a struct or array type");
+         expect(',');
+         auto* ptr = parseOperand(ptrTy);
+         auto* idxTy = IntegerType::get(ctx_, ptrTy->getSizeInBits());
+         std::vector<Value*> indices;
+         while(consumeIf(',')) {
+            auto idxTok = tok_;
+            indices.push_back(parseOperand(idxTy));
+            if(indices.back()->type()->getSizeInBits() != idxTy->getSizeInBits())
+               error(idxTok, "the index must be as wide as a pointer");
+         }
+         inst = GetElementPtrInst::Create(ctx_, ptr, ty, indices);
+      } else if(op.text == "phi") {
+         auto* ty = parseType();
+         expect(',');
+         std::vector<Value*> values;
+         std::vector<BasicBlock*> preds;
+         // There is one instruction per line, so a phi without incoming
+         // values ends at the end of the line
+         if(tok_.line == op.line) {
+            do {
+               values.push_back(parseOperand(ty));
+               expect('[');
+               preds.push_back(parseBlockOperand());
+               expect(']');
+            } while(consumeIf(','));
+         }
+         inst = PhiNode::Create(ctx_, ty, values, preds);
+      } else if(auto binop = FindEnum(op.text, &Instruction::getBinOpName);
+                binop && *binop != Instruction::BinOp::None) {
+         expect(':');
+         auto* ty = parseType();
+         auto* lhs = parseOperand(ty);
+         expect(',');
+         inst = BinaryInst::Create(ctx_, *binop, lhs, parseOperand(ty));
+      } else {
+         error(op, "unknown instruction " + std::string{op.text});
+      }
+      if(def) {
+         if(inst->type()->isVoidType())
+            error(*def, "cannot name the result of " + std::string{op.text});
+         define(*def, inst);
+      }
+      bb->appendAfterEnd(inst);
+      ++NumInstructionsParsed;
+   }
+
+private:
+   CompilationUnit& CU_;
+   Context& ctx_;
+   std::string_view text_;
+   std::string_view filename_;
+   // The lexer state
+   size_t pos_ = 0;
+   unsigned line_ = 1;
+   size_t lineStart_ = 0;
+   Token tok_{};
+   // The module state
+   std::unordered_map<std::string_view, Type*> structs_;
+   std::vector<std::pair<GlobalVariable*, Token>> initializers_;
+   std::vector<PendingBody> bodies_;
+   // The state of the function body being parsed
+   Function* fn_ = nullptr;
+   std::unordered_map<std::string_view, Value*> locals_;
+   std::unordered_map<std::string_view, BlockEntry> blocks_;
+   std::unordered_map<std::string_view, ForwardRef> forwardRefs_;
+};
+
+} // namespace
+
+void ParseModule(CompilationUnit& CU, std::string_view text,
+                 std::string_view filename) {
+   utils::trace::Span span{"ParseModule", "tir-parser", filename};
+   ModuleParser{CU, text, filename}.parse();
+}
+
+} // namespace tir
@@ -68,6 +68,50 @@ std::ostream& operator<<(std::ostream& os, const Type& type) {
    return type.print(os);
 }
 
+/* ===--------------------------------------------------------------------=== */
+// Hash-consing of the derived types
+/* ===--------------------------------------------------------------------=== */
+
+namespace {
+
+// The hash of a type is the hash of its data, combined with the hash of each
+// child type in order
+void HashCombine(std::size_t& seed, std::size_t value) {
+   seed ^= value + 0x9e3779b97f4a7c15ULL + (seed << 6) + (seed >> 2);
+}
+
+} // namespace
+
+std::size_t TypeKeyHash::operator()(Type const* type) const {
+   std::size_t seed = std::hash<uint32_t>{}(type->getData());
+   auto children = type->getChildTypes();
+   for(uint32_t i = 0; i < children.size; i++)
+      HashCombine(seed, std::hash<Type*>{}(children.array[i]));
+   return seed;
+}
+
+std::size_t TypeKeyHash::operator()(TypeKey const& key) const {
+   std::size_t seed = std::hash<uint32_t>{}(key.data);
+   if(key.first) HashCombine(seed, std::hash<Type*>{}(key.first));
+   if(key.rest)
+      key.rest->for_each(
+            [&](Type* ty) { HashCombine(seed, std::hash<Type*>{}(ty)); });
+   return seed;
+}
+
+bool TypeKeyEqual::operator()(TypeKey const& key, Type const* type) const {
+   if(type->getData() != key.data) return false;
+   auto children = type->getChildTypes();
+   uint32_t size = (key.first ? 1 : 0) + (key.rest ? key.rest->size() : 0);
+   if(children.size != size) return false;
+   uint32_t i = 0;
+   if(key.first && children.array[i++] != key.first) return false;
+   bool equal = true;
+   if(key.rest)
+      key.rest->for_each([&](Type* ty) { equal &= children.array[i++] == ty; });
+   return equal;
+}
+
 Type* StructType::getIndexedType(utils::range_ref<Value*> indices) {
    int i = 0;
    Type* subTy = this;
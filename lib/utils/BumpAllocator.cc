@@ -1,14 +1,83 @@
 #include "utils/BumpAllocator.h"
 
+#include <algorithm>
+#include <cstdint>
 #include <utils/Assert.h>
 
+#include "utils/ThreadPool.h"
+
+#if defined(__linux__)
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
 namespace utils {
 
-CustomBufferResource::CustomBufferResource(size_t size) {
-   buffers_.emplace_back(size, std::malloc(size));
-   cur_buf_ = buffers_.begin();
-   alloc_top_ = cur_buf_->buf;
-   avail_ = size;
+namespace {
+
+constexpr size_t HugePageSize = 2 * 1024 * 1024;
+
+#if defined(__linux__)
+/// @brief Maps size bytes aligned to a huge page, or returns nullptr
+void* MapHugePages(size_t size) {
+   // Over-allocate, then unmap the unaligned head and tail
+   size_t length = size + HugePageSize;
+   void* p = mmap(nullptr,
+                  length,
+                  PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_ANONYMOUS,
+                  -1,
+                  0);
+   if(p == MAP_FAILED) return nullptr;
+   auto begin = reinterpret_cast<uintptr_t>(p);
+   auto aligned = (begin + HugePageSize - 1) & ~(HugePageSize - 1);
+   if(aligned > begin) munmap(p, aligned - begin);
+   if(auto tail = begin + length - (aligned + size))
+      munmap(reinterpret_cast<void*>(aligned + size), tail);
+   // Not fatal if THP is disabled, the pages are just not huge then
+   madvise(reinterpret_cast<void*>(aligned), size, MADV_HUGEPAGE);
+   return reinterpret_cast<void*>(aligned);
+}
+#endif
+
+} // namespace
+
+CustomBufferResource::CustomBufferResource(Options const& options)
+      : options_{options} {
+   assert(options_.initial_size > 0 && options_.growth_factor >= 1);
+   options_.max_chunk_size =
+         std::max(options_.max_chunk_size, options_.initial_size);
+   arenas_[0] = new_arena();
+}
+
+std::unique_ptr<CustomBufferResource::Arena> CustomBufferResource::new_arena() {
+   auto arena = std::make_unique<Arena>();
+   arena->chunks.push_back(new_buffer(options_.initial_size));
+   arena->reserved = options_.initial_size;
+   reset_arena(*arena);
+   return arena;
+}
+
+CustomBufferResource::Buffer CustomBufferResource::new_buffer(size_t size) {
+#if defined(__linux__)
+   if(options_.huge_pages && size >= HugePageSize) {
+      size = (size + HugePageSize - 1) & ~(HugePageSize - 1);
+      if(void* p = MapHugePages(size)) return Buffer{size, p, true};
+   }
+#endif
+   void* p = std::malloc(size);
+   if(!p) throw std::bad_alloc{};
+   return Buffer{size, p, false};
+}
+
+void CustomBufferResource::free_buffer(Buffer const& buf) {
+#if defined(__linux__)
+   if(buf.mapped) {
+      munmap(buf.buf, buf.size);
+      return;
+   }
+#endif
+   std::free(buf.buf);
 }
 
 void* CustomBufferResource::do_allocate(std::size_t bytes, std::size_t alignment) {
@@ -18,43 +87,162 @@ void* CustomBufferResource::do_allocate(std::size_t bytes, std::size_t alignment
    // Do not return the same pointer twice, so set min size to 1
    if(bytes == 0) bytes = 1;
 
-   // Align the next allocation
-   void* p = std::align(alignment, bytes, alloc_top_, avail_);
+   // Pick the sub-arena of the calling thread
+   if(!options_.concurrent) return allocate_from(*arenas_[0], bytes, alignment);
+   int worker = ThreadPool::CurrentWorker();
+   if(worker < 0) {
+      // Any number of threads may be outside of the pool
+      std::lock_guard guard{arena_lock_};
+      return allocate_from(*arenas_[0], bytes, alignment);
+   }
+   if(worker + 2 < MaxArenas) {
+      // Only ever touched by this worker, so no locking is needed
+      auto& arena = arenas_[worker + 1];
+      if(!arena) arena = new_arena();
+      return allocate_from(*arena, bytes, alignment);
+   }
+   // Not lock_, as allocate_from() takes it for the large objects
+   std::lock_guard guard{arena_lock_};
+   auto& arena = arenas_[MaxArenas - 1];
+   if(!arena) arena = new_arena();
+   return allocate_from(*arena, bytes, alignment);
+}
+
+void* CustomBufferResource::allocate_from(Arena& A, size_t bytes, size_t alignment) {
+   // 1. Do we have enough space in the current chunk?
+   void* p = std::align(alignment, bytes, A.top, A.avail);
 
-   // Do we have enough space in the current buffer?
    if(!p) {
-      // Is there no next buffer? Allocate a new one
-      if(std::next(cur_buf_) == buffers_.end()) {
-         size_t new_size = cur_buf_->size * growth_factor;
-         buffers_.emplace_back(new_size, std::malloc(new_size));
-         cur_buf_ = std::prev(buffers_.end());
-      } else {
-         ++cur_buf_;
+      // 2. Large allocations get their own buffer, so they neither waste the
+      // tail of the chunks nor overflow them
+      size_t needed = bytes + alignment - 1;
+      if(needed > options_.max_chunk_size / 4) return allocate_large(bytes, alignment);
+      // 3. Move on to the next chunk that fits, allocating one if there is none
+      do {
+         A.cur++;
+      } while(A.cur < A.chunks.size() && A.chunks[A.cur].size < needed);
+      if(A.cur >= A.chunks.size()) {
+         size_t size = A.chunks.back().size * options_.growth_factor;
+         size = std::max(std::min(size, options_.max_chunk_size), needed);
+         A.chunks.push_back(new_buffer(size));
+         A.cur = A.chunks.size() - 1;
+         A.reserved += A.chunks.back().size;
       }
-      alloc_top_ = cur_buf_->buf;
-      avail_ = cur_buf_->size;
-      p = cur_buf_->buf;
+      A.top = A.chunks[A.cur].buf;
+      A.avail = A.chunks[A.cur].size;
+      p = std::align(alignment, bytes, A.top, A.avail);
+      assert(p && "chunk too small for the allocation");
    }
 
    // Update the allocation pointer and the available space
-   alloc_top_ = static_cast<char*>(alloc_top_) + bytes;
-   avail_ -= bytes;
+   A.top = static_cast<char*>(A.top) + bytes;
+   A.avail -= bytes;
+   A.in_use += bytes;
+   A.allocated += bytes;
 
    // Return the aligned pointer
    return p;
 }
 
+void* CustomBufferResource::allocate_large(size_t bytes, size_t alignment) {
+   auto buf = new_buffer(bytes + alignment - 1);
+   void* p = buf.buf;
+   size_t space = buf.size;
+   p = std::align(alignment, bytes, p, space);
+   std::lock_guard guard{lock_};
+   large_.push_back(buf);
+   large_in_use_ += bytes;
+   large_allocated_ += bytes;
+   return p;
+}
+
+void CustomBufferResource::reset_arena(Arena& A) {
+   A.cur = 0;
+   A.top = A.chunks.front().buf;
+   A.avail = A.chunks.front().size;
+   A.in_use = 0;
+}
+
+void CustomBufferResource::reset() {
+   for(auto& arena : arenas_)
+      if(arena) reset_arena(*arena);
+   std::lock_guard guard{lock_};
+   for(auto& buf : large_) free_buffer(buf);
+   large_.clear();
+   large_in_use_ = 0;
+#ifdef DEBUG
+   clear_all_buffers();
+#endif
+}
+
 void CustomBufferResource::clear_all_buffers() {
    // memset the memory to 0 to catch use-after-free bugs
-   for(auto& buf : buffers_) {
-      std::memset(buf.buf, 0, buf.size);
+   for(auto& arena : arenas_) {
+      if(!arena) continue;
+      for(auto& buf : arena->chunks) {
+         std::memset(buf.buf, 0, buf.size);
+      }
+   }
+}
+
+size_t CustomBufferResource::release(size_t keep) {
+   reset();
+   size_t released = 0;
+   for(auto& arena : arenas_) {
+      if(!arena) continue;
+      auto& chunks = arena->chunks;
+      // 1. Release the (whole) pages of all the chunks. This is done for the
+      // chunks freed below too, as malloc() may not return them to the system.
+#if defined(__linux__)
+      static uintptr_t const page = sysconf(_SC_PAGESIZE);
+      for(auto& buf : chunks) {
+         auto begin = (reinterpret_cast<uintptr_t>(buf.buf) + page - 1) & ~(page - 1);
+         auto end = (reinterpret_cast<uintptr_t>(buf.buf) + buf.size) & ~(page - 1);
+         if(end <= begin) continue;
+         if(madvise(reinterpret_cast<void*>(begin), end - begin, MADV_DONTNEED) ==
+            0)
+            released += end - begin;
+      }
+#endif
+      // 2. Free the chunks past the first keep bytes (but keep the first one)
+      auto it = chunks.begin();
+      size_t kept = it->size;
+      for(++it; it != chunks.end() && kept + it->size <= keep; ++it)
+         kept += it->size;
+      for(auto buf = it; buf != chunks.end(); ++buf) {
+         free_buffer(*buf);
+         arena->reserved -= buf->size;
+      }
+      chunks.erase(it, chunks.end());
+      reset_arena(*arena);
+   }
+   return released;
+}
+
+CustomBufferResource::Stats CustomBufferResource::stats() const {
+   Stats stats;
+   for(auto& arena : arenas_) {
+      if(!arena) continue;
+      stats.bytes_in_use += arena->in_use;
+      stats.bytes_allocated += arena->allocated;
+      stats.bytes_reserved += arena->reserved;
+      stats.num_chunks += arena->chunks.size();
    }
+   std::lock_guard guard{lock_};
+   for(auto& buf : large_) stats.large_object_bytes += buf.size;
+   stats.num_large_objects = large_.size();
+   stats.bytes_in_use += large_in_use_;
+   stats.bytes_allocated += large_allocated_;
+   stats.bytes_reserved += stats.large_object_bytes;
+   return stats;
 }
 
 CustomBufferResource::~CustomBufferResource() {
-   for(auto& buf : buffers_) {
-      std::free(buf.buf);
+   for(auto& arena : arenas_) {
+      if(!arena) continue;
+      for(auto& buf : arena->chunks) free_buffer(buf);
    }
+   for(auto& buf : large_) free_buffer(buf);
 }
 
 } // namespace utils
@@ -0,0 +1,121 @@
+#include "utils/Generator.h"
+
+#include <array>
+#include <new>
+
+#include "utils/Statistic.h"
+
+STATISTIC(NumFramesAllocated, "generator", "Number of coroutine frames allocated");
+STATISTIC(NumFramesRecycled,
+          "generator",
+          "Number of coroutine frames reused from the free lists");
+STATISTIC(NumFramesFromHeap,
+          "generator",
+          "Number of coroutine frames allocated with operator new");
+
+namespace utils::detail {
+
+namespace {
+
+// Frames are rounded up to a multiple of this size, and only the frames of
+// up to NumFrameClasses multiples (i.e., 1 KiB) are recycled
+constexpr std::size_t FrameGranularity = 64;
+constexpr std::size_t NumFrameClasses = 16;
+// Stop recycling a size class past this many free frames
+constexpr unsigned MaxFreeFrames = 1024;
+
+// Every frame is preceded by the resource it came from (or null), padded to
+// keep the frame aligned for operator new
+struct alignas(__STDCPP_DEFAULT_NEW_ALIGNMENT__) FrameHeader {
+   std::pmr::memory_resource* resource;
+};
+
+struct FreeFrame {
+   FreeFrame* next;
+};
+
+struct FrameCache {
+   std::array<FreeFrame*, NumFrameClasses> lists{};
+   std::array<unsigned, NumFrameClasses> counts{};
+   ~FrameCache();
+};
+
+// The cache of the thread, null once the thread is exiting. Kept apart from
+// the cache itself, as frames may still be freed after it is destroyed.
+thread_local FrameCache* threadCache = nullptr;
+
+FrameCache::~FrameCache() {
+   threadCache = nullptr;
+   for(auto* frame : lists) {
+      while(frame) {
+         auto* next = frame->next;
+         ::operator delete(frame);
+         frame = next;
+      }
+   }
+}
+
+FrameCache* GetThreadCache() {
+   thread_local FrameCache cache;
+   thread_local bool initialized = false;
+   if(!initialized) {
+      threadCache = &cache;
+      initialized = true;
+   }
+   return threadCache;
+}
+
+/// @brief The number of FrameGranularity multiples an allocation (with the
+/// header) of size bytes takes. Class n is kept in the free list n - 1.
+std::size_t SizeClass(std::size_t size) {
+   return (size + FrameGranularity - 1) / FrameGranularity;
+}
+
+} // namespace
+
+void* AllocateFrame(std::size_t size, std::pmr::memory_resource* resource) {
+   ++NumFramesAllocated;
+   size += sizeof(FrameHeader);
+   void* p;
+   if(resource) {
+      p = resource->allocate(size, alignof(FrameHeader));
+   } else if(auto cls = SizeClass(size); cls <= NumFrameClasses) {
+      auto* cache = GetThreadCache();
+      if(auto* frame = cache ? cache->lists[cls - 1] : nullptr) {
+         ++NumFramesRecycled;
+         cache->lists[cls - 1] = frame->next;
+         cache->counts[cls - 1]--;
+         p = frame;
+      } else {
+         ++NumFramesFromHeap;
+         p = ::operator new(cls * FrameGranularity);
+      }
+   } else {
+      ++NumFramesFromHeap;
+      p = ::operator new(size);
+   }
+   auto* header = new(p) FrameHeader{resource};
+   return header + 1;
+}
+
+void DeallocateFrame(void* frame, std::size_t size) noexcept {
+   auto* header = static_cast<FrameHeader*>(frame) - 1;
+   auto* resource = header->resource;
+   size += sizeof(FrameHeader);
+   if(resource) {
+      resource->deallocate(header, size, alignof(FrameHeader));
+      return;
+   }
+   auto cls = SizeClass(size);
+   auto* cache = cls <= NumFrameClasses ? threadCache : nullptr;
+   if(!cache || cache->counts[cls - 1] >= MaxFreeFrames) {
+      ::operator delete(header);
+      return;
+   }
+   // The frame may have been allocated on another thread, which is fine as
+   // the frames of a size class are interchangeable
+   cache->lists[cls - 1] = new(header) FreeFrame{cache->lists[cls - 1]};
+   cache->counts[cls - 1]++;
+}
+
+} // namespace utils::detail
@@ -1,13 +1,25 @@
 #include "utils/PassManager.h"
 
 #include <algorithm>
+#include <bit>
+#include <fstream>
+#include <iostream>
 #include <memory>
+#include <condition_variable>
+#include <limits>
 #include <queue>
+#include <set>
 #include <unordered_set>
 
+#if defined(__linux__)
+#include <unistd.h>
+#endif
+
 #include "third-party/CLI11.h"
 #include "utils/BumpAllocator.h"
 #include "utils/Error.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
 
 namespace utils {
 
@@ -41,6 +53,17 @@ inline unsigned sat_sub(unsigned& a, unsigned b) {
    return a;
 }
 
+/// @brief The resident memory of the process in bytes, or 0 if unknown
+size_t CurrentRSS() {
+#if defined(__linux__)
+   static size_t const page = sysconf(_SC_PAGESIZE);
+   std::ifstream statm{"/proc/self/statm"};
+   size_t size = 0, resident = 0;
+   if(statm >> size >> resident) return resident * page;
+#endif
+   return 0;
+}
+
 class DefaultDispatcher final : public PassDispatcher {
 public:
    std::string_view Name() override { return "Default Dispatcher"; }
@@ -64,12 +87,14 @@ CustomBufferResource* Pass::NewHeap(Pass::Lifetime lifetime) {
       throw FatalError("Pass requesting a heap is not running");
    }
    // Grab or create a free heap
+   std::lock_guard guard{PM().heapLock_};
    auto& heap = PM().findHeapFor(this, lifetime);
    // Re/initialize the heap
-   heap.owner = this;
+   PM().setHeapOwner(heap, this);
    heap.lifetime = lifetime;
    heap.refcount = ShouldPreserve() ? 2 : 1;
    heap.get()->reset();
+   heap.get()->set_concurrent(false);
    return heap.get();
 }
 
@@ -78,6 +103,21 @@ BumpAllocator& Pass::NewAlloc(Pass::Lifetime lifetime) {
    if(state != State::Running) {
       throw FatalError("Pass requesting an allocator is not running");
    }
+   // On a worker thread, hand out the workers' heap for this lifetime. The
+   // heap must not be reset by the other workers once handed out.
+   if(ThreadPool::CurrentWorker() != -1) {
+      std::lock_guard guard{PM().heapLock_};
+      auto& alloc = workerAllocs_[lifetime];
+      if(alloc) return *alloc;
+      auto& heap = PM().findHeapFor(this, lifetime, true);
+      PM().setHeapOwner(heap, this);
+      heap.lifetime = lifetime;
+      heap.refcount = ShouldPreserve() ? 2 : 1;
+      heap.get()->reset();
+      heap.get()->set_concurrent(true);
+      alloc = &allocs_.emplace_back(heap.get());
+      return *alloc;
+   }
    // Create the allocator if not exists
    auto* heap = NewHeap(lifetime);
    return allocs_.emplace_back(heap);
@@ -119,35 +159,141 @@ void PassManager::validate() const {
 }
 
 PassManager::HeapResource& PassManager::findHeapFor(Pass* owner,
-                                                    Pass::Lifetime lifetime) {
+                                                    Pass::Lifetime lifetime,
+                                                    bool exclusive) {
    using Lifetime = Pass::Lifetime;
-   for(auto& heap : heaps_) {
-      if(!reuseHeaps_) [[unlikely]]
-         break;
-      /**
-       * Conditions for reusing a resource:
-       * 1) The resource is free (i.e., refcount is 0)
-       * 2) The resource is temporary/managed and we are requesting a
-       *    temporary/managed resource from the same pass.
-       */
-      bool canReuse =
-            /* 1) */
-            (heap.refcount == 0) ||
-            /* 2) */
-            ((lifetime == Lifetime::Temporary || lifetime == Lifetime::Managed) &&
-             heap.lifetime == lifetime && heap.owner == owner);
-      if(canReuse) {
-         if(Diag().Verbose(2))
-            Diag().ReportDebug() << "[HH] Reusing heap " << heap.id;
-         return heap;
+   auto reuse = [this](HeapResource& heap) -> HeapResource& {
+      if(Diag().Verbose(2))
+         Diag().ReportDebug() << "[HH] Reusing heap " << heap.id;
+      if(trace::Enabled())
+         trace::Instant("heap.reuse", "heap", "heap " + std::to_string(heap.id));
+      return heap;
+   };
+   /**
+    * Conditions for reusing a resource:
+    * 1) The resource is temporary/managed and we are requesting a
+    *    temporary/managed resource from the same pass. Unless the heap
+    *    is requested exclusively (i.e., one heap per worker thread).
+    * 2) The resource is free (i.e., refcount is 0)
+    */
+   if(reuseHeaps_) [[likely]] {
+      // 1. Look through the heaps owned by the pass
+      if(!exclusive &&
+         (lifetime == Lifetime::Temporary || lifetime == Lifetime::Managed)) {
+         for(auto* heap : ownedHeaps_[owner]) {
+            if(heap->lifetime != lifetime) continue;
+            takeHeap(*heap);
+            return reuse(*heap);
+         }
       }
+      // 2. Pop the free heap closest in size to what the pass used before
+      auto hint = heapSizeHints_.find(owner);
+      if(auto* heap = popFreeHeap(hint == heapSizeHints_.end() ? 0 : hint->second))
+         return reuse(*heap);
    }
    // 3. Otherwise, create the resource and return it
    auto& heap = heaps_.emplace_back(std::make_unique<CustomBufferResource>());
    if(Diag().Verbose(2)) Diag().ReportDebug() << "[HH] Creating heap " << heap.id;
+   if(trace::Enabled())
+      trace::Instant("heap.create", "heap", "heap " + std::to_string(heap.id));
    return heap;
 }
 
+Pass* PassManager::findPassByName(std::string_view name) const {
+   auto it = passesByName_.find(name);
+   return it == passesByName_.end() ? nullptr : it->second;
+}
+
+void PassManager::setHeapOwner(HeapResource& heap, Pass* owner) {
+   if(heap.owner == owner) return;
+   if(heap.owner) std::erase(ownedHeaps_[heap.owner], &heap);
+   heap.owner = owner;
+   ownedHeaps_[owner].push_back(&heap);
+}
+
+void PassManager::releaseHeap(HeapResource& heap) {
+   if(heap.refcount != 0 || heap.idle) return;
+   if(heap.lifetime == Pass::Lifetime::Managed) heap.owner->GC();
+   auto& hint = heapSizeHints_[heap.owner];
+   hint = std::max(hint, heap.get()->bytes_in_use());
+   pushFreeHeap(heap);
+}
+
+void PassManager::pushFreeHeap(HeapResource& heap, bool trim) {
+   assert(!heap.idle && heap.refcount == 0);
+   // Return the memory to the system past the retain limit
+   auto* resource = heap.get();
+   if(trim && idleHeapBytes_ + resource->bytes_reserved() > heapRetainLimit_) {
+      auto released = resource->release();
+      if(Diag().Verbose(2))
+         Diag().ReportDebug() << "[HH] Releasing " << released << " bytes of heap "
+                              << heap.id;
+      if(trace::Enabled())
+         trace::Instant("heap.release", "heap", "heap " + std::to_string(heap.id));
+   }
+   auto cls = std::min<unsigned>(std::bit_width(resource->bytes_reserved()),
+                                 NumHeapClasses - 1);
+   freeHeaps_[cls].push_back(&heap);
+   heap.idle = true;
+   heap.freeClass = cls;
+   heap.pinned = !trim;
+   idleHeapBytes_ += resource->bytes_reserved();
+}
+
+PassManager::HeapResource* PassManager::popFreeHeap(size_t sizeHint) {
+   // Search upwards from the class of the hint for the smallest heap that
+   // fits, then downwards for the largest heap that does not
+   unsigned hintCls =
+         std::min<unsigned>(std::bit_width(sizeHint), NumHeapClasses - 1);
+   auto tryPop = [this](unsigned cls) -> HeapResource* {
+      if(freeHeaps_[cls].empty()) return nullptr;
+      auto* heap = freeHeaps_[cls].back();
+      takeHeap(*heap);
+      return heap;
+   };
+   for(unsigned cls = hintCls; cls < NumHeapClasses; cls++)
+      if(auto* heap = tryPop(cls)) return heap;
+   for(unsigned cls = hintCls; cls-- > 0;)
+      if(auto* heap = tryPop(cls)) return heap;
+   return nullptr;
+}
+
+void PassManager::takeHeap(HeapResource& heap) {
+   if(!heap.idle) return;
+   heap.idle = false;
+   idleHeapBytes_ -= heap.get()->bytes_reserved();
+   // Take it off its free list, or releaseHeap() would list it twice
+   auto& list = freeHeaps_[heap.freeClass];
+   if(list.back() == &heap)
+      list.pop_back();
+   else
+      std::erase(list, &heap);
+}
+
+void PassManager::enforceMemoryBudget(bool collectPasses) {
+   if(memoryBudget_ == 0 || CurrentRSS() <= memoryBudget_) return;
+   // 1. Return the memory of the free heaps to the system, except for those
+   // freed by Reset(), which may still be read from
+   for(auto& list : freeHeaps_) {
+      for(auto* heap : list) {
+         if(heap->pinned) continue;
+         idleHeapBytes_ -= heap->get()->bytes_reserved();
+         heap->get()->release();
+         idleHeapBytes_ += heap->get()->bytes_reserved();
+      }
+   }
+   if(!collectPasses || CurrentRSS() <= memoryBudget_) return;
+   // 2. Then garbage collect the passes that can recompute their results
+   for(auto* pass : earlyGCPasses_) {
+      if(pass->state != Pass::State::Valid) continue;
+      if(Diag().Verbose(2))
+         Diag().ReportDebug() << "[HH] Memory budget exceeded, collecting pass \""
+                              << pass->Name() << "\"";
+      if(trace::Enabled()) trace::Instant("pass.gc", "heap", pass->Name());
+      pass->GC();
+   }
+}
+
 void PassManager::runPassLifeCycle(Pass& pass, int left, int right,
                                    bool lastIter) {
    if(pass.state != Pass::State::Initialized) {
@@ -161,41 +307,50 @@ void PassManager::runPassLifeCycle(Pass& pass, int left, int right,
                            << pass.Name() << "\": " << pass.Desc();
    }
    pass.state = Pass::State::Running;
-   pass.Run();
+   {
+      trace::Span span{pass.Name().empty() ? pass.Desc() : pass.Name(), "pass"};
+      if(timePasses_ == TimePassesFormat::None && !perfCounters_) [[likely]]
+         pass.Run();
+      else
+         runPassTimed(pass);
+   }
    pass.state = Pass::State::Valid;
-   assert((validate(), true));
 
    // 2. Persist any of the pass's resources and free self-resources
    pass.allocs_.clear();
-   for(auto& heap : heaps_) {
-      if(heap.owner != &pass) continue;
+   pass.workerAllocs_.clear();
+   // The other passes may be running too, see runChunkParallel
+   std::lock_guard guard{heapLock_};
+   auto& edges = depGraph_[&pass];
+   for(auto* heap : ownedHeaps_[&pass]) {
       // 2a. Check if anyone wants to acquire the current pass's resources
-      for(auto pred : depGraph_[&pass].transpose) {
+      for(auto pred : edges.transpose) {
          // lastIter == we should acquire inter-chunk dependencies
          if(!lastIter && (pred->topoIdx < left || pred->topoIdx > right)) continue;
-         heap.refcount++;
+         heap->refcount++;
       }
       // 2b. Free the self-refs and temporary resources
-      if(heap.lifetime == Pass::Lifetime::Managed) {
-         if(sat_sub(heap.refcount, 1) == 0)
-            heap.owner->GC();
-      } else {
-         heap.refcount = 0;
-      }
+      if(heap->lifetime == Pass::Lifetime::Managed)
+         sat_sub(heap->refcount, 1);
+      else
+         heap->refcount = 0;
+      releaseHeap(*heap);
    }
 
    // 3. Free any of the pass's (non self-ref) resources
-   for(auto succ : depGraph_[&pass].forward) {
+   for(auto succ : edges.forward) {
       // lastIter == we should release inter-chunk dependencies
       if(!lastIter && (succ->topoIdx < left || succ->topoIdx > right)) continue;
-      for(auto& heap : heaps_) {
-         if(heap.owner != succ) continue;
-         if(heap.lifetime == Pass::Lifetime::Managed) {
-            if(sat_sub(heap.refcount, 1) == 0)
-               heap.owner->GC();
-         }
+      for(auto* heap : ownedHeaps_[succ]) {
+         if(heap->lifetime != Pass::Lifetime::Managed || heap->refcount == 0)
+            continue;
+         heap->refcount--;
+         releaseHeap(*heap);
       }
    }
+   // Passes are only collected between chunks when running in parallel, as
+   // the passes running alongside may be using them
+   enforceMemoryBudget(ThreadPool::CurrentWorker() == -1);
 
    // 4. Print the heaps-in-use
    if(Diag().Verbose(2)) {
@@ -222,18 +377,34 @@ void PassManager::Reset() {
       pass->enabled = false;
       pass->allocs_.clear();
    }
-   for(auto& heap : heaps_) heap.refcount = 0;
+   for(auto& list : freeHeaps_) list.clear();
+   idleHeapBytes_ = 0;
+   for(auto& heap : heaps_) {
+      heap.refcount = 0;
+      heap.idle = false;
+      // Do not trim, as the heaps may still be read from after a Reset()
+      pushFreeHeap(heap, false);
+   }
    state_ = State::Initialized;
 }
 
 void PassManager::Init() {
    assert(state_ == State::Uninitialized && "PassManager already initialized");
-   std::vector<Pass*> S;
+   // The ready passes are sorted in the order they were added, so that
+   // independent passes keep their relative order (i.e., each AstBuilder runs
+   // right after its Parser)
+   std::unordered_map<Pass const*, unsigned> addedIdx;
+   for(auto& pass : passes_) addedIdx.emplace(pass.get(), addedIdx.size());
+   auto addedLater = [&addedIdx](Pass const* a, Pass const* b) {
+      return addedIdx[a] > addedIdx[b];
+   };
+   std::priority_queue<Pass*, std::vector<Pass*>, decltype(addedLater)> S{
+         addedLater};
    std::unordered_map<Pass*, unsigned> passDeps;
    std::unordered_set<Pass*> visited;
-   S.reserve(passes_.size());
    // 1a. Build the adjacency list of passes
    depGraph_.clear();
+   earlyGCPasses_.clear();
    for(auto& pass : passes_) {
       pass->ComputeDependencies();
       pass->Init();
@@ -243,7 +414,8 @@ void PassManager::Init() {
    for(auto& pass : passes_) {
       // For topological sorting
       passDeps[pass.get()] = depGraph_[pass.get()].forward.size();
-      if(passDeps[pass.get()] == 0) S.push_back(pass.get());
+      if(passDeps[pass.get()] == 0) S.push(pass.get());
+      if(pass->CanGCEarly()) earlyGCPasses_.push_back(pass.get());
       // Find the right dispatcher for this pass
       pass->dispatcher = &DefaultDispatcherInstance;
       for(auto& dispatcher : dispatchers_) {
@@ -256,12 +428,12 @@ void PassManager::Init() {
    // 2. Run a topological sort on the dependency graph
    unsigned PassesAdded = 0;
    while(!S.empty()) {
-      auto* n = *S.begin();
-      S.erase(S.begin());
+      auto* n = S.top();
+      S.pop();
       n->topoIdx = PassesAdded++;
       if(!visited.contains(n)) {
          for(auto* m : depGraph_[n].transpose)
-            if(--passDeps[m] == 0) S.push_back(m);
+            if(--passDeps[m] == 0) S.push(m);
          visited.insert(n);
       }
    }
@@ -274,6 +446,8 @@ void PassManager::Init() {
              [](const std::unique_ptr<Pass>& a, const std::unique_ptr<Pass>& b) {
                 return a->topoIdx < b->topoIdx;
              });
+   // 5. The cached pass lists must follow the new order
+   passesByType_.clear();
    // 6. Print the passes in topological order
    if(Diag().Verbose()) {
       Diag().ReportDebug() << "Passes sorted by topological order:";
@@ -341,9 +515,14 @@ bool PassManager::Run() {
    }
 
    // Run the passes
-   for(auto [left, right, dispatcher] : passChunks_) {
+   for(auto const& chunk : passChunks_) {
+      auto [left, right, dispatcher] = chunk;
+      if(canRunChunkParallel(chunk)) {
+         if(!runChunkParallel(left, right)) return false;
+         continue;
+      }
       auto leftIt = passes_.begin() + left;
-      auto rightIt = passes_.begin() + right;
+      auto rightIt = passes_.begin() + right + 1;
       auto iterated = dispatcher->Iterate(*this);
       auto dIt = iterated.begin();
       if(Diag().Verbose()) {
@@ -370,6 +549,9 @@ bool PassManager::Run() {
             runPassLifeCycle(pass, left, right, dIt == iterated.end());
             if(Diag().hasErrors()) return false;
          }
+         // Ready the passes for the next iteration. After the last one, they
+         // stay valid so passes in later chunks can still get them.
+         if(dIt == iterated.end()) break;
          for(auto it = leftIt; it != rightIt; it++)
             it->get()->state = Pass::State::Initialized;
       }
@@ -378,10 +560,127 @@ bool PassManager::Run() {
    return true;
 }
 
+bool PassManager::canRunChunkParallel(Chunk const& chunk) const {
+   // The timings and perf counts of passes running at the same time cannot be
+   // told apart, so fall back to running one pass at a time then
+   if(!pool_ || serialPasses_) return false;
+   if(timePasses_ != TimePassesFormat::None || perfCounters_) return false;
+   // Only the default dispatcher iterates its chunk exactly once
+   if(chunk.dispatcher != &DefaultDispatcherInstance) return false;
+   unsigned numEnabled = 0, numSafe = 0;
+   for(int i = chunk.left; i <= chunk.right; i++) {
+      if(!passes_[i]->enabled) continue;
+      numEnabled++;
+      if(passes_[i]->IsConcurrentSafe()) numSafe++;
+   }
+   return numEnabled > 1 && numSafe > 0;
+}
+
+/**
+ * Runs the passes of the chunk on the thread pool, each as soon as the passes
+ * it depends on are done. The ready pass earliest in topological order goes
+ * first, and the passes that are not concurrent-safe run one at a time.
+ *
+ * A pass is only started if it is at most RunAheadPerThread * NumThreads()
+ * places after the earliest unfinished pass. Otherwise, while the passes that
+ * are not concurrent-safe run one at a time, the concurrent-safe ones after
+ * them would all run ahead and keep their results alive at once (e.g., every
+ * parse tree waiting for its AstBuilder). The earliest unfinished pass only
+ * depends on finished passes, so it is always ready or running.
+ *
+ * The diagnostics are merged in topological order. Once a pass reports an
+ * error, no pass after it (in that order) is started, and the diagnostics of
+ * the ones that already ran are dropped. The passes before it are still run,
+ * so the result is the same as running the chunk serially.
+ */
+bool PassManager::runChunkParallel(int left, int right) {
+   if(Diag().Verbose()) {
+      Diag().ReportDebug() << "Running chunk [" << left << ", " << right
+                           << "] in parallel on " << NumThreads() << " threads";
+   }
+   // 1. Count the dependencies of each pass in the chunk. The ones outside of
+   // the chunk ran in the previous chunks.
+   std::vector<unsigned> pending(right - left + 1);
+   std::set<int> ready, unfinished;
+   for(int i = left; i <= right; i++) {
+      auto* pass = passes_[i].get();
+      if(!pass->enabled) continue;
+      unfinished.insert(i);
+      for(auto* dep : depGraph_[pass].forward)
+         if(dep->topoIdx >= left) pending[i - left]++;
+      if(pending[i - left] == 0) ready.insert(i);
+   }
+   // 2. Run the passes on all the workers until none is left to run
+   std::mutex lock;
+   std::condition_variable cv;
+   unsigned running = 0;
+   bool exclusiveRunning = false;
+   bool aborted = false;
+   int firstError = std::numeric_limits<int>::max();
+   int const window = RunAheadPerThread * NumThreads();
+   auto next = [&]() -> int {
+      for(int i : ready) {
+         if(i > firstError || i - *unfinished.begin() > window) break;
+         if(!exclusiveRunning || passes_[i]->IsConcurrentSafe()) return i;
+      }
+      return -1;
+   };
+   diagnostics::DiagnosticEngine::ParallelScope diagScope{Diag()};
+   Pool().ParallelFor(NumThreads(), [&](size_t) {
+      std::unique_lock guard{lock};
+      while(true) {
+         int i;
+         while(!aborted && (i = next()) == -1 && running > 0) cv.wait(guard);
+         if(aborted || i == -1) break;
+         auto& pass = *passes_[i];
+         bool exclusive = !pass.IsConcurrentSafe();
+         ready.erase(i);
+         running++;
+         exclusiveRunning |= exclusive;
+         guard.unlock();
+         bool failed = false;
+         try {
+            diagnostics::DiagnosticEngine::TaskScope task{static_cast<size_t>(i)};
+            runPassLifeCycle(pass, left, right, true);
+            failed = Diag().hasErrorsInTask();
+         } catch(...) {
+            guard.lock();
+            aborted = true;
+            cv.notify_all();
+            throw;
+         }
+         guard.lock();
+         running--;
+         unfinished.erase(i);
+         if(exclusive) exclusiveRunning = false;
+         if(failed) firstError = std::min(firstError, i);
+         for(auto* succ : depGraph_[&pass].transpose) {
+            if(!succ->enabled || succ->topoIdx > right) continue;
+            if(--pending[succ->topoIdx - left] == 0) ready.insert(succ->topoIdx);
+         }
+         cv.notify_all();
+      }
+   });
+   diagScope.DiscardTasksAfter(static_cast<size_t>(firstError));
+   enforceMemoryBudget();
+   return firstError == std::numeric_limits<int>::max();
+}
+
+void PassManager::SetNumThreads(unsigned numThreads) {
+   if(state_ != State::Uninitialized)
+      throw FatalError("Cannot set the number of threads after initialization");
+   pool_ = numThreads > 1 ? std::make_unique<ThreadPool>(numThreads) : nullptr;
+}
+
 PassManager::~PassManager() {
+   if(timePasses_ != TimePassesFormat::None) PrintTimingReport(std::cerr);
+   if(perfCounters_) PrintPerfCounterReport(std::cerr);
+   if(Statistic::Enabled()) PrintStatistics(std::cerr);
    // Make sure we free the passes BEFORE we free the heaps because the
    // allocs_ array holds on to the heap for just a bit longer.
    passes_.clear();
+   ownedHeaps_.clear();
+   for(auto& list : freeHeaps_) list.clear();
    heaps_.clear();
 }
 
@@ -0,0 +1,240 @@
+#include <time.h>
+
+#include <algorithm>
+#include <iomanip>
+#include <map>
+#include <ostream>
+#include <string>
+
+#include "utils/BumpAllocator.h"
+#include "utils/Json.h"
+#include "utils/PassManager.h"
+
+namespace utils {
+
+namespace {
+
+using std::chrono::nanoseconds;
+
+/// @brief A sample of the wall clock and the CPU clock of this thread
+struct TimeSample {
+   nanoseconds wall;
+   nanoseconds cpu;
+
+   static TimeSample Now() {
+      timespec ts;
+      clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+      auto cpu = nanoseconds{ts.tv_sec * 1'000'000'000LL + ts.tv_nsec};
+      auto wall = std::chrono::duration_cast<nanoseconds>(
+            std::chrono::steady_clock::now().time_since_epoch());
+      return TimeSample{wall, cpu};
+   }
+};
+
+/// @brief The statistics of all the passes sharing the same name
+struct ReportRow {
+   std::string name;
+   unsigned instances = 0;
+   PassStatistics stats;
+};
+
+double Seconds(nanoseconds ns) { return ns.count() / 1e9; }
+
+/// @brief Merges the statistics of the passes by name, as the front end has
+/// one pass per file. Unnamed passes are identified by their description.
+std::vector<ReportRow> MergePassesByName(
+      std::vector<std::unique_ptr<Pass>> const& passes) {
+   std::map<std::string, ReportRow> rowsByName;
+   for(auto& pass : passes) {
+      auto& stats = pass->Stats();
+      if(stats.iterations == 0) continue;
+      std::string name{pass->Name().empty() ? pass->Desc() : pass->Name()};
+      auto& row = rowsByName[name];
+      row.name = name;
+      row.instances++;
+      row.stats.wallTime += stats.wallTime;
+      row.stats.cpuTime += stats.cpuTime;
+      row.stats.iterations += stats.iterations;
+      row.stats.bytesAllocated += stats.bytesAllocated;
+      row.stats.perf += stats.perf;
+   }
+   std::vector<ReportRow> rows;
+   for(auto& [_, row] : rowsByName) rows.push_back(std::move(row));
+   return rows;
+}
+
+} // namespace
+
+void PassManager::runPassTimed(Pass& pass) {
+   auto bytesAllocated = [this]() {
+      size_t total = 0;
+      for(auto& heap : heaps_) total += heap.resource->bytes_allocated();
+      return total;
+   };
+   auto bytesBefore = bytesAllocated();
+   auto perfBefore = perfCounters_ ? perfCounters_->Read() : PerfCounts{};
+   auto start = TimeSample::Now();
+   pass.Run();
+   auto end = TimeSample::Now();
+   auto perfAfter = perfCounters_ ? perfCounters_->Read() : PerfCounts{};
+   // 1. Accumulate the pass statistics
+   auto& stats = pass.stats_;
+   stats.wallTime += end.wall - start.wall;
+   stats.cpuTime += end.cpu - start.cpu;
+   stats.iterations++;
+   stats.bytesAllocated += bytesAllocated() - bytesBefore;
+   // Scaled counts are estimates and may (rarely) go backwards
+   for(size_t i = 0; i < perfAfter.values.size(); i++)
+      if(perfAfter.values[i] > perfBefore.values[i])
+         stats.perf.values[i] += perfAfter.values[i] - perfBefore.values[i];
+   // 2. Sample the heaps in use before the pass resources are released
+   size_t inUse = 0;
+   for(auto& heap : heaps_)
+      if(heap.refcount > 0) inUse += heap.resource->bytes_in_use();
+   heapPeakInUse_ = std::max(heapPeakInUse_, inUse);
+}
+
+void PassManager::PrintTimingReport(std::ostream& os) const {
+   // 1. Merge the passes by name and sum up the totals
+   auto rows = MergePassesByName(passes_);
+   PassStatistics total;
+   for(auto& row : rows) {
+      total.wallTime += row.stats.wallTime;
+      total.cpuTime += row.stats.cpuTime;
+      total.iterations += row.stats.iterations;
+      total.bytesAllocated += row.stats.bytesAllocated;
+   }
+   CustomBufferResource::Stats heapStats;
+   for(auto& heap : heaps_) {
+      auto stats = heap.resource->stats();
+      heapStats.bytes_reserved += stats.bytes_reserved;
+      heapStats.num_chunks += stats.num_chunks;
+      heapStats.num_large_objects += stats.num_large_objects;
+      heapStats.large_object_bytes += stats.large_object_bytes;
+   }
+   // 2. Sort by descending wall time
+   std::ranges::stable_sort(rows, [](auto const& a, auto const& b) {
+      return a.stats.wallTime > b.stats.wallTime;
+   });
+
+   // 3a. Print the report as JSON
+   if(timePasses_ == TimePassesFormat::Json) {
+      os << "{\n  \"passes\": [";
+      bool first = true;
+      for(auto& row : rows) {
+         os << (first ? "\n" : ",\n") << "    {\"name\": ";
+         PrintJsonString(os, row.name);
+         os << ", \"instances\": " << row.instances
+            << ", \"iterations\": " << row.stats.iterations
+            << ", \"wall_ns\": " << row.stats.wallTime.count()
+            << ", \"cpu_ns\": " << row.stats.cpuTime.count()
+            << ", \"bytes_allocated\": " << row.stats.bytesAllocated << "}";
+         first = false;
+      }
+      os << "\n  ],\n"
+         << "  \"total_wall_ns\": " << total.wallTime.count() << ",\n"
+         << "  \"total_cpu_ns\": " << total.cpuTime.count() << ",\n"
+         << "  \"heap_peak_in_use\": " << heapPeakInUse_ << ",\n"
+         << "  \"heap_reserved\": " << heapStats.bytes_reserved << ",\n"
+         << "  \"heap_chunks\": " << heapStats.num_chunks << ",\n"
+         << "  \"heap_large_objects\": " << heapStats.num_large_objects << ",\n"
+         << "  \"heap_large_object_bytes\": " << heapStats.large_object_bytes
+         << "\n"
+         << "}" << std::endl;
+      return;
+   }
+
+   // 3b. Otherwise, print the report as a table
+   auto percent = [](nanoseconds part, nanoseconds whole) {
+      return whole.count() ? 100.0 * part.count() / whole.count() : 0.0;
+   };
+   auto flags = os.flags();
+   os << "===" << std::string(73, '-') << "===\n"
+      << std::string(26, ' ') << "Pass execution timing report\n"
+      << "===" << std::string(73, '-') << "===\n"
+      << std::fixed << std::setprecision(4)
+      << "  Total Execution Time: " << Seconds(total.wallTime)
+      << " seconds (wall), " << Seconds(total.cpuTime) << " seconds (cpu)\n"
+      << "  Heap peak in use: " << heapPeakInUse_
+      << " bytes, reserved: " << heapStats.bytes_reserved << " bytes in "
+      << heapStats.num_chunks << " chunks and " << heapStats.num_large_objects
+      << " large objects\n\n"
+      << "   ---Wall Time---    ---CPU Time---   --Iters--  ---Bytes---  "
+         "--- Name ---\n";
+   for(auto& row : rows) {
+      os << std::setw(10) << Seconds(row.stats.wallTime) << " (" << std::setw(5)
+         << std::setprecision(1) << percent(row.stats.wallTime, total.wallTime)
+         << "%)" << std::setprecision(4) << std::setw(10)
+         << Seconds(row.stats.cpuTime) << " (" << std::setw(5)
+         << std::setprecision(1) << percent(row.stats.cpuTime, total.cpuTime)
+         << "%)" << std::setprecision(4) << std::setw(11) << row.stats.iterations
+         << std::setw(13) << row.stats.bytesAllocated << "  " << row.name;
+      if(row.instances > 1) os << " (x" << row.instances << ")";
+      os << "\n";
+   }
+   os << std::setw(10) << Seconds(total.wallTime) << " (100.0%)" << std::setw(10)
+      << Seconds(total.cpuTime) << " (100.0%)" << std::setw(11)
+      << total.iterations << std::setw(13) << total.bytesAllocated
+      << "  Total\n"
+      << std::flush;
+   os.flags(flags);
+}
+
+bool PassManager::EnablePerfCounters() {
+   auto counters = std::make_unique<PerfCounterGroup>();
+   if(!counters->Open()) return false;
+   perfCounters_ = std::move(counters);
+   return true;
+}
+
+void PassManager::PrintPerfCounterReport(std::ostream& os) const {
+   // 1. Merge the passes by name and sort by descending cycles
+   auto rows = MergePassesByName(passes_);
+   PerfCounts total;
+   for(auto& row : rows) total += row.stats.perf;
+   std::ranges::stable_sort(rows, [](auto const& a, auto const& b) {
+      return a.stats.perf[PerfEvent::Cycles] > b.stats.perf[PerfEvent::Cycles];
+   });
+
+   // 2. Print the raw counts, then the IPC and the misses per 1000
+   //    instructions (MPKI) to tell memory-bound from compute-bound passes
+   auto printRow = [&](PerfCounts const& perf, std::string_view name) {
+      auto instrs = perf[PerfEvent::Instructions];
+      auto cycles = perf[PerfEvent::Cycles];
+      os << std::setw(14) << cycles << std::setw(14) << instrs << std::setw(7)
+         << std::setprecision(2) << (cycles ? double(instrs) / cycles : 0.0);
+      for(auto event : {PerfEvent::L1DMisses,
+                        PerfEvent::LLCMisses,
+                        PerfEvent::BranchMisses}) {
+         os << std::setw(9);
+         if(!perfCounters_->IsAvailable(event))
+            os << "n/a";
+         else
+            os << (instrs ? 1000.0 * perf[event] / instrs : 0.0);
+      }
+      os << "  " << name << "\n";
+   };
+   auto flags = os.flags();
+   auto precision = os.precision();
+   os << "===" << std::string(73, '-') << "===\n"
+      << std::string(22, ' ') << "Pass hardware performance counters\n"
+      << "===" << std::string(73, '-') << "===\n"
+      << "  User-space events of the main thread. MPKI is misses per 1000 "
+         "instructions.\n\n"
+      << "        Cycles  Instructions    IPC  L1D MPKI LLC MPKI  BR MPKI  "
+         "--- Name ---\n"
+      << std::fixed;
+   for(auto& row : rows) {
+      if(row.instances > 1)
+         printRow(row.stats.perf,
+                  row.name + " (x" + std::to_string(row.instances) + ")");
+      else
+         printRow(row.stats.perf, row.name);
+   }
+   printRow(total, "Total");
+   os << std::flush;
+   os.flags(flags);
+   os.precision(precision);
+}
+
+} // namespace utils
@@ -0,0 +1,129 @@
+#include "utils/PerfCounters.h"
+
+#include <tuple>
+#include <vector>
+
+#if defined(__linux__)
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#endif
+
+namespace utils {
+
+std::string_view PerfEventName(PerfEvent event) {
+   switch(event) {
+      case PerfEvent::Cycles:
+         return "cycles";
+      case PerfEvent::Instructions:
+         return "instructions";
+      case PerfEvent::L1DMisses:
+         return "l1d-misses";
+      case PerfEvent::LLCMisses:
+         return "llc-misses";
+      case PerfEvent::BranchMisses:
+         return "branch-misses";
+      default:
+         return "unknown";
+   }
+}
+
+#if defined(__linux__)
+
+namespace {
+
+/// @brief Gets the perf_event_attr type and config for the event
+std::pair<uint32_t, uint64_t> GetEventConfig(PerfEvent event) {
+   switch(event) {
+      case PerfEvent::Cycles:
+         return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+      case PerfEvent::Instructions:
+         return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS};
+      case PerfEvent::L1DMisses:
+         return {PERF_TYPE_HW_CACHE,
+                 PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+                       (PERF_COUNT_HW_CACHE_RESULT_MISS << 16)};
+      case PerfEvent::LLCMisses:
+         return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES};
+      case PerfEvent::BranchMisses:
+         return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES};
+      default:
+         return {PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES};
+   }
+}
+
+int OpenEvent(PerfEvent event, int groupFd) {
+   perf_event_attr attr{};
+   attr.size = sizeof(attr);
+   std::tie(attr.type, attr.config) = GetEventConfig(event);
+   // Only count this thread in user space, so a perf_event_paranoid of 2
+   // (the default on most distributions) still allows us to count.
+   attr.exclude_kernel = 1;
+   attr.exclude_hv = 1;
+   attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_TOTAL_TIME_ENABLED |
+                      PERF_FORMAT_TOTAL_TIME_RUNNING;
+   // The leader starts disabled so the whole group is enabled atomically
+   attr.disabled = groupFd == -1;
+   // pid = 0 and cpu = -1 counts the calling thread on any CPU
+   return static_cast<int>(
+         syscall(SYS_perf_event_open, &attr, 0, -1, groupFd, 0));
+}
+
+} // namespace
+
+PerfCounterGroup::~PerfCounterGroup() {
+   for(int fd : fds_)
+      if(fd != -1) close(fd);
+}
+
+bool PerfCounterGroup::Open() {
+   if(IsOpen()) return true;
+   // 1. Open the group leader, if this fails then perf is unavailable
+   int leader = OpenEvent(PerfEvent::Cycles, -1);
+   if(leader == -1) return false;
+   fds_[0] = leader;
+   slot_[0] = numOpen_++;
+   // 2. Open the remaining events, skipping the ones that are not supported
+   for(size_t i = 1; i < fds_.size(); i++) {
+      fds_[i] = OpenEvent(static_cast<PerfEvent>(i), leader);
+      if(fds_[i] != -1) slot_[i] = numOpen_++;
+   }
+   // 3. Start counting
+   ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+   ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+   return true;
+}
+
+PerfCounts PerfCounterGroup::Read() const {
+   PerfCounts counts;
+   if(!IsOpen()) return counts;
+   // Layout: nr, time_enabled, time_running, value[nr]
+   std::vector<uint64_t> buf(3 + numOpen_);
+   auto size = buf.size() * sizeof(uint64_t);
+   if(read(fds_[0], buf.data(), size) != static_cast<ssize_t>(size))
+      return counts;
+   uint64_t enabled = buf[1], running = buf[2];
+   for(size_t i = 0; i < slot_.size(); i++) {
+      if(slot_[i] == -1) continue;
+      uint64_t value = buf[3 + slot_[i]];
+      // Scale the count if the counters were multiplexed
+      if(running != 0 && running < enabled)
+         value = static_cast<uint64_t>(static_cast<double>(value) * enabled /
+                                       running);
+      counts.values[i] = value;
+   }
+   return counts;
+}
+
+#else
+
+PerfCounterGroup::~PerfCounterGroup() {}
+
+bool PerfCounterGroup::Open() { return false; }
+
+PerfCounts PerfCounterGroup::Read() const { return PerfCounts{}; }
+
+#endif
+
+} // namespace utils
@@ -0,0 +1,87 @@
+#include "utils/Statistic.h"
+
+#include <algorithm>
+#include <deque>
+#include <iomanip>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <string>
+#include <vector>
+
+namespace utils {
+
+namespace {
+
+struct Registry {
+   std::mutex lock;
+   std::vector<Statistic const*> statistics;
+   // Counters created at runtime and their strings. The deques keep the
+   // addresses of the strings stable.
+   std::deque<std::string> strings;
+   std::deque<std::unique_ptr<Statistic>> owned;
+   std::map<std::pair<std::string, std::string>, Statistic*> byName;
+};
+
+Registry& GetRegistry() {
+   static Registry registry;
+   return registry;
+}
+
+} // namespace
+
+Statistic::Statistic(std::string_view group, std::string_view name,
+                     std::string_view desc)
+      : group_{group}, name_{name}, desc_{desc} {
+   auto& registry = GetRegistry();
+   std::lock_guard guard{registry.lock};
+   registry.statistics.push_back(this);
+}
+
+Statistic& GetStatistic(std::string_view group, std::string_view name,
+                        std::string_view desc) {
+   auto& registry = GetRegistry();
+   std::lock_guard guard{registry.lock};
+   auto key = std::pair{std::string{group}, std::string{name}};
+   if(auto it = registry.byName.find(key); it != registry.byName.end())
+      return *it->second;
+   // The registry owns the strings the counter refers to
+   auto& g = registry.strings.emplace_back(group);
+   auto& n = registry.strings.emplace_back(name);
+   auto& d = registry.strings.emplace_back(desc);
+   auto* stat = registry.owned
+                      .emplace_back(new Statistic{g, n, d, Statistic::NoRegister{}})
+                      .get();
+   registry.statistics.push_back(stat);
+   registry.byName.emplace(std::move(key), stat);
+   return *stat;
+}
+
+void PrintStatistics(std::ostream& os) {
+   auto& registry = GetRegistry();
+   std::lock_guard guard{registry.lock};
+   std::vector<Statistic const*> stats;
+   for(auto* stat : registry.statistics)
+      if(stat->value() != 0) stats.push_back(stat);
+   std::ranges::sort(stats, [](auto* a, auto* b) {
+      return std::pair{a->group(), a->name()} < std::pair{b->group(), b->name()};
+   });
+   // Align the values and the group names into columns
+   size_t valueWidth = 1, groupWidth = 1;
+   for(auto* stat : stats) {
+      valueWidth = std::max(valueWidth, std::to_string(stat->value()).size());
+      groupWidth = std::max(groupWidth, stat->group().size());
+   }
+   os << "===" << std::string(73, '-') << "===\n"
+      << std::string(27, ' ') << "... Statistics Collected ...\n"
+      << "===" << std::string(73, '-') << "===\n\n";
+   for(auto* stat : stats) {
+      os << std::setw(valueWidth) << stat->value() << " " << std::left
+         << std::setw(groupWidth) << stat->group() << std::right << " - "
+         << stat->desc() << "\n";
+   }
+   os << std::flush;
+}
+
+} // namespace utils
@@ -0,0 +1,108 @@
+#include "utils/ThreadPool.h"
+
+#include <utility>
+
+#include "utils/Assert.h"
+
+namespace utils {
+
+namespace {
+thread_local int currentWorker = -1;
+} // namespace
+
+ThreadPool::ThreadPool(unsigned numThreads) {
+   if(numThreads == 0) numThreads = 1;
+   for(unsigned i = 0; i < numThreads; i++)
+      workers_.emplace_back(std::make_unique<Worker>());
+   // Start the threads only once all the workers exist, as they steal
+   for(unsigned i = 0; i < numThreads; i++)
+      workers_[i]->thread = std::thread{&ThreadPool::workerLoop, this, i};
+}
+
+ThreadPool::~ThreadPool() {
+   {
+      std::lock_guard guard{lock_};
+      stop_ = true;
+   }
+   wake_.notify_all();
+   for(auto& worker : workers_) worker->thread.join();
+}
+
+int ThreadPool::CurrentWorker() { return currentWorker; }
+
+void ThreadPool::ParallelFor(size_t n, std::function<void(size_t)> const& fn) {
+   assert(CurrentWorker() == -1 && "ParallelFor called from a worker thread");
+   if(n == 0) return;
+   // 1. Deal out contiguous ranges of tasks to the workers
+   {
+      std::lock_guard guard{lock_};
+      job_ = &fn;
+      error_ = nullptr;
+      remaining_ = n;
+      size_t numWorkers = workers_.size();
+      for(size_t w = 0; w < numWorkers; w++) {
+         std::lock_guard workerGuard{workers_[w]->lock};
+         for(size_t i = w * n / numWorkers; i < (w + 1) * n / numWorkers; i++)
+            workers_[w]->tasks.push_back(i);
+      }
+      generation_++;
+   }
+   wake_.notify_all();
+   // 2. Wait for all the tasks to finish
+   std::unique_lock guard{lock_};
+   done_.wait(guard, [this]() { return remaining_ == 0; });
+   job_ = nullptr;
+   if(error_) std::rethrow_exception(std::exchange(error_, nullptr));
+}
+
+bool ThreadPool::popTask(unsigned id, size_t& task) {
+   // 1. Pop from the front of our own deque
+   {
+      auto& self = *workers_[id];
+      std::lock_guard guard{self.lock};
+      if(!self.tasks.empty()) {
+         task = self.tasks.front();
+         self.tasks.pop_front();
+         return true;
+      }
+   }
+   // 2. Otherwise, steal from the back of the other workers' deques
+   for(size_t i = 1; i < workers_.size(); i++) {
+      auto& victim = *workers_[(id + i) % workers_.size()];
+      std::lock_guard guard{victim.lock};
+      if(!victim.tasks.empty()) {
+         task = victim.tasks.back();
+         victim.tasks.pop_back();
+         return true;
+      }
+   }
+   return false;
+}
+
+void ThreadPool::workerLoop(unsigned id) {
+   currentWorker = static_cast<int>(id);
+   size_t seen = 0;
+   while(true) {
+      {
+         std::unique_lock guard{lock_};
+         wake_.wait(guard, [&]() { return stop_ || generation_ != seen; });
+         if(stop_) return;
+         seen = generation_;
+      }
+      size_t task;
+      while(popTask(id, task)) {
+         try {
+            (*job_)(task);
+         } catch(...) {
+            std::lock_guard guard{lock_};
+            if(!error_) error_ = std::current_exception();
+         }
+         if(--remaining_ == 0) {
+            std::lock_guard guard{lock_};
+            done_.notify_all();
+         }
+      }
+   }
+}
+
+} // namespace utils
@@ -0,0 +1,129 @@
+#include "utils/Trace.h"
+
+#include <unistd.h>
+
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <vector>
+
+#include "utils/Json.h"
+
+namespace utils::trace {
+
+std::atomic<bool> detail::enabled{false};
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+struct Event {
+   std::string name, cat, detail;
+   char phase;
+   Clock::time_point start, end;
+   int tid;
+};
+
+/// @brief The trace session, which flushes the events when destroyed at exit
+struct Session {
+   std::mutex lock;
+   std::vector<Event> events;
+   std::string path;
+   Clock::time_point epoch;
+   ~Session() { Finish(); }
+};
+
+Session& GetSession() {
+   static Session session;
+   return session;
+}
+
+/// @brief Gets a small, dense ID for the calling thread
+int ThreadId() {
+   static std::atomic<int> nextTid{0};
+   thread_local int tid = nextTid++;
+   return tid;
+}
+
+double Micros(Clock::duration d) {
+   return std::chrono::duration<double, std::micro>(d).count();
+}
+
+void Record(Event&& event) {
+   auto& session = GetSession();
+   std::lock_guard guard{session.lock};
+   session.events.push_back(std::move(event));
+}
+
+} // namespace
+
+void detail::RecordSpan(std::string_view name, std::string_view cat,
+                        std::string_view detail, Clock::time_point start,
+                        Clock::time_point end) {
+   Record(Event{std::string{name},
+                std::string{cat},
+                std::string{detail},
+                'X',
+                start,
+                end,
+                ThreadId()});
+}
+
+void detail::RecordInstant(std::string_view name, std::string_view cat,
+                           std::string_view detail) {
+   auto now = Clock::now();
+   Record(Event{std::string{name},
+                std::string{cat},
+                std::string{detail},
+                'i',
+                now,
+                now,
+                ThreadId()});
+}
+
+void Start(std::string path) {
+   auto& session = GetSession();
+   std::lock_guard guard{session.lock};
+   session.path = std::move(path);
+   session.epoch = Clock::now();
+   session.events.clear();
+   detail::enabled = true;
+}
+
+void Finish() {
+   if(!detail::enabled.exchange(false)) return;
+   auto& session = GetSession();
+   std::lock_guard guard{session.lock};
+   std::ofstream os{session.path};
+   if(!os) {
+      std::cerr << "Error: cannot write trace to " << session.path << std::endl;
+      return;
+   }
+   auto pid = getpid();
+   os << std::fixed << std::setprecision(3) << "{\"traceEvents\":[";
+   bool first = true;
+   for(auto& e : session.events) {
+      os << (first ? "\n" : ",\n") << "{\"name\":";
+      PrintJsonString(os, e.name);
+      os << ",\"cat\":";
+      PrintJsonString(os, e.cat);
+      os << ",\"ph\":\"" << e.phase << "\",\"ts\":" << Micros(e.start - session.epoch);
+      if(e.phase == 'X')
+         os << ",\"dur\":" << Micros(e.end - e.start);
+      else
+         os << ",\"s\":\"t\"";
+      os << ",\"pid\":" << pid << ",\"tid\":" << e.tid;
+      if(!e.detail.empty()) {
+         os << ",\"args\":{\"detail\":";
+         PrintJsonString(os, e.detail);
+         os << "}";
+      }
+      os << "}";
+      first = false;
+   }
+   os << "\n],\"displayTimeUnit\":\"ms\"}\n";
+   session.events.clear();
+}
+
+} // namespace utils::trace
@@ -13,6 +13,7 @@
 #include "semantic/Semantic.h"
 #include "third-party/CLI11.h"
 #include "utils/PassManager.h"
+#include "utils/Trace.h"
 #include "utils/Utils.h"
 
 using std::string_view;
@@ -26,6 +27,8 @@ namespace passes::joos1 {
 /* ===--------------------------------------------------------------------=== */
 
 void Parser::Run() {
+   auto traceFile = SourceManager::getFileName(file_);
+   utils::trace::Span span{"Parser", "frontend", traceFile};
    // Print the file being parsed if verbose
    if(PM().Diag().Verbose()) {
       auto os = PM().Diag().ReportDebug();
@@ -39,7 +42,7 @@ void Parser::Run() {
    Joos1WParser parser{file_, alloc, &PM().Diag()};
    int result = parser.parse(tree_);
    // If no parse tree was generated, report error if not already reported
-   if((result != 0 || !tree_) && !PM().Diag().hasErrors())
+   if((result != 0 || !tree_) && !PM().Diag().hasErrorsInTask())
       PM().Diag().ReportError(SourceRange{file_}) << "failed to parse file";
    if(result != 0 || !tree_) return;
    // If the parse tree is poisoned, report error
@@ -113,6 +116,8 @@ void AstBuilder::Init() {
 }
 
 void AstBuilder::Run() {
+   auto traceFile = SourceManager::getFileName(dep.File());
+   utils::trace::Span span{"AstBuilder", "frontend", traceFile};
    // Get the parse tree and the semantic analysis
    auto& sema = GetPass<AstContext>().Sema();
    auto* PT = dep.Tree();
@@ -261,8 +266,8 @@ REGISTER_PASS_NS(passes::joos1, AstContext);
 REGISTER_PASS_NS(passes::joos1, Linker);
 REGISTER_PASS_NS(passes::joos1, PrintAST);
 
-Pass& NewJoos1WParserPass(PassManager& PM, SourceFile file, Pass* prev) {
-   return PM.AddPass<passes::joos1::Parser>(file, prev);
+Pass& NewJoos1WParserPass(PassManager& PM, SourceFile file) {
+   return PM.AddPass<passes::joos1::Parser>(file);
 }
 
 Pass& NewAstBuilderPass(PassManager& PM, Pass* depends) {
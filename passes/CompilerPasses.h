@@ -19,11 +19,12 @@ using utils::PassManager;
 
 class Parser final : public Pass {
 public:
-   Parser(PassManager& PM, SourceFile file, Pass* prev) noexcept
-         : Pass(PM), file_{file}, prev_{prev} {}
+   Parser(PassManager& PM, SourceFile file) noexcept : Pass(PM), file_{file} {}
    string_view Name() const override { return ""; }
    string_view Desc() const override { return "Joos1W Lexing and Parsing"; }
    void Run() override;
+   // Each file is lexed and parsed on its own
+   bool IsConcurrentSafe() const override { return true; }
    parsetree::Node* Tree() { return tree_; }
    SourceFile File() { return file_; }
 
@@ -33,12 +34,9 @@ private:
    void checkNonAscii(std::string_view str);
 
 private:
-   void ComputeDependencies() override {
-      if(prev_) AddDependency(*prev_);
-   }
+   void ComputeDependencies() override {}
    SourceFile file_;
    parsetree::Node* tree_;
-   Pass* prev_;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -58,6 +56,12 @@ private:
 
 /* ===--------------------------------------------------------------------=== */
 
+/**
+ * Builds the AST of one file. Unlike the Parser, it is not concurrent-safe,
+ * so the builders run one at a time even with -j: they all go through the
+ * single ast::Semantic of the AstContext, whose allocator, lexical scope state
+ * and type-uniquing maps are not locked.
+ */
 class AstBuilder final : public Pass {
 public:
    AstBuilder(PassManager& PM, Parser& dep) noexcept;
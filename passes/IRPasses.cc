@@ -4,7 +4,10 @@
 #include "target/TargetDesc.h"
 #include "tir/BasicBlock.h"
 #include "tir/CompilationUnit.h"
+#include "tir/Instructions.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
 
 using namespace utils;
 
@@ -21,12 +24,17 @@ public:
       return pass.Tag() == static_cast<int>(PassTag::BasicBlockPass);
    }
    Generator<void*> Iterate(PassManager& PM) override {
-      auto& CU = PM.FindPass<passes::IRContext>().CU();
-      for(auto* F : CU.functions()) {
+      auto& IRC = PM.FindPass<passes::IRContext>();
+      std::optional<trace::Span> span;
+      for(auto* F : IRC.CU().functions()) {
+         if(!IRC.ShouldVisit(F)) continue;
+         IRC.CU().materialize(F);
          if(!F->hasBody()) continue;
          for(auto* BB : F->body()) {
-            bb_ = BB;
+            // Yield before moving to BB, see utils::PassDispatcher::Iterate
             co_yield nullptr;
+            bb_ = BB;
+            span.emplace("BasicBlock", "dispatch", F->name());
          }
       }
    }
@@ -43,11 +51,16 @@ public:
       return pass.Tag() == static_cast<int>(PassTag::FunctionPass);
    }
    Generator<void*> Iterate(PassManager& PM) override {
-      auto& CU = PM.FindPass<passes::IRContext>().CU();
-      for(auto* F : CU.functions()) {
+      auto& IRC = PM.FindPass<passes::IRContext>();
+      std::optional<trace::Span> span;
+      for(auto* F : IRC.CU().functions()) {
+         if(!IRC.ShouldVisit(F)) continue;
+         IRC.CU().materialize(F);
          if(!F->hasBody()) continue;
-         fn_ = F;
+         // Yield before moving to F, see utils::PassDispatcher::Iterate
          co_yield nullptr;
+         fn_ = F;
+         span.emplace("Function", "dispatch", F->name());
       }
    }
    tir::Function* Fn() const { return fn_; }
@@ -56,6 +69,40 @@ private:
    tir::Function* fn_;
 };
 
+/**
+ * @brief Dispatches the parallel-safe function passes (see
+ * passes::Function::IsParallelSafe) when the pass manager has more than one
+ * thread. The chunk is iterated once, and each pass runs over all functions
+ * at once on the thread pool. The remaining function passes are left to the
+ * FnDispatcher, so the IR is only ever modified serially.
+ */
+class ParallelFnDispatcher final : public utils::PassDispatcher {
+public:
+   ParallelFnDispatcher(PassManager& PM) : PM_{PM} {}
+   std::string_view Name() override { return "Parallel Function Dispatcher"; }
+   bool CanDispatch(Pass& pass) override {
+      if(PM_.NumThreads() <= 1) return false;
+      if(pass.Tag() != static_cast<int>(PassTag::FunctionPass)) return false;
+      return cast<passes::Function>(pass)->IsParallelSafe();
+   }
+   Generator<void*> Iterate(PassManager& PM) override {
+      auto& IRC = PM.FindPass<passes::IRContext>();
+      fns_.clear();
+      // Materialize here, as the functions are then visited in parallel
+      for(auto* F : IRC.CU().functions()) {
+         if(!IRC.ShouldVisit(F)) continue;
+         IRC.CU().materialize(F);
+         if(F->hasBody()) fns_.push_back(F);
+      }
+      co_yield nullptr;
+   }
+   std::vector<tir::Function*> const& Functions() const { return fns_; }
+
+private:
+   PassManager& PM_;
+   std::vector<tir::Function*> fns_;
+};
+
 class CUDispatcher final : public utils::PassDispatcher {
 public:
    std::string_view Name() override { return "CompilationUnit Dispatcher"; }
@@ -64,6 +111,8 @@ public:
    }
    Generator<void*> Iterate(PassManager& PM) override {
       auto& CU = PM.FindPass<passes::IRContext>().CU();
+      // The compilation unit passes may look at any function
+      CU.materializeAll();
       cu_ = &CU;
       co_yield nullptr;
    }
@@ -73,6 +122,59 @@ private:
    tir::CompilationUnit* cu_;
 };
 
+/* ===--------------------------------------------------------------------=== */
+// Per-kind instruction counts for --stats
+/* ===--------------------------------------------------------------------=== */
+
+std::string_view GetInstKindName(tir::Instruction const* inst) {
+   using namespace tir;
+   if(dyn_cast<BranchInst>(inst)) return "br";
+   if(dyn_cast<ReturnInst>(inst)) return "ret";
+   if(dyn_cast<StoreInst>(inst)) return "store";
+   if(dyn_cast<LoadInst>(inst)) return "load";
+   if(dyn_cast<CallInst>(inst)) return "call";
+   if(dyn_cast<BinaryInst>(inst)) return "binop";
+   if(dyn_cast<CmpInst>(inst)) return "cmp";
+   if(dyn_cast<ICastInst>(inst)) return "icast";
+   if(dyn_cast<AllocaInst>(inst)) return "alloca";
+   if(dyn_cast<GetElementPtrInst>(inst)) return "gep";
+   if(dyn_cast<PhiNode>(inst)) return "phi";
+   return "other";
+}
+
+/**
+ * @brief Adds the number of instructions of each kind in the basic blocks to
+ * the "<when>.<kind>" counters of the pass. Only call if statistics are on.
+ */
+template <typename Range>
+void CountInstructions(Pass const& pass, std::string_view when, Range&& bbs) {
+   std::unordered_map<std::string_view, uint64_t> counts;
+   for(tir::BasicBlock* bb : bbs)
+      for(auto* inst : *bb) counts[GetInstKindName(inst)]++;
+   for(auto [kind, count] : counts) {
+      auto name = std::string{when} + "." + std::string{kind};
+      auto desc = "Number of " + std::string{kind} + " instructions " +
+                  std::string{when} + " the pass";
+      utils::GetStatistic(pass.Name(), name, desc) += count;
+   }
+}
+
+/// @brief Invalidates the analyses of fn not in PA and records if fn changed
+void Invalidate(passes::IRContext& IRC, tir::Function* fn,
+                analysis::PreservedAnalyses const& PA) {
+   if(PA.areAllPreserved()) return;
+   IRC.AM().invalidate(fn, PA);
+   IRC.MarkChanged(fn);
+}
+
+/// @brief Yields the basic blocks of all the functions with a body
+template <typename Range>
+utils::Generator<tir::BasicBlock*> AllBlocks(Range&& fns) {
+   for(auto* F : fns)
+      if(F->hasBody())
+         for(auto* BB : F->body()) co_yield BB;
+}
+
 } // namespace
 
 /* ===--------------------------------------------------------------------=== */
@@ -89,15 +191,63 @@ passes::IRContext::IRContext(PassManager& PM) noexcept
         CU_{ctx_} {}
 
 void passes::BasicBlock::Run() {
-   runOnBasicBlock(GetDispatcher<BBDispatcher>()->BB());
+   auto* BB = GetDispatcher<BBDispatcher>()->BB();
+   auto& IRC = GetPass<IRContext>();
+   if(!utils::Statistic::Enabled()) [[likely]] {
+      Invalidate(IRC, BB->parent(), runOnBasicBlock(BB));
+      return;
+   }
+   CountInstructions(*this, "before", std::views::single(BB));
+   Invalidate(IRC, BB->parent(), runOnBasicBlock(BB));
+   CountInstructions(*this, "after", std::views::single(BB));
 }
 
 void passes::Function::Run() {
-   runOnFunction(GetDispatcher<FnDispatcher>()->Fn());
+   auto& IRC = GetPass<IRContext>();
+   // Run over all the functions at once on the thread pool
+   if(auto* PD = GetDispatcherIf<ParallelFnDispatcher>()) {
+      auto& fns = PD->Functions();
+      bool stats = utils::Statistic::Enabled();
+      if(stats) CountInstructions(*this, "before", AllBlocks(fns));
+      {
+         // Report in function order, as the FnDispatcher would
+         diagnostics::DiagnosticEngine::ParallelScope diagScope{PM().Diag()};
+         // The functions share the types, constants and use lists
+         tir::Context::ConcurrentScope concurrent{IRC.CU().ctx()};
+         PM().Pool().ParallelFor(fns.size(), [&](size_t i) {
+            diagnostics::DiagnosticEngine::TaskScope task{i};
+            trace::Span span{"Function", "dispatch", fns[i]->name()};
+            Invalidate(IRC, fns[i], runOnFunction(fns[i]));
+         });
+      }
+      if(stats) CountInstructions(*this, "after", AllBlocks(fns));
+      return;
+   }
+   auto* F = GetDispatcher<FnDispatcher>()->Fn();
+   if(!utils::Statistic::Enabled()) [[likely]] {
+      Invalidate(IRC, F, runOnFunction(F));
+      return;
+   }
+   CountInstructions(*this, "before", F->body());
+   Invalidate(IRC, F, runOnFunction(F));
+   CountInstructions(*this, "after", F->body());
 }
 
 void passes::CompilationUnit::Run() {
-   runOnCompilationUnit(GetDispatcher<CUDispatcher>()->CU());
+   auto* CU = GetDispatcher<CUDispatcher>()->CU();
+   auto& IRC = GetPass<IRContext>();
+   auto invalidateAll = [&IRC](analysis::PreservedAnalyses const& PA) {
+      if(PA.areAllPreserved()) return;
+      IRC.AM().invalidateAll(PA);
+      IRC.MarkChanged(nullptr);
+   };
+   if(!utils::Statistic::Enabled()) [[likely]] {
+      invalidateAll(runOnCompilationUnit(CU));
+      return;
+   }
+   CountInstructions(*this, "before", AllBlocks(CU->functions()));
+   invalidateAll(runOnCompilationUnit(CU));
+   CountInstructions(*this, "after", AllBlocks(CU->functions()));
 }
 
 /* ===--------------------------------------------------------------------=== */
@@ -108,6 +258,8 @@ REGISTER_PASS_NS(passes, IRContext);
 
 void AddTIRDispatchers(utils::PassManager& PM) {
    PM.AddDispatcher<::BBDispatcher>();
+   // Must come before the FnDispatcher to take the parallel-safe passes
+   PM.AddDispatcher<::ParallelFnDispatcher>(PM);
    PM.AddDispatcher<::FnDispatcher>();
    PM.AddDispatcher<::CUDispatcher>();
 }
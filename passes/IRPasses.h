@@ -1,8 +1,13 @@
 #pragma once
 
+#include <mutex>
+#include <optional>
 #include <unordered_map>
+#include <unordered_set>
+#include <utility>
 
 #include "AllPasses.h"
+#include "analysis/AnalysisManager.h"
 #include "mc/InstSelectNode.h"
 #include "target/TargetDesc.h"
 #include "target/TargetInfo.h"
@@ -13,6 +18,20 @@
 
 namespace passes {
 
+/// @brief A set of changed functions, or all functions
+struct ChangeSet {
+   bool all = false;
+   std::unordered_set<tir::Function const*> fns;
+   bool empty() const { return !all && fns.empty(); }
+   bool contains(tir::Function const* fn) const {
+      return all || fns.contains(fn);
+   }
+   void merge(ChangeSet const& other) {
+      all |= other.all;
+      if(!all) fns.insert(other.fns.begin(), other.fns.end());
+   }
+};
+
 class IRContext final : public utils::Pass {
 public:
    IRContext(utils::PassManager& PM) noexcept;
@@ -20,6 +39,9 @@ public:
    std::string_view Desc() const override { return "TIR + MIR Context Lifetime"; }
    void Init() override {}
    void Run() override {}
+   /// @brief Frees the cached analysis results, they are recomputed on demand
+   void GC() override { am_.clear(); }
+   bool CanGCEarly() const override { return true; }
    tir::CompilationUnit& CU() { return CU_; }
    tir::CompilationUnit const& CU() const { return CU_; }
    target::TargetDesc const& TD() const { return TD_; }
@@ -32,6 +54,40 @@ public:
    void AddMIRFunction(tir::Function const* fn, mc::MCFunction* mirFn) {
       mirFuncMap_.emplace(fn, mirFn);
    }
+   /// @brief The cached analysis results of the TIR functions
+   analysis::AnalysisManager& AM() { return am_; }
+   /// @brief Records that a pass changed fn (or every function if nullptr)
+   void MarkChanged(tir::Function const* fn) {
+      std::lock_guard guard{changedLock_};
+      if(fn)
+         changed_.fns.insert(fn);
+      else
+         changed_.all = true;
+   }
+   /// @brief Returns the functions changed so far and starts a new set
+   ChangeSet TakeChanges() {
+      std::lock_guard guard{changedLock_};
+      return std::exchange(changed_, ChangeSet{});
+   }
+   /// @brief Adds back the changes previously taken with TakeChanges()
+   void RestoreChanges(ChangeSet const& changes) {
+      std::lock_guard guard{changedLock_};
+      changed_.merge(changes);
+   }
+   /**
+    * @brief Restricts the function and basic block passes to the functions in
+    * filter (or all functions if nullopt).
+    * @return The previous filter
+    */
+   std::optional<ChangeSet> SetVisitFilter(std::optional<ChangeSet> filter) {
+      return std::exchange(visit_, std::move(filter));
+   }
+   /// @brief The current filter set with SetVisitFilter()
+   std::optional<ChangeSet> const& VisitFilter() const { return visit_; }
+   /// @returns True if the function passes should run on fn
+   bool ShouldVisit(tir::Function const* fn) const {
+      return !visit_ || visit_->contains(fn);
+   }
    ~IRContext() override {}
 
 private:
@@ -45,6 +101,10 @@ private:
    tir::Context ctx_;
    tir::CompilationUnit CU_;
    std::unordered_map<tir::Function const*, mc::MCFunction*> mirFuncMap_;
+   analysis::AnalysisManager am_;
+   std::mutex changedLock_;
+   ChangeSet changed_;
+   std::optional<ChangeSet> visit_;
 };
 
 class BasicBlock : public utils::Pass {
@@ -56,7 +116,10 @@ public:
    }
 
 protected:
-   virtual void runOnBasicBlock(tir::BasicBlock* bb) = 0;
+   /// @brief Runs the pass on bb
+   /// @return The analyses of the parent function still valid afterwards,
+   /// which must be PreservedAnalyses::All() if bb was left unchanged
+   virtual analysis::PreservedAnalyses runOnBasicBlock(tir::BasicBlock* bb) = 0;
    void ComputeDependencies() override final {
       AddDependency(GetPass<IRContext>());
       ComputeMoreDependencies();
@@ -71,9 +134,23 @@ public:
    int Tag() const override final {
       return static_cast<int>(PassTag::FunctionPass);
    }
+   /**
+    * @brief Returns true if runOnFunction() only modifies fn and only writes
+    * to per-function state of the pass. Such passes are run on many functions
+    * at once when the pass manager has more than one thread, with the
+    * tir::Context in concurrent mode (see tir::Context::setConcurrent).
+    *
+    * A pass that creates values must not be parallel-safe: the value IDs come
+    * from the counter of the context, so they (and the printed names) would
+    * depend on the order the threads run in.
+    */
+   virtual bool IsParallelSafe() const { return false; }
 
 protected:
-   virtual void runOnFunction(tir::Function* fn) = 0;
+   /// @brief Runs the pass on fn
+   /// @return The analyses of fn still valid afterwards, which must be
+   /// PreservedAnalyses::All() if fn was left unchanged
+   virtual analysis::PreservedAnalyses runOnFunction(tir::Function* fn) = 0;
    void ComputeDependencies() override final {
       AddDependency(GetPass<IRContext>());
       ComputeMoreDependencies();
@@ -90,7 +167,11 @@ public:
    }
 
 protected:
-   virtual void runOnCompilationUnit(tir::CompilationUnit* cu) = 0;
+   /// @brief Runs the pass on cu
+   /// @return The analyses (of every function) still valid afterwards, which
+   /// must be PreservedAnalyses::All() if cu was left unchanged
+   virtual analysis::PreservedAnalyses runOnCompilationUnit(
+         tir::CompilationUnit* cu) = 0;
    void ComputeDependencies() override final {
       AddDependency(GetPass<IRContext>());
       ComputeMoreDependencies();
@@ -0,0 +1,180 @@
+#include "Pipeline.h"
+
+#include "AllPasses.h"
+#include "IRPasses.h"
+#include "utils/Statistic.h"
+
+using namespace passes;
+
+STATISTIC(NumFixpointIterations,
+          "pipeline",
+          "Number of iterations of the repeated pipeline groups");
+
+namespace {
+
+// Stop a repeated group from looping forever if the passes never settle
+constexpr unsigned MaxFixpointIterations = 32;
+
+class PipelineParser final {
+public:
+   PipelineParser(std::string_view str, utils::PassManager& PM, std::ostream& err)
+         : str_{str}, PM_{PM}, err_{err} {}
+
+   std::optional<Pipeline> parse() {
+      Pipeline result;
+      if(!parseList(result, 0)) return std::nullopt;
+      // i.e., an unmatched ')' or a pass name right after a group
+      if(pos_ != str_.size()) {
+         error("unexpected '" + std::string{str_[pos_]} + "'");
+         return std::nullopt;
+      }
+      return result;
+   }
+
+private:
+   // list := element ("," element)*
+   bool parseList(Pipeline& result, unsigned depth) {
+      while(true) {
+         if(!parseElement(result, depth)) return false;
+         if(pos_ == str_.size() || str_[pos_] != ',') return true;
+         pos_++;
+      }
+   }
+
+   // element := pass-name | "(" list ")" ["*"]
+   bool parseElement(Pipeline& result, unsigned depth) {
+      if(pos_ < str_.size() && str_[pos_] == '(') {
+         pos_++;
+         PipelineElement group;
+         if(!parseList(group.group, depth + 1)) return false;
+         if(pos_ == str_.size() || str_[pos_] != ')')
+            return error("missing ')'");
+         pos_++;
+         if(pos_ < str_.size() && str_[pos_] == '*') {
+            group.repeat = true;
+            pos_++;
+         }
+         if(!group.group.empty()) result.push_back(std::move(group));
+         return true;
+      }
+      auto end = str_.find_first_of(",()*", pos_);
+      if(end == std::string_view::npos) end = str_.size();
+      auto name = str_.substr(pos_, end - pos_);
+      pos_ = end;
+      if(pos_ < str_.size() && (str_[pos_] == '(' || str_[pos_] == '*'))
+         return error("unexpected '" + std::string{str_[pos_]} + "'");
+      if(name.empty()) return true;
+      if(!PM_.HasPass(name)) {
+         err_ << "Error: Unknown pass " << name << std::endl;
+         return false;
+      }
+      // Only the TIR passes report changes and can be repeated
+      auto tag = static_cast<PassTag>(PM_.FindPass(name).Tag());
+      if(depth > 0 && tag != PassTag::BasicBlockPass &&
+         tag != PassTag::FunctionPass && tag != PassTag::CompilationUnitPass) {
+         err_ << "Error: Pass " << name
+              << " cannot be used in a pipeline group" << std::endl;
+         return false;
+      }
+      result.emplace_back().pass = name;
+      return true;
+   }
+
+   bool error(std::string const& msg) {
+      err_ << "Error: Invalid pipeline at column " << pos_ + 1 << ": " << msg
+           << std::endl;
+      return false;
+   }
+
+private:
+   std::string_view str_;
+   utils::PassManager& PM_;
+   std::ostream& err_;
+   size_t pos_ = 0;
+};
+
+bool RunElement(utils::PassManager& PM, PipelineElement const& element);
+
+/**
+ * @brief Runs the group until a fixpoint is reached. The first iteration
+ * visits the same functions as the enclosing group, the next ones only the
+ * functions changed during the previous iteration.
+ */
+bool RunRepeatedGroup(utils::PassManager& PM, PipelineElement const& group) {
+   auto& IRC = PM.FindPass<IRContext>();
+   // Set aside the changes of the enclosing group, these are added back after
+   auto outerChanges = IRC.TakeChanges();
+   auto outerFilter = IRC.VisitFilter();
+   ChangeSet allChanges;
+   unsigned iteration = 0;
+   for(; iteration < MaxFixpointIterations; iteration++) {
+      ++NumFixpointIterations;
+      for(auto const& element : group.group) RunElement(PM, element);
+      auto changes = IRC.TakeChanges();
+      if(changes.empty()) break;
+      allChanges.merge(changes);
+      // Functions outside of the enclosing filter are never visited, so only
+      // the changed functions within it need to be visited again
+      if(changes.all)
+         IRC.SetVisitFilter(outerFilter);
+      else
+         IRC.SetVisitFilter(std::move(changes));
+   }
+   if(iteration == MaxFixpointIterations && PM.Diag().Verbose()) {
+      PM.Diag().ReportDebug() << "Pipeline group " << group
+                              << " did not reach a fixpoint after "
+                              << MaxFixpointIterations << " iterations";
+   }
+   IRC.SetVisitFilter(std::move(outerFilter));
+   IRC.RestoreChanges(outerChanges);
+   IRC.RestoreChanges(allChanges);
+   return !allChanges.empty();
+}
+
+bool RunElement(utils::PassManager& PM, PipelineElement const& element) {
+   if(element.repeat) return RunRepeatedGroup(PM, element);
+   if(element.isGroup()) return RunPipeline(PM, element.group);
+   auto& IRC = PM.FindPass<IRContext>();
+   auto outerChanges = IRC.TakeChanges();
+   PM.Reset();
+   PM.EnablePass(element.pass);
+   PM.Run();
+   auto changes = IRC.TakeChanges();
+   IRC.RestoreChanges(outerChanges);
+   IRC.RestoreChanges(changes);
+   return !changes.empty();
+}
+
+} // namespace
+
+std::optional<Pipeline> passes::ParsePipeline(std::string_view str,
+                                              utils::PassManager& PM,
+                                              std::ostream& err) {
+   return PipelineParser{str, PM, err}.parse();
+}
+
+std::string_view passes::GetOptLevelPipeline(unsigned level) {
+   switch(level) {
+      case 0:
+         return "";
+      case 1:
+         return "globaldce,mem2reg,simplifycfg";
+      default:
+         return "globaldce,mem2reg,(simplifycfg,mem2reg)*,globaldce";
+   }
+}
+
+bool passes::RunPipeline(utils::PassManager& PM, Pipeline const& pipeline) {
+   bool changed = false;
+   for(auto const& element : pipeline) changed |= RunElement(PM, element);
+   return changed;
+}
+
+std::ostream& passes::operator<<(std::ostream& os,
+                                 PipelineElement const& element) {
+   if(!element.isGroup()) return os << element.pass;
+   os << "(";
+   for(size_t i = 0; i < element.group.size(); i++)
+      os << (i ? "," : "") << element.group[i];
+   return os << (element.repeat ? ")*" : ")");
+}
@@ -0,0 +1,57 @@
+#pragma once
+
+#include <optional>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "utils/PassManager.h"
+
+namespace passes {
+
+/**
+ * @brief An element of the optimization pipeline: either a single pass or a
+ * group of elements. A repeated group is run until none of its passes
+ * changes the IR (i.e., a fixpoint is reached).
+ */
+struct PipelineElement {
+   std::string pass;
+   std::vector<PipelineElement> group;
+   bool repeat = false;
+   bool isGroup() const { return pass.empty(); }
+};
+
+using Pipeline = std::vector<PipelineElement>;
+
+/**
+ * @brief Parses a pipeline string. The grammar is:
+ *    pipeline := element ("," element)*
+ *    element  := pass-name | "(" pipeline ")" ["*"]
+ * Empty elements are ignored (i.e., "a,,b" is "a,b"). Groups may only
+ * contain TIR passes.
+ *
+ * @param str The pipeline string
+ * @param PM The pass manager to look the pass names up in
+ * @param err The stream to print the error message to
+ * @return The pipeline, or nullopt if the string is invalid
+ */
+std::optional<Pipeline> ParsePipeline(std::string_view str,
+                                      utils::PassManager& PM,
+                                      std::ostream& err);
+
+/// @brief Gets the pipeline string of the optimization level (0 to 2)
+std::string_view GetOptLevelPipeline(unsigned level);
+
+/**
+ * @brief Runs the TIR passes of the pipeline in order. Repeated groups run
+ * the function and basic block passes only on the functions that changed
+ * during the previous iteration of the group.
+ *
+ * @return True if any pass changed the IR
+ */
+bool RunPipeline(utils::PassManager& PM, Pipeline const& pipeline);
+
+std::ostream& operator<<(std::ostream& os, PipelineElement const& element);
+
+} // namespace passes
@@ -0,0 +1,48 @@
+#include "AnalysisManager.h"
+
+#include "utils/Statistic.h"
+
+using namespace analysis;
+
+STATISTIC(NumAnalysesComputed, "analysis", "Number of analysis results computed");
+STATISTIC(NumAnalysesReused,
+          "analysis",
+          "Number of cached analysis results reused");
+STATISTIC(NumAnalysesInvalidated,
+          "analysis",
+          "Number of analysis results invalidated");
+
+void AnalysisManager::invalidate(tir::Function const* fn,
+                                 PreservedAnalyses const& PA) {
+   if(PA.areAllPreserved()) return;
+   std::lock_guard guard{lock_};
+   auto it = results_.lower_bound(Key{fn, nullptr});
+   while(it != results_.end() && it->first.first == fn) {
+      if(PA.isPreserved(it->first.second)) {
+         ++it;
+         continue;
+      }
+      it = results_.erase(it);
+      ++NumAnalysesInvalidated;
+   }
+}
+
+void AnalysisManager::invalidateAll(PreservedAnalyses const& PA) {
+   if(PA.areAllPreserved()) return;
+   std::lock_guard guard{lock_};
+   NumAnalysesInvalidated += std::erase_if(results_, [&](auto const& kv) {
+      return !PA.isPreserved(kv.first.second);
+   });
+}
+
+void AnalysisManager::clear() {
+   std::lock_guard guard{lock_};
+   results_.clear();
+}
+
+void AnalysisManager::countLookup(bool cached) {
+   if(cached)
+      ++NumAnalysesReused;
+   else
+      ++NumAnalysesComputed;
+}
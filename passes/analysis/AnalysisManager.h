@@ -0,0 +1,145 @@
+#pragma once
+
+#include <concepts>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <unordered_set>
+#include <utility>
+
+#include "utils/BumpAllocator.h"
+
+namespace tir {
+class Function;
+} // namespace tir
+
+namespace analysis {
+
+/// @brief Identifies an analysis by the address of its static ID member
+using AnalysisKey = void const*;
+
+/**
+ * @brief An analysis computes a Result for a single TIR function. It must
+ * declare a static ID member (whose address identifies the analysis), the
+ * Result type and a static Run() that allocates the result out of alloc.
+ */
+template <typename T>
+concept AnalysisType = requires(tir::Function* fn, BumpAllocator& alloc) {
+   typename T::Result;
+   { &T::ID } -> std::convertible_to<AnalysisKey>;
+   { T::Run(fn, alloc) } -> std::same_as<std::unique_ptr<typename T::Result>>;
+};
+
+/**
+ * @brief The set of analyses a transform kept valid. Transforms return this
+ * from runOnFunction() (etc.) so the cached results that are still valid can
+ * be reused by later passes instead of being recomputed.
+ */
+class PreservedAnalyses final {
+public:
+   /// @brief Nothing was changed, all analyses are still valid
+   static PreservedAnalyses All() {
+      PreservedAnalyses PA;
+      PA.all_ = true;
+      return PA;
+   }
+   /// @brief No analysis is known to still be valid
+   static PreservedAnalyses None() { return PreservedAnalyses{}; }
+   /// @brief Marks the analysis T as preserved
+   template <AnalysisType T>
+   PreservedAnalyses& preserve() {
+      if(!all_) preserved_.insert(&T::ID);
+      return *this;
+   }
+   /// @brief Only keep the analyses preserved by both this and other
+   void intersect(PreservedAnalyses const& other) {
+      if(other.all_) return;
+      if(all_) {
+         *this = other;
+         return;
+      }
+      std::erase_if(preserved_,
+                    [&](AnalysisKey key) { return !other.isPreserved(key); });
+   }
+   bool isPreserved(AnalysisKey key) const {
+      return all_ || preserved_.contains(key);
+   }
+   template <AnalysisType T>
+   bool isPreserved() const {
+      return isPreserved(&T::ID);
+   }
+   bool areAllPreserved() const { return all_; }
+
+private:
+   bool all_ = false;
+   std::unordered_set<AnalysisKey> preserved_;
+};
+
+/**
+ * @brief Caches the results of analyses per function until a transform
+ * invalidates them. Each result is allocated out of its own heap, so it can
+ * outlive the pass manager heaps and be freed on its own. Results may be
+ * requested from several threads at once (i.e., for different functions).
+ */
+class AnalysisManager final {
+public:
+   /// @brief Gets the result of analysis T on fn, computing it if not cached
+   template <AnalysisType T>
+   typename T::Result& getResult(tir::Function* fn);
+   /// @brief Gets the cached result of analysis T on fn, or nullptr
+   template <AnalysisType T>
+   typename T::Result* getCachedResult(tir::Function const* fn);
+   /// @brief Frees the results on fn that are not preserved by PA
+   void invalidate(tir::Function const* fn, PreservedAnalyses const& PA);
+   /// @brief Frees the results on all functions that are not preserved by PA
+   void invalidateAll(PreservedAnalyses const& PA);
+   /// @brief Frees all the results
+   void clear();
+
+private:
+   struct Entry {
+      utils::CustomBufferResource heap;
+      BumpAllocator alloc{&heap};
+      // Declared last so the result is destroyed before its heap
+      std::unique_ptr<void, void (*)(void*)> result{nullptr, nullptr};
+   };
+   using Key = std::pair<tir::Function const*, AnalysisKey>;
+   void countLookup(bool cached);
+
+private:
+   std::mutex lock_;
+   std::map<Key, std::unique_ptr<Entry>> results_;
+};
+
+/* ===--------------------------------------------------------------------=== */
+// Template implementations
+/* ===--------------------------------------------------------------------=== */
+
+template <AnalysisType T>
+typename T::Result* AnalysisManager::getCachedResult(tir::Function const* fn) {
+   std::lock_guard guard{lock_};
+   auto it = results_.find(Key{fn, &T::ID});
+   if(it == results_.end()) return nullptr;
+   return static_cast<typename T::Result*>(it->second->result.get());
+}
+
+template <AnalysisType T>
+typename T::Result& AnalysisManager::getResult(tir::Function* fn) {
+   if(auto* result = getCachedResult<T>(fn)) {
+      countLookup(true);
+      return *result;
+   }
+   countLookup(false);
+   // Compute the result outside of the lock, as the analysis may be run on
+   // several functions in parallel
+   auto entry = std::make_unique<Entry>();
+   entry->result = {T::Run(fn, entry->alloc).release(), [](void* p) {
+                       delete static_cast<typename T::Result*>(p);
+                    }};
+   std::lock_guard guard{lock_};
+   // Keep the existing result if another thread computed it first
+   auto [it, _] = results_.try_emplace(Key{fn, &T::ID}, std::move(entry));
+   return *static_cast<typename T::Result*>(it->second->result.get());
+}
+
+} // namespace analysis
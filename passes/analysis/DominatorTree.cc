@@ -1,5 +1,7 @@
 #include "DominatorTree.h"
 
+#include <algorithm>
+
 #include "diagnostics/Diagnostics.h"
 #include "tir/BasicBlock.h"
 #include "tir/Constant.h"
@@ -22,22 +24,24 @@ DominatorTree::DominatorTree(tir::Function* func, BumpAllocator& alloc)
    computeDominators(func);
    computeFrontiers(func);
    for(auto bb : func->body())
-      if(doms[bb] != bb) domt[doms[bb]].push_back(bb);
+      if(doms[bb] && doms[bb] != bb) domt[doms[bb]].push_back(bb);
 }
 
 std::ostream& DominatorTree::print(std::ostream& os) const {
    // Print the dominator tree
    os << "*** Dominator Tree ***\n";
    for(auto b : func->body()) {
-      if(doms.contains(b)) {
+      if(auto* idom = doms.lookup(b)) {
          os << "  Dom(";
          b->printName(os) << ") = ";
-         doms.at(b)->printName(os) << std::endl;
+         idom->printName(os) << std::endl;
       }
    }
    // Print the dominance frontier
    os << "*** Dominance Frontier ***\n";
-   for(auto [b, frontier] : frontiers) {
+   for(auto b : func->body()) {
+      auto& frontier = frontiers.lookup(b);
+      if(frontier.empty()) continue;
       os << "  DF(";
       b->printName(os) << ") = {";
       bool first = true;
@@ -64,7 +68,7 @@ void DominatorTree::computeDominators(Function* func) {
       for(auto b : func->reversePostOrder()) {
          BasicBlock* newIdom = nullptr;
          for(auto pred : b->predecessors()) {
-            if(doms.contains(pred)) {
+            if(doms[pred]) {
                if(!newIdom) {
                   newIdom = pred;
                } else {
@@ -73,7 +77,7 @@ void DominatorTree::computeDominators(Function* func) {
             }
          }
          if(!newIdom) continue;
-         if(!doms.contains(b) || doms[b] != newIdom) {
+         if(doms[b] != newIdom) {
             doms[b] = newIdom;
             changed = true;
          }
@@ -94,16 +98,13 @@ tir::BasicBlock* DominatorTree::intersect(tir::BasicBlock* b1,
 
 void DominatorTree::computeFrontiers(Function* func) {
    for(auto b : func->body()) {
-      int numPreds = 0;
-      for(auto p : b->predecessors()) {
-         (void)p;
-         numPreds++;
-      }
-      if(numPreds < 2) continue;
+      if(b->predecessors().size() < 2) continue;
       for(auto pred : b->predecessors()) {
          BasicBlock* runner = pred;
-         while(runner != doms[b]) {
-            frontiers[runner].insert(b);
+         while(runner && runner != doms[b]) {
+            auto& frontier = frontiers[runner];
+            if(std::ranges::find(frontier, b) == frontier.end())
+               frontier.push_back(b);
             runner = doms[runner];
          }
       }
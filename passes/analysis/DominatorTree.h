@@ -1,10 +1,10 @@
 #pragma once
 
 #include <memory>
-#include <unordered_set>
 
 #include "../IRPasses.h"
 #include "tir/TIR.h"
+#include "tir/ValueMap.h"
 #include "utils/BumpAllocator.h"
 
 namespace analysis {
@@ -23,22 +23,19 @@ public:
    // Get the dominance frontier of block b
    auto& DF(tir::BasicBlock* b) { return frontiers[b]; }
    // Get the immediate dominator of block b, nullptr if it does not exist
-   tir::BasicBlock* getIDom(tir::BasicBlock* b) {
-      return doms.contains(b) ? doms.at(b) : nullptr;
-   }
+   tir::BasicBlock* getIDom(tir::BasicBlock* b) { return doms.lookup(b); }
    // Get the children of the dominator tree
    auto& getChildren(tir::BasicBlock* b) { return domt[b]; }
 
 private:
    tir::Function* func;
    BumpAllocator& alloc;
-   std::pmr::unordered_map<tir::BasicBlock*, tir::BasicBlock*> doms{alloc};
-   std::pmr::unordered_map<tir::BasicBlock*, int> poidx{alloc};
-   std::pmr::unordered_map<tir::BasicBlock*,
-                           std::pmr::unordered_set<tir::BasicBlock*>>
-         frontiers{alloc};
-   std::pmr::unordered_map<tir::BasicBlock*, std::pmr::vector<tir::BasicBlock*>>
-         domt{alloc};
+   tir::BlockMap<tir::BasicBlock*> doms{func, alloc.resource()};
+   tir::BlockMap<int> poidx{func, alloc.resource()};
+   // The frontiers are small, so these are kept as vectors
+   tir::BlockMap<std::pmr::vector<tir::BasicBlock*>> frontiers{func,
+                                                               alloc.resource()};
+   tir::BlockMap<std::pmr::vector<tir::BasicBlock*>> domt{func, alloc.resource()};
 
    void computePostorderIdx(tir::Function* func);
    void computeDominators(tir::Function* func);
@@ -48,22 +45,43 @@ private:
 
 } // namespace analysis
 
+namespace analysis {
+
+/// @brief The dominator tree as an analysis, see AnalysisManager
+struct DominatorTreeAnalysis {
+   using Result = DominatorTree;
+   static inline char ID = 0;
+   static std::unique_ptr<DominatorTree> Run(tir::Function* fn,
+                                             BumpAllocator& alloc) {
+      return std::make_unique<DominatorTree>(fn, alloc);
+   }
+};
+
+} // namespace analysis
+
 namespace passes {
 
+/**
+ * @brief Computes the dominator tree of each function, cached by the
+ * analysis manager of the IRContext until a transform does not preserve it.
+ */
 class DominatorTreeWrapper final : public Function {
 public:
    DominatorTreeWrapper(utils::PassManager& PM) noexcept : passes::Function(PM) {}
    std::string_view Name() const override { return "dt"; }
    std::string_view Desc() const override { return "Dominator tree analysis"; }
-   auto& DT() { return *dt_; }
-   void GC() override { dt_ = nullptr; }
+   bool IsParallelSafe() const override { return true; }
+   // Get the dominator tree of the function, computing it if not cached
+   analysis::DominatorTree& DT(tir::Function* Fn) {
+      auto& AM = GetPass<IRContext>().AM();
+      return AM.getResult<analysis::DominatorTreeAnalysis>(Fn);
+   }
 
 private:
-   void runOnFunction(tir::Function* Fn) override {
-      auto& alloc = NewAlloc(Lifetime::Managed);
-      dt_ = std::make_unique<analysis::DominatorTree>(Fn, alloc);
+   analysis::PreservedAnalyses runOnFunction(tir::Function* Fn) override {
+      DT(Fn);
+      return analysis::PreservedAnalyses::All();
    }
-   std::unique_ptr<analysis::DominatorTree> dt_;
 };
 
 } // namespace passes
@@ -6,12 +6,16 @@
 #include "../IRPasses.h"
 #include "target/TargetDesc.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
 
 using std::string_view;
 using utils::Pass;
 using utils::PassManager;
 using namespace mc;
 
+STATISTIC(NumPatternsMatched, "isel", "Number of nodes matched to a pattern");
+STATISTIC(NumMatchFallbacks, "isel", "Number of nodes left unmatched");
+
 class InstSelect : public Pass {
 public:
    InstSelect(PassManager& PM) noexcept : Pass(PM) {}
@@ -100,10 +104,12 @@ InstSelectNode* InstSelect::matchAndReplace(InstSelectNode* root) {
          mc::MatchOptions MO{*TD, def, operands, nodesToDelete, root};
          if(pat->matches(MO)) {
             // Now we build the new node
+            ++NumPatternsMatched;
             return root->selectPattern(MO);
          }
       }
    }
+   ++NumMatchFallbacks;
    return root;
 }
 
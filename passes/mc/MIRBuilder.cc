@@ -1,9 +1,14 @@
+#include <unordered_set>
+#include <vector>
+
 #include "mc/InstSelectNode.h"
 #include "mc/MCFunction.h"
 #include "../IRPasses.h"
 #include "tir/Constant.h"
+#include "tir/ValueMap.h"
 #include "utils/BumpAllocator.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
 
 class MIRBuilder;
 using std::string_view;
@@ -15,6 +20,27 @@ using namespace tir;
 using ISN = InstSelectNode;
 using T = ISN::Type;
 
+STATISTIC(NumFunctions, "mirbuilder", "Number of functions lowered to MIR");
+STATISTIC(NumDAGNodes, "mirbuilder", "Number of DAG nodes built");
+
+namespace {
+
+// Count the unique nodes reachable from the roots of the function's subgraphs
+size_t CountDAGNodes(mc::MCFunction* MCF) {
+   std::unordered_set<ISN*> visited;
+   std::vector<ISN*> worklist;
+   for(auto& mbb : MCF->subgraphs()) worklist.push_back(mbb.root);
+   while(!worklist.empty()) {
+      auto* node = worklist.back();
+      worklist.pop_back();
+      if(!node || !visited.insert(node).second) continue;
+      for(auto* child : node->childNodes()) worklist.push_back(child);
+   }
+   return visited.size();
+}
+
+} // namespace
+
 class MIRBuilder : public Pass {
 public:
    MIRBuilder(PassManager& PM) noexcept : Pass(PM) {}
@@ -28,6 +54,8 @@ public:
       for(auto* F : CU.functions()) {
          if(!F->hasBody()) continue;
          buildMCFunction(F);
+         ++NumFunctions;
+         if(utils::Statistic::Enabled()) NumDAGNodes += CountDAGNodes(MCF);
          if(dumpDot) {
             std::ofstream out{std::string{F->name()} + ".dag.dot"};
             MCF->printDot(out);
@@ -59,7 +87,7 @@ private:
    InstSelectNode* buildCC(tir::Instruction::Predicate);
    // Allocate (if not exist) or get (if exist) a virtual register index
    // corresponding to the given value
-   int findOrAllocVirtReg(tir::Value* v);
+   int findOrAllocVirtReg(tir::Instruction* v);
    // Allocate (if not exist) or get (if exist) a stack slot index chunk
    // corresponding to the given alloca instruction
    InstSelectNode::StackSlot findOrAllocStackSlot(tir::AllocaInst* alloca);
@@ -76,11 +104,14 @@ private:
    BumpAllocator* alloc_ = nullptr;
    MCFunction* MCF;
    tir::BasicBlock* curbb;
-   // Maps TIR instruction -> node, this is not cleared per BB
-   std::unordered_map<tir::Value*, InstSelectNode*> instMap;
-   std::unordered_map<tir::Value*, int> vregMap;
-   std::unordered_map<tir::AllocaInst*, InstSelectNode::StackSlot> allocaMap;
-   std::unordered_map<tir::BasicBlock*, InstSelectNode*> bbMap;
+   // Maps TIR instruction -> node, this is not cleared per BB. The maps are
+   // reset for each function.
+   tir::ValueMap<InstSelectNode*> instMap;
+   // Maps TIR instruction -> vreg index, 0 if it has none
+   tir::ValueMap<int> vregMap;
+   // Maps alloca -> stack slot, the index is 0 if it has none
+   tir::ValueMap<InstSelectNode::StackSlot> allocaMap;
+   tir::BlockMap<InstSelectNode*> bbMap;
    int highestVregIdx = 0;
    int highestStackSlotIdx = 0;
 };
@@ -97,6 +128,10 @@ void MIRBuilder::buildMCFunction(tir::Function const* F) {
    // Allocate the MCFunction to store the DAGs
    void* buf = alloc().allocate_bytes(sizeof(MCFunction), alignof(MCFunction));
    MCF = new(buf) MCFunction{alloc(), F->ctx().TI(), TD};
+   instMap.reset(F);
+   vregMap.reset(F);
+   allocaMap.reset(F);
+   bbMap.reset(F);
    // Build dummy DAG nodes for each basic block
    for(auto* bb : F->reversePostOrder()) {
       auto* const node = InstSelectNode::CreateLeaf(alloc(), MCF, NodeKind::Entry);
@@ -114,18 +149,21 @@ void MIRBuilder::buildMCFunction(tir::Function const* F) {
       bbMap[bb]->addChild(entry);
    }
    // For each of the vregs, add a LoadToReg node
-   for(auto [v, idx] : vregMap) {
-      auto instnode = instMap[v];
-      auto vreg = ISN::CreateLeaf(alloc(),
-                                  MCF,
-                                  NodeKind::Register,
-                                  ISN::Type{v->type()->getSizeInBits()},
-                                  ISN::VReg{idx});
-      auto node =
-            ISN::Create(alloc(), MCF, T{}, NodeKind::LoadToReg, {vreg, instnode});
-      // Find the graph corresponding to instnode
-      auto parbb = cast<tir::Instruction>(v)->parent();
-      cast<ISN>(bbMap[parbb])->addChild(node);
+   for(auto* bb : F->body()) {
+      for(auto* v : *bb) {
+         auto idx = vregMap.lookup(v);
+         if(!idx) continue;
+         auto instnode = instMap[v];
+         auto vreg = ISN::CreateLeaf(alloc(),
+                                     MCF,
+                                     NodeKind::Register,
+                                     ISN::Type{v->type()->getSizeInBits()},
+                                     ISN::VReg{idx});
+         auto node = ISN::Create(
+               alloc(), MCF, T{}, NodeKind::LoadToReg, {vreg, instnode});
+         // Add it to the graph corresponding to instnode
+         cast<ISN>(bbMap[bb])->addChild(node);
+      }
    }
    // Now we rearrange the children of entry so they are children of the
    // first branch instruction instead
@@ -166,25 +204,21 @@ void MIRBuilder::buildMCFunction(tir::Function const* F) {
 // DAG building helper functions (to allocate things + caching nodes)
 /* ===--------------------------------------------------------------------=== */
 
-int DAG::findOrAllocVirtReg(tir::Value* v) {
-   auto it = vregMap.find(v);
-   if(it != vregMap.end()) {
-      return it->second;
-   }
-   return vregMap[v] = ++highestVregIdx;
+int DAG::findOrAllocVirtReg(tir::Instruction* v) {
+   auto& vreg = vregMap[v];
+   if(vreg) return vreg;
+   return vreg = ++highestVregIdx;
 }
 
 ISN::StackSlot DAG::findOrAllocStackSlot(tir::AllocaInst* alloca) {
-   auto it = allocaMap.find(alloca);
-   if(it != allocaMap.end()) {
-      return it->second;
-   }
+   auto& slot = allocaMap[alloca];
+   if(slot.idx) return slot;
    auto& TI = MCF->TI();
    int idx = ++highestStackSlotIdx;
    int bytes = (alloca->allocatedType()->getSizeInBits() + 1) / 8;
    int slots = (bytes + TI.getStackAlignment() - 1) / TI.getStackAlignment();
-   return allocaMap[alloca] = ISN::StackSlot{static_cast<uint16_t>(idx),
-                                             static_cast<uint16_t>(slots)};
+   return slot = ISN::StackSlot{static_cast<uint16_t>(idx),
+                                static_cast<uint16_t>(slots)};
 }
 
 InstSelectNode* DAG::buildVReg(tir::Instruction* v) {
@@ -222,7 +256,7 @@ InstSelectNode* DAG::findValue(tir::Value* v) {
       // Otherwise, grab the emitted instruction
       return instr->parent() != curbb
                    ? buildVReg(instr)
-                   : (assert(instMap.contains(instr) &&
+                   : (assert(instMap.lookup(instr) &&
                              "Instruction does not dominate all uses"),
                       instMap[instr]);
    } else if(v->isFunction()) {
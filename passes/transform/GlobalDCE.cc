@@ -1,11 +1,16 @@
+#include <unordered_set>
+
 #include "../IRPasses.h"
 #include "tir/CompilationUnit.h"
 #include "tir/Constant.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
 
 using std::string_view;
 using utils::PassManager;
 
+STATISTIC(NumGlobalsRemoved, "globaldce", "Number of global objects removed");
+
 class GlobalDCE final : public passes::CompilationUnit {
 public:
    GlobalDCE(PassManager& PM) noexcept : passes::CompilationUnit(PM) {}
@@ -13,19 +18,30 @@ public:
    string_view Desc() const override { return "Global Dead Code Elimination"; }
 
 private:
-   void runOnCompilationUnit(tir::CompilationUnit* CU) override {
-      bool changed;
+   analysis::PreservedAnalyses runOnCompilationUnit(
+         tir::CompilationUnit* CU) override {
+      bool changed, everChanged = false;
       do {
          changed = removeAllGlobals(*CU);
+         everChanged |= changed;
       } while(changed);
+      // Removed functions must not keep their (stale) results around
+      return everChanged ? analysis::PreservedAnalyses::None()
+                         : analysis::PreservedAnalyses::All();
    }
 
    bool removeAllGlobals(tir::CompilationUnit& CU) {
+      // The initializers are not uses, but the globals refer to them
+      std::unordered_set<tir::GlobalObject const*> initializers;
+      for(auto p : CU.global_objects_kv()) {
+         auto* gv = dyn_cast<tir::GlobalVariable>(p.second);
+         if(gv && gv->initializer()) initializers.insert(gv->initializer());
+      }
       std::vector<std::string> toRemove;
       for(auto p : CU.global_objects_kv()) {
          auto [name, go] = p;
          if(go->isExternalLinkage()) continue;
-         if(!go->uses().empty()) continue;
+         if(!go->uses().empty() || initializers.contains(go)) continue;
          // Destroy the global object
          if(auto fn = dyn_cast<tir::Function>(go)) {
             for(auto bb : fn->body()) {
@@ -42,6 +58,7 @@ private:
       for(auto name : toRemove) {
          CU.removeGlobalObject(name);
       }
+      NumGlobalsRemoved += toRemove.size();
       return toRemove.size() > 0;
    }
 };
@@ -1,5 +1,4 @@
 #include <deque>
-#include <unordered_set>
 
 #include "../IRPasses.h"
 #include "../analysis/DominatorTree.h"
@@ -7,14 +6,21 @@
 #include "tir/BasicBlock.h"
 #include "tir/Constant.h"
 #include "tir/Instructions.h"
+#include "tir/ValueMap.h"
 #include "utils/BumpAllocator.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
 
 using std::string_view;
 using utils::PassManager;
 using DE = diagnostics::DiagnosticEngine;
 using namespace tir;
 
+STATISTIC(NumAllocasPromoted, "mem2reg", "Number of allocas promoted");
+STATISTIC(NumPhisPlaced, "mem2reg", "Number of phi nodes placed");
+STATISTIC(NumStoresRemoved, "mem2reg", "Number of stores removed");
+STATISTIC(NumLoadsRemoved, "mem2reg", "Number of loads removed");
+
 // Enclose everything but the pass in an anonymous namespace
 namespace {
 
@@ -35,6 +41,10 @@ public:
    HoistAlloca(analysis::DominatorTree*, tir::Function*,
                diagnostics::DiagnosticEngine&, BumpAllocator&) noexcept;
    std::ostream& print(std::ostream& os) const;
+   /// @returns True if any load or store was rewritten
+   bool changed() const {
+      return !storesToRewrite.empty() || !loadsToRewrite.empty();
+   }
    void placePHINodes(AllocaInst* alloca);
    bool canAllocaBeReplaced(AllocaInst* alloca);
    void replaceUses(BasicBlock* alloca);
@@ -43,12 +53,19 @@ public:
    analysis::DominatorTree* DT;
    BumpAllocator& alloc;
    // Stores and loads to rewrite
-   std::pmr::unordered_set<Instruction*> storesToRewrite{alloc};
-   std::pmr::unordered_set<Instruction*> loadsToRewrite{alloc};
-   // Phi -> Alloca map
-   std::pmr::unordered_map<PhiNode*, AllocaInst*> phiAllocaMap{alloc};
+   std::pmr::vector<Instruction*> storesToRewrite{alloc};
+   std::pmr::vector<Instruction*> loadsToRewrite{alloc};
+   // Store or load -> the promoted alloca it was found from, if to rewrite
+   ValueMap<AllocaInst*> rewriteAllocaMap;
+   // Phi -> Alloca map, and the phis in the order they were placed
+   ValueMap<AllocaInst*> phiAllocaMap;
+   std::pmr::vector<PhiNode*> phis{alloc};
    // Variable stack
-   std::pmr::unordered_map<Value*, std::pmr::vector<Value*>> varStack{alloc};
+   ValueMap<std::pmr::vector<Value*>> varStack;
+   // Block -> the last alloca whose phi was placed in (DF+), or added to
+   // the worklist of (Work) the block, so these need not be cleared
+   BlockMap<AllocaInst*> DFPlus;
+   BlockMap<AllocaInst*> Work;
 };
 
 /* ===--------------------------------------------------------------------=== */
@@ -58,7 +75,13 @@ public:
 HoistAlloca::HoistAlloca(analysis::DominatorTree* DT, tir::Function* Fn,
                          diagnostics::DiagnosticEngine& Diag,
                          BumpAllocator& Alloc) noexcept
-      : DT{DT}, alloc{Alloc} {
+      : DT{DT},
+        alloc{Alloc},
+        rewriteAllocaMap{Fn, Alloc.resource()},
+        phiAllocaMap{Fn, Alloc.resource()},
+        varStack{Fn, Alloc.resource()},
+        DFPlus{Fn, Alloc.resource()},
+        Work{Fn, Alloc.resource()} {
    // 1. Print out the dominator tree
    if(Diag.Verbose(2)) {
       auto dbg = Diag.ReportDebug();
@@ -67,12 +90,16 @@ HoistAlloca::HoistAlloca(analysis::DominatorTree* DT, tir::Function* Fn,
    // 2. Place PHI nodes for each alloca and record the uses
    for(auto alloca : Fn->allocas()) {
       if(canAllocaBeReplaced(alloca)) {
+         ++NumAllocasPromoted;
          placePHINodes(alloca);
          for(auto* user : alloca->users()) {
-            if(auto* store = dyn_cast<StoreInst>(user)) {
-               storesToRewrite.insert(store);
-            } else if(auto* load = dyn_cast<LoadInst>(user)) {
-               loadsToRewrite.insert(load);
+            auto* inst = cast<Instruction>(user);
+            if(rewriteAllocaMap[inst]) continue;
+            rewriteAllocaMap[inst] = alloca;
+            if(dyn_cast<StoreInst>(inst)) {
+               storesToRewrite.push_back(inst);
+            } else if(dyn_cast<LoadInst>(inst)) {
+               loadsToRewrite.push_back(inst);
             }
          }
       }
@@ -87,10 +114,12 @@ HoistAlloca::HoistAlloca(analysis::DominatorTree* DT, tir::Function* Fn,
    for(auto store : storesToRewrite) {
       assert(store->uses().size() == 0);
       store->eraseFromParent();
+      ++NumStoresRemoved;
    }
    for(auto load : loadsToRewrite) {
       assert(load->uses().size() == 0);
       load->eraseFromParent();
+      ++NumLoadsRemoved;
    }
 }
 
@@ -107,13 +136,12 @@ bool HoistAlloca::canAllocaBeReplaced(AllocaInst* alloca) {
 
 // Ref from paper, Figure 4. Placement of PHI-functions
 void HoistAlloca::placePHINodes(AllocaInst* V) {
-   std::pmr::unordered_set<BasicBlock*> DFPlus{alloc};
-   std::pmr::unordered_set<BasicBlock*> Work{alloc};
    std::pmr::deque<BasicBlock*> W{alloc};
    // NOTE: A(V) = set of stores to V
    for(auto user : V->users()) {
       if(auto X = dyn_cast<StoreInst>(user)) {
-         Work.insert(X->parent());
+         if(Work[X->parent()] == V) continue;
+         Work[X->parent()] = V;
          W.push_back(X->parent());
       }
    }
@@ -121,14 +149,16 @@ void HoistAlloca::placePHINodes(AllocaInst* V) {
       BasicBlock* X = W.front();
       W.pop_front();
       for(auto Y : DT->DF(X)) {
-         if(DFPlus.contains(Y)) continue;
+         if(DFPlus[Y] == V) continue;
          auto phi = PhiNode::Create(V->ctx(), V->allocatedType(), {}, {});
          phi->setName("phi");
          Y->insertBeforeBegin(phi);
          phiAllocaMap[phi] = V;
-         DFPlus.insert(Y);
-         if(!Work.contains(Y)) {
-            Work.insert(Y);
+         phis.push_back(phi);
+         ++NumPhisPlaced;
+         DFPlus[Y] = V;
+         if(Work[Y] != V) {
+            Work[Y] = V;
             W.push_back(Y);
          }
       }
@@ -137,9 +167,11 @@ void HoistAlloca::placePHINodes(AllocaInst* V) {
 
 // Ref from paper, Figure 5. Construction of SSA form
 void HoistAlloca::replaceUses(BasicBlock* X) {
-   std::pmr::vector<Value*> pushed_vars{alloc};
+   std::pmr::vector<AllocaInst*> pushed_vars{alloc};
    for(auto phi : X->phis()) {
+      // Skip the phis that were not placed by us
       auto alloca = phiAllocaMap[phi];
+      if(!alloca) continue;
       pushed_vars.push_back(alloca);
       varStack[alloca].push_back(phi);
    }
@@ -151,11 +183,12 @@ void HoistAlloca::replaceUses(BasicBlock* X) {
                Undef::Create(alloca->ctx(), alloca->allocatedType()));
          continue;
       }
-      if(storesToRewrite.contains(inst)) { // "LHS"
+      if(!rewriteAllocaMap[inst]) continue;
+      if(dyn_cast<StoreInst>(inst)) { // "LHS"
          auto alloca = cast<AllocaInst>(inst->getChild(1));
          pushed_vars.push_back(alloca);
          varStack[alloca].push_back(inst->getChild(0));
-      } else if(loadsToRewrite.contains(inst)) { // "RHS"
+      } else { // "RHS"
          auto alloca = cast<AllocaInst>(inst->getChild(0));
          auto newVar = varStack[alloca].back();
          inst->replaceAllUsesWith(newVar);
@@ -163,7 +196,8 @@ void HoistAlloca::replaceUses(BasicBlock* X) {
    }
    for(auto Y : X->successors()) {
       for(auto phi : Y->phis()) {
-         phi->replaceOrAddOperand(X, varStack[phiAllocaMap[phi]].back());
+         if(auto alloca = phiAllocaMap[phi])
+            phi->replaceOrAddOperand(X, varStack[alloca].back());
       }
    }
    for(auto Y : DT->getChildren(X)) {
@@ -174,10 +208,10 @@ void HoistAlloca::replaceUses(BasicBlock* X) {
 
 std::ostream& HoistAlloca::print(std::ostream& os) const {
    os << "*** PHI node insertion points ***\n";
-   for(auto [phi, alloca] : phiAllocaMap) {
+   for(auto phi : phis) {
       os << "  ";
       phi->printName(os) << " -> ";
-      alloca->printName(os) << std::endl;
+      phiAllocaMap.lookup(phi)->printName(os) << std::endl;
    }
    return os;
 }
@@ -193,10 +227,14 @@ public:
    string_view Desc() const override { return "Promote memory to register"; }
 
 private:
-   void runOnFunction(tir::Function* Fn) override {
+   analysis::PreservedAnalyses runOnFunction(tir::Function* Fn) override {
       assert(Fn->getEntryBlock());
-      auto DT = &GetPass<passes::DominatorTreeWrapper>().DT();
-      HoistAlloca{DT, Fn, PM().Diag(), NewAlloc(Lifetime::Temporary)};
+      auto DT = &GetPass<passes::DominatorTreeWrapper>().DT(Fn);
+      HoistAlloca H{DT, Fn, PM().Diag(), NewAlloc(Lifetime::Temporary)};
+      if(!H.changed()) return analysis::PreservedAnalyses::All();
+      // Only instructions are rewritten, the CFG is left untouched
+      return analysis::PreservedAnalyses::None()
+            .preserve<analysis::DominatorTreeAnalysis>();
    }
    void ComputeMoreDependencies() override {
       AddDependency(GetPass<passes::DominatorTreeWrapper>());
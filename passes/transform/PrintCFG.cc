@@ -10,7 +10,8 @@ namespace {
 class PrintCFG final : public passes::CompilationUnit {
 public:
    PrintCFG(PassManager& PM) noexcept : passes::CompilationUnit(PM) {}
-   void runOnCompilationUnit(tir::CompilationUnit* CU) override {
+   analysis::PreservedAnalyses runOnCompilationUnit(
+         tir::CompilationUnit* CU) override {
       for(auto fn : CU->functions()) {
          if(!fn->hasBody()) continue;
          std::ofstream file(std::to_string(number) + "." +
@@ -19,6 +20,7 @@ public:
          file.close();
       }
       number++;
+      return analysis::PreservedAnalyses::All();
    }
    string_view Name() const override { return "printcfg"; }
    string_view Desc() const override { return "Dump CFG DOT (per function)"; }
@@ -4,10 +4,15 @@
 #include "tir/BasicBlock.h"
 #include "tir/Instructions.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
 
 using std::string_view;
 using utils::PassManager;
 
+STATISTIC(NumDeadInstsRemoved, "simplifycfg", "Number of dead instructions removed");
+STATISTIC(NumBlocksMerged, "simplifycfg", "Number of blocks merged into their predecessor");
+STATISTIC(NumUnreachableBlocksRemoved, "simplifycfg", "Number of unreachable blocks removed");
+
 namespace {
 
 // Remove all dead instructions
@@ -30,6 +35,7 @@ bool deleteDeadInstructions(tir::BasicBlock& bb) {
       // Otherwise, dead iff no users
       if(instr->users().begin() == instr->users().end()) {
          instr->eraseFromParent();
+         ++NumDeadInstsRemoved;
          changed = true;
       }
    }
@@ -40,6 +46,7 @@ bool deleteDeadInstructions(tir::BasicBlock& bb) {
    while(instr != nullptr) {
       auto next = instr->next();
       bb.erase(instr);
+      ++NumDeadInstsRemoved;
       instr = next;
    }
    return changed;
@@ -69,6 +76,7 @@ bool mergeSinglePredSingleSucc(tir::BasicBlock& bb) {
    // 4. Remove the successor from the parent function
    succ->replaceAllUsesWith(&bb);
    succ->eraseFromParent();
+   ++NumBlocksMerged;
    return true;
 }
 
@@ -115,21 +123,24 @@ bool replaceSucessorInOneBranch(tir::BasicBlock& bb) {
 class SimplifyCFG final : public passes::Function {
 public:
    SimplifyCFG(PassManager& PM) noexcept : passes::Function(PM) {}
-   void runOnFunction(tir::Function* func) override {
+   analysis::PreservedAnalyses runOnFunction(tir::Function* func) override {
       std::pmr::vector<tir::BasicBlock*> toRemove{NewAlloc(Lifetime::Temporary)};
       if(PM().Diag().Verbose()) {
          PM().Diag().ReportDebug()
                << "*** Running SimplifyCFG on function: " << func->name()
                << " ***";
       }
-      // 1. Iteratively simplify the CFG
-      bool changed = false;
+      // 1. Iteratively simplify the CFG. The visited set is local, so the
+      // pass can run on many functions at once.
+      std::unordered_set<tir::BasicBlock*> visited;
+      bool changed = false, everChanged = false;
       do {
          changed = false;
          visited.clear();
          if(func->getEntryBlock()) {
-            changed = visitBB(*func->getEntryBlock());
+            changed = visitBB(*func->getEntryBlock(), visited);
          }
+         everChanged |= changed;
       } while(changed);
       // 2. Record all the basic blocks that were not visited
       toRemove.clear();
@@ -145,13 +156,18 @@ public:
             bb->printName(dbg.get());
          }
          bb->eraseFromParent();
+         ++NumUnreachableBlocksRemoved;
       }
+      everChanged |= !toRemove.empty();
+      return everChanged ? analysis::PreservedAnalyses::None()
+                         : analysis::PreservedAnalyses::All();
    }
    string_view Name() const override { return "simplifycfg"; }
    string_view Desc() const override { return "Simplify CFG"; }
 
 private:
-   bool visitBB(tir::BasicBlock& bb) {
+   bool visitBB(tir::BasicBlock& bb,
+                std::unordered_set<tir::BasicBlock*>& visited) {
       bool changed = false;
       if(visited.count(&bb)) return false;
       visited.insert(&bb);
@@ -161,14 +177,11 @@ private:
       // changed |= replaceSucessorInOneBranch(bb);
       // 2. Grab the next basic block
       auto term = dyn_cast<tir::BranchInst>(bb.terminator());
-      if(term == nullptr) return false;
-      changed |= visitBB(*term->getSuccessor(0));
-      changed |= visitBB(*term->getSuccessor(1));
+      if(term == nullptr) return changed;
+      changed |= visitBB(*term->getSuccessor(0), visited);
+      changed |= visitBB(*term->getSuccessor(1), visited);
       return changed;
    }
-
-private:
-   std::unordered_set<tir::BasicBlock*> visited;
 };
 
 } // namespace
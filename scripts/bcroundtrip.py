@@ -0,0 +1,89 @@
+#!/usr/bin/env python3
+
+import sys
+import os
+import argparse
+import re
+import subprocess
+import tempfile
+import time
+
+sys.path.append(os.path.join(os.path.dirname(__file__), "common.py"))
+
+from common import *
+
+
+# Run jcc1 and return the wall time, exiting if it fails
+def run_jcc1(cmd: list[str]) -> float:
+    start = time.perf_counter()
+    ret = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    wall = time.perf_counter() - start
+    if ret.returncode != 0:
+        print(ret.stderr.decode("utf-8", errors="ignore"))
+        print(f"Error: {subprocess.list2cmdline(cmd)} exited with return code {ret.returncode}")
+        sys.exit(1)
+    return wall
+
+
+# The value IDs and the order of the globals are not preserved by the
+# bitcode, so compare the sorted lines with the IDs stripped
+def normalize(path: str) -> list[str]:
+    with open(path) as f:
+        text = re.sub(r"([.%])[0-9]+", r"\1N", f.read())
+    return sorted(text.splitlines())
+
+
+script_dir = os.path.dirname(os.path.realpath(__file__))
+parser = argparse.ArgumentParser(
+    description="Checks that the TIR of each codegen test survives a bitcode round trip,\n"
+    "and compares the time to load the bitcode against running the front end"
+)
+parser.add_argument(
+    "tests",
+    nargs="*",
+    default=[os.path.join(script_dir, "..", "tests", "codegen")],
+    help="The test programs (.java files) or directories of them (where each\n"
+    ".java file or subdirectory is a program)",
+)
+parser.add_argument(
+    "--stdlib",
+    default=os.path.join(script_dir, "..", "jdk"),
+    help="The path to the standard library to compile against",
+)
+args = parser.parse_args()
+
+binary = os.path.abspath(os.environ.get("JOOSC", os.path.join(script_dir, "..", "build", "jcc1")))
+if not os.path.isfile(binary):
+    print(f"Error: {binary} does not exist, build jcc1 first")
+    sys.exit(1)
+
+# Each .java file or directory in a test directory is a program
+programs = []
+for test in args.tests:
+    if os.path.isdir(test):
+        for p in sorted(os.listdir(test)):
+            path = os.path.join(test, p)
+            if os.path.isdir(path) or p.endswith(".java"):
+                programs.append(path)
+    else:
+        programs.append(test)
+
+failed = 0
+print(f"{'test':<32} {'bitcode (B)':>12} {'front end (s)':>14} {'load (s)':>10}")
+with tempfile.TemporaryDirectory() as tmp:
+    text, bitcode, loaded = (os.path.join(tmp, f) for f in ["a.tir", "a.tirb", "b.tir"])
+    for program in programs:
+        files = [program] if os.path.isfile(program) else grab_all_java(program)
+        base = [binary, "--stdlib", args.stdlib, "-s"]
+        fe = run_jcc1([*base, "-o", text, *files])
+        run_jcc1([*base, "--emit-bc", "-o", bitcode, *files])
+        load = run_jcc1([binary, "-s", "--load-bc", bitcode, "-o", loaded])
+        name = os.path.basename(program)
+        size = os.path.getsize(bitcode)
+        print(f"{name:<32} {size:>12} {fe:>14.3f} {load:>10.3f}")
+        if normalize(text) != normalize(loaded):
+            print(f"{name} failed: the TIR changed after the round trip")
+            failed += 1
+
+print(f"{len(programs) - failed}/{len(programs)} round trips passed")
+sys.exit(1 if failed else 0)
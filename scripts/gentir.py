@@ -0,0 +1,73 @@
+#!/usr/bin/env python3
+
+import sys
+import argparse
+
+
+# Emit a function whose body is a chain of diamonds updating two locals
+# through allocas, so mem2reg and simplifycfg have work to do
+def generate_function(out, name: str, callee: str | None, diamonds: int):
+    ids = iter(range(1, sys.maxsize))
+    n, x, i = f"n.{next(ids)}", f"x.{next(ids)}", f"i.{next(ids)}"
+    out.write(f"function i32 @{name}(%{n}:i32) {{\n")
+    out.write(f"^entry.{next(ids)}:\n")
+    out.write(f"    %{x} = alloca type i32\n")
+    out.write(f"    %{i} = alloca type i32\n")
+    out.write(f"    store 0:i32 to %{x}:ptr\n")
+    out.write(f"    store 0:i32 to %{i}:ptr\n")
+    cond = f"cond.{next(ids)}"
+    out.write(f"    br 1:i1, ^{cond}, ^{cond}\n")
+    for k in range(diamonds):
+        then, other, join, next_cond = (f"{b}.{next(ids)}" for b in ["then", "else", "join", "cond"])
+        v, c = f"{next(ids)}", f"{next(ids)}"
+        out.write(f"^{cond}:\n")
+        out.write(f"    %{v} = load:i32 %{i}:ptr\n")
+        out.write(f"    %{c} = cmp:i1 lt %{v}:i32, %{n}:i32\n")
+        out.write(f"    br %{c}:i1, ^{then}, ^{other}\n")
+        for block, op in [(then, "add"), (other, "sub")]:
+            a, b = f"{next(ids)}", f"{next(ids)}"
+            out.write(f"^{block}:\n")
+            out.write(f"    %{a} = load:i32 %{x}:ptr\n")
+            out.write(f"    %{b} = {op}:i32 %{a}:i32, {k}:i32\n")
+            out.write(f"    store %{b}:i32 to %{x}:ptr\n")
+            out.write(f"    br 1:i1, ^{join}, ^{join}\n")
+        a, b = f"{next(ids)}", f"{next(ids)}"
+        out.write(f"^{join}:\n")
+        out.write(f"    %{a} = load:i32 %{i}:ptr\n")
+        out.write(f"    %{b} = add:i32 %{a}:i32, 1:i32\n")
+        out.write(f"    store %{b}:i32 to %{i}:ptr\n")
+        out.write(f"    br 1:i1, ^{next_cond}, ^{next_cond}\n")
+        cond = next_cond
+    r = f"{next(ids)}"
+    out.write(f"^{cond}:\n")
+    out.write(f"    %{r} = load:i32 %{x}:ptr\n")
+    if callee:
+        s, t = f"{next(ids)}", f"{next(ids)}"
+        out.write(f"    %{s} = call:i32 @{callee}(%{r}:i32)\n")
+        out.write(f"    %{t} = add:i32 %{s}:i32, %{r}:i32\n")
+        r = t
+    out.write(f"    ret %{r}:i32\n")
+    out.write("}\n\n")
+
+
+parser = argparse.ArgumentParser(
+    description="Generates a synthetic TIR module to run tir-opt on. Half of the\n"
+    "functions are called from main (in a chain), the others are dead"
+)
+parser.add_argument("-f", "--functions", type=int, default=1000, help="The number of functions")
+parser.add_argument("-d", "--diamonds", type=int, default=20, help="The number of if-else diamonds per function")
+parser.add_argument("-o", "--output", default="-", help="The file to write the module to, or - for stdout")
+args = parser.parse_args()
+
+out = sys.stdout if args.output == "-" else open(args.output, "w")
+for f in range(args.functions):
+    # The even functions call the next even one, the odd ones are never called
+    callee = f"f{f + 2}" if f % 2 == 0 and f + 2 < args.functions else None
+    generate_function(out, f"f{f}", callee, args.diamonds)
+out.write("function external i32 @main() {\n")
+out.write("^entry.1:\n")
+out.write("    %r.2 = call:i32 @f0(10:i32)\n" if args.functions else "")
+out.write("    ret %r.2:i32\n" if args.functions else "    ret 0:i32\n")
+out.write("}\n")
+if out is not sys.stdout:
+    out.close()
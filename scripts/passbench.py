@@ -0,0 +1,79 @@
+#!/usr/bin/env python3
+
+import sys
+import os
+import argparse
+import json
+import subprocess
+import tempfile
+import time
+
+sys.path.append(os.path.join(os.path.dirname(__file__), "common.py"))
+
+from common import *
+
+
+# Generate n trivial classes (one per file) to stress the pass manager
+def generate_classes(dir: str, n: int) -> list[str]:
+    files = []
+    for i in range(n):
+        path = os.path.join(dir, f"C{i}.java")
+        with open(path, "w") as f:
+            f.write(f"public class C{i} {{\n")
+            f.write(f"    public C{i}() {{}}\n")
+            f.write(f"    public int m() {{ return {i}; }}\n")
+            f.write("}\n")
+        files.append(path)
+    return files
+
+
+# Compile the files and return the wall time and the pass count reported
+def run_bench(binary: str, stdlib_dir: str, files: list[str], extra: list[str]):
+    cmd = [binary, "-c", "--stdlib", stdlib_dir, "--time-passes=json", *extra, *files]
+    start = time.perf_counter()
+    ret = subprocess.run(cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE)
+    wall = time.perf_counter() - start
+    if ret.returncode != 0:
+        print(ret.stderr.decode("utf-8", errors="ignore"))
+        print(f"Error: jcc1 exited with return code {ret.returncode}")
+        sys.exit(1)
+    # The timing report is the last JSON object printed to stderr
+    err = ret.stderr.decode("utf-8", errors="ignore")
+    try:
+        report = json.loads(err[err.rindex('{\n  "passes"') :])
+    except ValueError:
+        report = {}
+    return wall, report
+
+
+script_dir = os.path.dirname(os.path.realpath(__file__))
+parser = argparse.ArgumentParser(
+    description="Measures how the pass manager scales with the number of files"
+)
+parser.add_argument(
+    "sizes",
+    nargs="*",
+    type=int,
+    default=[1000, 5000, 20000],
+    help="The number of files to compile, one run per size",
+)
+parser.add_argument(
+    "--stdlib",
+    default=os.path.join(script_dir, "..", "jdk"),
+    help="The path to the standard library to compile against",
+)
+parser.add_argument("args", nargs=argparse.REMAINDER, help="Additional arguments to pass to jcc1")
+args = parser.parse_args()
+
+binary = os.path.abspath(os.environ.get("JOOSC", os.path.join(script_dir, "..", "build", "jcc1")))
+if not os.path.isfile(binary):
+    print(f"Error: {binary} does not exist, build jcc1 first")
+    sys.exit(1)
+
+print(f"{'files':>8} {'wall (s)':>10} {'us/file':>10} {'passes':>8}")
+with tempfile.TemporaryDirectory() as tmp:
+    files = generate_classes(tmp, max(args.sizes))
+    for n in args.sizes:
+        wall, report = run_bench(binary, args.stdlib, files[:n], args.args)
+        passes = sum(row["instances"] for row in report.get("passes", []))
+        print(f"{n:>8} {wall:>10.3f} {wall * 1e6 / n:>10.1f} {passes:>8}")
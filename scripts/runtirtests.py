@@ -0,0 +1,143 @@
+#!/usr/bin/env python3
+
+import sys
+import os
+import argparse
+import difflib
+import re
+import shlex
+import subprocess
+import tempfile
+
+
+# The tir-opt arguments of a test, from its "; RUN: <args>" first line
+def get_run_args(path: str) -> list[str] | None:
+    with open(path) as f:
+        line = f.readline().strip()
+    if not line.startswith("; RUN:"):
+        return None
+    return shlex.split(line[len("; RUN:"):])
+
+
+# Run tir-opt from the test directory, so the diagnostics name the test file
+# the same way on every machine. Returns the output as it is checked in.
+def run_tir_opt(binary: str, args: list[str], path: str) -> str:
+    cmd = [binary, *args, os.path.basename(path)]
+    ret = subprocess.run(
+        cmd, stdout=subprocess.PIPE, stderr=subprocess.PIPE, cwd=os.path.dirname(path)
+    )
+    output = ret.stdout.decode() + ret.stderr.decode()
+    if ret.returncode != 0:
+        output += f"; exit code {ret.returncode}\n"
+    return output
+
+
+# The value IDs and the order of the globals are not preserved by the
+# bitcode, so compare the sorted lines with the IDs stripped
+def normalize(text: str) -> list[str]:
+    return sorted(re.sub(r"([.%^])[0-9]+", r"\1N", text).splitlines())
+
+
+# Write the test as bitcode and read it back, the module must print the same
+# as when read from the text. Returns None if the test is not a valid module.
+def round_trip(binary: str, path: str, tmp: str) -> bool | None:
+    text = run_tir_opt(binary, [], path)
+    if text.endswith("; exit code 1\n"):
+        return None
+    bitcode = os.path.join(tmp, "a.tirb")
+    run_tir_opt(binary, ["--emit-bc", "-o", bitcode], path)
+    return normalize(text) == normalize(run_tir_opt(binary, [], bitcode))
+
+
+script_dir = os.path.dirname(os.path.realpath(__file__))
+parser = argparse.ArgumentParser(
+    description="Runs the tir-opt tests, i.e., each .tir file with a \"; RUN: <args>\" first\n"
+    "line is run through tir-opt with those arguments, and the output (stdout, then\n"
+    "stderr and the exit code if non-zero) is compared against the .expected file",
+    formatter_class=argparse.RawTextHelpFormatter,
+)
+parser.add_argument(
+    "tests",
+    nargs="*",
+    default=[os.path.join(script_dir, "..", "tests", "tir")],
+    help="The tests (.tir files) or directories of them",
+)
+parser.add_argument(
+    "--tir-opt",
+    default=os.environ.get("TIROPT", os.path.join(script_dir, "..", "build", "tir-opt")),
+    help="The tir-opt binary to test (default: $TIROPT or build/tir-opt)",
+)
+parser.add_argument(
+    "--update", action="store_true", help="Rewrite the .expected files instead of checking them"
+)
+parser.add_argument(
+    "--roundtrip",
+    action="store_true",
+    help="Instead, check that each valid test survives a round trip through bitcode\n"
+    "(i.e., text -> --emit-bc -> text)",
+)
+args = parser.parse_args()
+
+binary = os.path.abspath(args.tir_opt)
+if not os.path.isfile(binary):
+    print(f"Error: {binary} does not exist, build tir-opt first")
+    sys.exit(1)
+
+tests = []
+for test in args.tests:
+    if os.path.isdir(test):
+        tests += [os.path.join(test, f) for f in sorted(os.listdir(test)) if f.endswith(".tir")]
+    else:
+        tests.append(test)
+
+if args.roundtrip:
+    failed = checked = 0
+    with tempfile.TemporaryDirectory() as tmp:
+        for test in map(os.path.abspath, tests):
+            ok = round_trip(binary, test, tmp)
+            if ok is None:
+                continue
+            checked += 1
+            if not ok:
+                print(f"{os.path.basename(test)} failed: the TIR changed after the round trip")
+                failed += 1
+    print(f"{checked - failed}/{checked} round trips passed")
+    sys.exit(1 if failed else 0)
+
+failed = 0
+for test in map(os.path.abspath, tests):
+    name = os.path.basename(test)
+    run_args = get_run_args(test)
+    if run_args is None:
+        print(f"{name} failed: the first line must be \"; RUN: <args>\"")
+        failed += 1
+        continue
+    output = run_tir_opt(binary, run_args, test)
+    expected_path = os.path.splitext(test)[0] + ".expected"
+    if args.update:
+        with open(expected_path, "w") as f:
+            f.write(output)
+        continue
+    if not os.path.isfile(expected_path):
+        print(f"{name} failed: {os.path.basename(expected_path)} does not exist")
+        failed += 1
+        continue
+    with open(expected_path) as f:
+        expected = f.read()
+    if output != expected:
+        print(f"{name} failed: the output differs from the expected output")
+        sys.stdout.writelines(
+            difflib.unified_diff(
+                expected.splitlines(keepends=True),
+                output.splitlines(keepends=True),
+                "expected",
+                "actual",
+            )
+        )
+        failed += 1
+
+if args.update:
+    print(f"Updated the expected output of {len(tests)} tests")
+    sys.exit(0)
+print(f"{len(tests) - failed}/{len(tests)} tests passed")
+sys.exit(1 if failed else 0)
@@ -0,0 +1,184 @@
+#include <gtest/gtest.h>
+
+#include <map>
+#include <set>
+
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Instructions.h"
+#include "TestUtils.h"
+
+/**
+ * Tests the successor and predecessor lists cached on each basic block. After
+ * every edit to the branches or blocks, the lists are compared to the edges
+ * read off the terminators.
+ */
+
+namespace {
+
+using namespace tir;
+
+class CFGEdgesTest : public testutils::TIRTest {
+protected:
+   CFGEdgesTest() {
+      auto* i32 = Type::getInt32Ty(ctx);
+      fn = cu.CreateFunction(FunctionType::get(ctx, i32, {i32}), "f");
+   }
+
+   BasicBlock* newBlock() { return builder.createBasicBlock(fn); }
+
+   // Sets the insertion point to the end of bb
+   void at(BasicBlock* bb) { builder.setInsertPoint(bb->end()); }
+
+   Value* cond() {
+      return builder.createCmpInstr(CmpInst::Predicate::LT,
+                                    *fn->args().begin(),
+                                    Constant::CreateInt32(ctx, 0));
+   }
+
+   // Compares the cached edges of every block to those of the terminators
+   void checkEdges() {
+      std::map<BasicBlock*, std::set<BasicBlock*>> succs, preds;
+      for(auto* bb : fn->body()) {
+         auto* br = dyn_cast_or_null<BranchInst>(bb->terminator());
+         if(!br) continue;
+         for(unsigned i = 0; i < 2; i++) {
+            succs[bb].insert(br->getSuccessor(i));
+            preds[br->getSuccessor(i)].insert(bb);
+         }
+      }
+      for(auto* bb : fn->body()) {
+         testutils::ExpectSameElements(bb->successors(), succs[bb]);
+         testutils::ExpectSameElements(bb->predecessors(), preds[bb]);
+         // The true successor comes first
+         if(auto* br = dyn_cast_or_null<BranchInst>(bb->terminator()))
+            EXPECT_EQ(bb->successors().front(), br->getSuccessor(0));
+      }
+   }
+
+   Function* fn;
+};
+
+TEST_F(CFGEdgesTest, InsertBranches) {
+   // A diamond, then a loop back to the entry
+   auto* entry = newBlock();
+   auto* left = newBlock();
+   auto* right = newBlock();
+   auto* join = newBlock();
+   at(entry);
+   builder.createBranchInstr(cond(), left, right);
+   checkEdges();
+   at(left);
+   builder.createBranchInstr(join);
+   at(right);
+   builder.createBranchInstr(join);
+   checkEdges();
+   at(join);
+   builder.createBranchInstr(cond(), entry, join);
+   checkEdges();
+   EXPECT_EQ(join->predecessors().size(), 3u);
+   EXPECT_EQ(entry->predecessors().size(), 1u);
+}
+
+TEST_F(CFGEdgesTest, EraseBranch) {
+   auto* entry = newBlock();
+   auto* a = newBlock();
+   auto* b = newBlock();
+   at(entry);
+   auto* br = builder.createBranchInstr(cond(), a, b);
+   at(a);
+   builder.createBranchInstr(b);
+   checkEdges();
+   br->eraseFromParent();
+   checkEdges();
+   EXPECT_TRUE(entry->successors().empty());
+   EXPECT_EQ(b->predecessors().size(), 1u);
+   // Both targets the same block
+   at(entry);
+   builder.createBranchInstr(cond(), b, b);
+   checkEdges();
+   EXPECT_EQ(entry->successors().size(), 1u);
+}
+
+TEST_F(CFGEdgesTest, MoveBranch) {
+   // As SimplifyCFG does when merging a block into its predecessor
+   auto* entry = newBlock();
+   auto* a = newBlock();
+   auto* b = newBlock();
+   at(entry);
+   auto* br = builder.createBranchInstr(a);
+   at(a);
+   auto* moved = builder.createBranchInstr(cond(), b, entry);
+   checkEdges();
+   br->eraseFromParent();
+   moved->eraseFromParent(true);
+   checkEdges();
+   entry->appendAfterEnd(moved);
+   checkEdges();
+   EXPECT_TRUE(a->predecessors().empty());
+   EXPECT_EQ(entry->predecessors().size(), 1u);
+   EXPECT_EQ(entry->predecessors().front(), entry);
+}
+
+TEST_F(CFGEdgesTest, ReplaceSuccessor) {
+   auto* entry = newBlock();
+   auto* a = newBlock();
+   auto* b = newBlock();
+   auto* c = newBlock();
+   at(entry);
+   auto* br = cast<BranchInst>(builder.createBranchInstr(cond(), a, b));
+   br->replaceSuccessor(1, c);
+   checkEdges();
+   EXPECT_TRUE(b->predecessors().empty());
+   // Now both operands target a
+   br->replaceSuccessor(1, a);
+   checkEdges();
+   EXPECT_EQ(entry->successors().size(), 1u);
+   br->replaceSuccessor(0, b);
+   checkEdges();
+   EXPECT_EQ(entry->successors().size(), 2u);
+   EXPECT_EQ(entry->successors().front(), b);
+}
+
+TEST_F(CFGEdgesTest, ReplaceAllUsesOfBlock) {
+   auto* entry = newBlock();
+   auto* a = newBlock();
+   auto* b = newBlock();
+   auto* c = newBlock();
+   at(entry);
+   builder.createBranchInstr(cond(), a, b);
+   at(a);
+   builder.createBranchInstr(cond(), b, c);
+   at(c);
+   builder.createBranchInstr(b);
+   checkEdges();
+   b->replaceAllUsesWith(c);
+   checkEdges();
+   EXPECT_TRUE(b->predecessors().empty());
+   EXPECT_EQ(a->successors().size(), 1u);
+   EXPECT_EQ(c->predecessors().size(), 3u);
+   // c now branches to itself
+   c->replaceAllUsesWith(a);
+   checkEdges();
+   EXPECT_EQ(a->predecessors().size(), 3u);
+}
+
+TEST_F(CFGEdgesTest, EraseBlock) {
+   auto* entry = newBlock();
+   auto* a = newBlock();
+   auto* dead = newBlock();
+   at(entry);
+   builder.createBranchInstr(a);
+   at(dead);
+   builder.createBranchInstr(cond(), a, entry);
+   at(a);
+   builder.createReturnInstr(*fn->args().begin());
+   checkEdges();
+   EXPECT_EQ(a->predecessors().size(), 2u);
+   dead->eraseFromParent();
+   checkEdges();
+   EXPECT_EQ(a->predecessors().size(), 1u);
+   EXPECT_TRUE(entry->predecessors().empty());
+}
+
+} // namespace
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+
+#include <set>
+#include <sstream>
+#include <string>
+#include <unordered_set>
+#include <vector>
+
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Instructions.h"
+#include "utils/ThreadPool.h"
+#include "TestUtils.h"
+
+/**
+ * Tests tir::Context in concurrent mode: many functions are built at once on
+ * a thread pool, sharing the types, the constants and a callee. Afterwards,
+ * each type and constant must exist once, the value IDs must be unique and
+ * the use lists must hold every use.
+ */
+
+namespace {
+
+using namespace tir;
+using BinOp = Instruction::BinOp;
+
+// The workers create integer types of this many widths, in different orders
+constexpr unsigned NumWidths = 48;
+// The constants range over [0, NumConstants)
+constexpr unsigned NumConstants = 64;
+constexpr unsigned NumFunctions = 200;
+constexpr unsigned NumDiamonds = 10;
+
+class ConcurrentContextTest : public testutils::TIRTest {
+protected:
+   ConcurrentContextTest() {
+      i32 = Type::getInt32Ty(ctx);
+      // The functions are declared up front, as the CU is not concurrent-safe
+      sink = cu.CreateFunction(
+            FunctionType::get(ctx, Type::getVoidTy(ctx), {i32}), "sink");
+      for(unsigned i = 0; i < NumFunctions; i++)
+         fns.push_back(cu.CreateFunction(FunctionType::get(ctx, i32, {i32}),
+                                         "f" + std::to_string(i)));
+   }
+
+   // Builds fns[index] as a chain of diamonds, each adding a constant to the
+   // argument and calling the sink
+   void build(unsigned index) {
+      IRBuilder builder{ctx};
+      auto* fn = fns[index];
+      builder.setInsertPoint(builder.createBasicBlock(fn)->begin());
+      Value* val = *fn->args().begin();
+      for(unsigned j = 0; j < NumDiamonds; j++) {
+         // Types and constants the other workers race for
+         Type* ty = IntegerType::get(ctx, 1 + (index + j) % NumWidths);
+         (void)ArrayType::get(ctx, ty, j % 4);
+         (void)FunctionType::get(ctx, ty, {i32, ty});
+         auto* cst = ConstantInt::Create(ctx, i32, (index * 7 + j) % NumConstants);
+         auto* sum = builder.createBinaryInstr(BinOp::Add, val, cst);
+         auto* cond = builder.createCmpInstr(
+               CmpInst::Predicate::LT, sum, ConstantInt::Create(ctx, i32, j));
+         auto* then = builder.createBasicBlock(fn);
+         auto* join = builder.createBasicBlock(fn);
+         builder.createBranchInstr(cond, then, join);
+         builder.setInsertPoint(then->begin());
+         builder.createCallInstr(sink, {sum});
+         builder.createBranchInstr(join);
+         builder.setInsertPoint(join->begin());
+         val = sum;
+      }
+      builder.createReturnInstr(val);
+   }
+
+   void buildAll(unsigned threads) {
+      utils::ThreadPool pool{threads};
+      Context::ConcurrentScope concurrent{ctx};
+      pool.ParallelFor(NumFunctions, [this](size_t i) { build(i); });
+   }
+
+   Type* i32;
+   Function* sink;
+   std::vector<Function*> fns;
+};
+
+TEST_F(ConcurrentContextTest, TypesAreUniqued) {
+   buildAll(8);
+   auto& pimpl = ctx.pimpl();
+   std::set<uint32_t> widths;
+   for(auto* ty : pimpl.integerTypes) {
+      EXPECT_TRUE(widths.insert(ty->getBitWidth()).second)
+            << "duplicate i" << ty->getBitWidth();
+   }
+   EXPECT_EQ(pimpl.integerTypeSet.size(), pimpl.integerTypes.size());
+   EXPECT_EQ(pimpl.arrayTypeSet.size(), pimpl.arrayTypes.size());
+   EXPECT_EQ(pimpl.functionTypeSet.size(), pimpl.functionTypes.size());
+   for(unsigned w = 1; w <= NumWidths; w++) EXPECT_TRUE(widths.contains(w));
+}
+
+TEST_F(ConcurrentContextTest, ConstantsAreUniqued) {
+   buildAll(8);
+   // Each diamond uses two constants; if any was created twice, the uses of
+   // the copy are not counted here
+   size_t numUses = 0;
+   for(unsigned k = 0; k < NumConstants; k++) {
+      auto* cst = ConstantInt::Create(ctx, i32, k);
+      for(auto const& use : cst->uses()) {
+         EXPECT_EQ(use.get(), cst);
+         numUses++;
+      }
+   }
+   EXPECT_EQ(numUses, 2 * NumFunctions * NumDiamonds);
+}
+
+TEST_F(ConcurrentContextTest, UseListsAreIntact) {
+   buildAll(8);
+   std::set<Instruction const*> calls;
+   for(auto* fn : fns)
+      for(auto* bb : fn->body())
+         for(auto* inst : *bb)
+            if(dyn_cast<CallInst>(inst)) calls.insert(inst);
+   EXPECT_EQ(calls.size(), NumFunctions * NumDiamonds);
+   EXPECT_EQ(sink->numUsers(), calls.size());
+   std::vector<Instruction const*> users;
+   for(auto const& use : sink->uses()) {
+      EXPECT_EQ(use.get(), sink);
+      users.push_back(cast<Instruction>(use.user()));
+   }
+   testutils::ExpectSameElements(users, calls);
+}
+
+TEST_F(ConcurrentContextTest, ValueIDsAreUnique) {
+   buildAll(8);
+   // The IDs are printed after the names
+   std::unordered_set<std::string> ids;
+   for(auto* fn : fns) {
+      for(auto* bb : fn->body()) {
+         for(auto* inst : *bb) {
+            std::ostringstream ss;
+            inst->printName(ss);
+            EXPECT_TRUE(ids.insert(ss.str()).second) << "duplicate " << ss.str();
+         }
+      }
+   }
+}
+
+TEST_F(ConcurrentContextTest, ScopesNest) {
+   EXPECT_FALSE(ctx.isConcurrent());
+   {
+      Context::ConcurrentScope outer{ctx};
+      {
+         Context::ConcurrentScope inner{ctx};
+         EXPECT_TRUE(ctx.isConcurrent());
+      }
+      // The inner scope must not end the outer one
+      EXPECT_TRUE(ctx.isConcurrent());
+   }
+   EXPECT_FALSE(ctx.isConcurrent());
+}
+
+} // namespace
@@ -0,0 +1,45 @@
+#pragma once
+
+#include <gtest/gtest.h>
+
+#include <ranges>
+#include <set>
+
+#include "target/Target.h"
+#include "tir/Context.h"
+#include "tir/IRBuilder.h"
+#include "tir/TIR.h"
+#include "utils/BumpAllocator.h"
+
+namespace testutils {
+
+/**
+ * @brief Expects the range to hold exactly the expected elements, each once
+ *
+ * @param actual The range to check, e.g., a use list or the cached edges
+ * @param expected The elements the range must hold, in any order
+ */
+template <std::ranges::range R, typename T>
+void ExpectSameElements(R&& actual, std::set<T> const& expected) {
+   std::set<T> elements;
+   size_t count = 0;
+   for(auto&& elem : actual) {
+      elements.insert(elem);
+      count++;
+   }
+   EXPECT_EQ(elements, expected);
+   // No element is in the range twice
+   EXPECT_EQ(count, elements.size());
+}
+
+/// @brief A fixture owning a TIR context and a compilation unit to build into
+class TIRTest : public ::testing::Test {
+protected:
+   utils::CustomBufferResource resource{};
+   BumpAllocator alloc{&resource};
+   tir::Context ctx{alloc, target::TargetInfo::Get<target::ArchType::X86>()};
+   tir::CompilationUnit cu{ctx};
+   tir::IRBuilder builder{ctx};
+};
+
+} // namespace testutils
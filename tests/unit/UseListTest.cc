@@ -0,0 +1,191 @@
+#include <gtest/gtest.h>
+
+#include <deque>
+#include <map>
+#include <memory_resource>
+#include <random>
+#include <set>
+#include <utility>
+#include <vector>
+
+#include "utils/BumpAllocator.h"
+#include "utils/User.h"
+#include "TestUtils.h"
+
+/**
+ * Tests the intrusive use lists of utils::GraphNode against the operand
+ * arrays of utils::GraphNodeUser, i.e., every operand slot has exactly one
+ * use on the list of the node it refers to, and nothing else is on the list.
+ */
+
+namespace {
+
+class Node final : public utils::GraphNodeUser<Node>,
+                   public utils::GraphNode<Node> {
+public:
+   explicit Node(BumpAllocator& alloc)
+         : utils::GraphNodeUser<Node>{alloc}, utils::GraphNode<Node>{alloc} {}
+   using utils::GraphNodeUser<Node>::addChild;
+   using utils::GraphNodeUser<Node>::replaceChild;
+   using utils::GraphNodeUser<Node>::truncateChildren;
+};
+
+class UseListTest : public ::testing::Test {
+protected:
+   Node* newNode() { return &nodes.emplace_back(alloc); }
+
+   // Checks the use list of every node against the operand arrays
+   void verify() {
+      // (user, operand index) pairs of each node, from the operand arrays
+      std::map<Node const*, std::set<std::pair<Node const*, unsigned>>> expected;
+      for(auto& user : nodes)
+         for(unsigned i = 0; i < user.numChildren(); i++)
+            if(auto* child = user.getRawChild(i))
+               expected[static_cast<Node const*>(child)].emplace(&user, i);
+      for(auto& node : nodes) {
+         std::vector<std::pair<Node const*, unsigned>> actual;
+         for(auto const& use : node.uses()) {
+            EXPECT_EQ(use.get(), &node);
+            ASSERT_LT(use.fromIndex(), use.user()->numChildren());
+            EXPECT_EQ(use.user()->getRawChild(use.fromIndex()), &node);
+            actual.emplace_back(use.user(), use.fromIndex());
+         }
+         EXPECT_EQ(actual.size(), node.numUsers());
+         EXPECT_EQ(node.uses().size(), node.numUsers());
+         // No use is on the list twice, and none is missing
+         testutils::ExpectSameElements(actual, expected[&node]);
+      }
+   }
+
+   BumpAllocator alloc{std::pmr::new_delete_resource()};
+   // A deque, as the nodes must not move
+   std::deque<Node> nodes;
+};
+
+TEST_F(UseListTest, VectorGrowth) {
+   auto* user = newNode();
+   auto* a = newNode();
+   auto* b = newNode();
+   // Grow past several reallocations, all the records move each time
+   for(unsigned i = 0; i < 100; i++) {
+      user->addChild(i % 3 ? a : b);
+      verify();
+   }
+   EXPECT_EQ(a->numUsers() + b->numUsers(), 100u);
+}
+
+TEST_F(UseListTest, MiddleInsert) {
+   auto* user = newNode();
+   std::vector<Node*> values;
+   for(unsigned i = 0; i < 8; i++) values.push_back(newNode());
+   for(auto* value : values) user->addChild(value);
+   // Insert at the front, the middle and the back, with and without growth
+   user->addChild(values[3], 0);
+   verify();
+   user->addChild(values[5], 4);
+   verify();
+   user->addChild(values[0], user->numChildren());
+   verify();
+   EXPECT_EQ(user->getRawChild(0), values[3]);
+   EXPECT_EQ(user->getRawChild(4), values[5]);
+   EXPECT_EQ(values[3]->numUsers(), 2u);
+}
+
+TEST_F(UseListTest, RemoveChild) {
+   auto* user = newNode();
+   auto* a = newNode();
+   auto* b = newNode();
+   for(unsigned i = 0; i < 10; i++) user->addChild(i % 2 ? a : b);
+   user->removeChild(0);
+   verify();
+   user->removeChild(4);
+   verify();
+   user->removeChild(user->numChildren() - 1);
+   verify();
+   EXPECT_EQ(user->numChildren(), 7u);
+   while(user->numChildren()) user->removeChild(0);
+   verify();
+   EXPECT_EQ(a->numUsers(), 0u);
+   EXPECT_EQ(b->numUsers(), 0u);
+}
+
+TEST_F(UseListTest, TruncateChildren) {
+   auto* user = newNode();
+   auto* a = newNode();
+   auto* b = newNode();
+   for(unsigned i = 0; i < 10; i++) user->addChild(i < 5 ? a : b);
+   user->truncateChildren(7);
+   verify();
+   EXPECT_EQ(b->numUsers(), 2u);
+   user->truncateChildren(3);
+   verify();
+   EXPECT_EQ(a->numUsers(), 3u);
+   EXPECT_EQ(b->numUsers(), 0u);
+   user->truncateChildren(0);
+   verify();
+   EXPECT_EQ(a->numUsers(), 0u);
+}
+
+TEST_F(UseListTest, ReplaceAndNullChildren) {
+   auto* user = newNode();
+   auto* a = newNode();
+   auto* b = newNode();
+   user->addChild(a);
+   user->addChild(nullptr);
+   user->addChild(a);
+   user->replaceChild(0, b);
+   verify();
+   user->replaceChild(1, a);
+   verify();
+   user->replaceChild(2, nullptr);
+   verify();
+   EXPECT_EQ(a->numUsers(), 1u);
+   EXPECT_EQ(b->numUsers(), 1u);
+}
+
+TEST_F(UseListTest, ReplaceAllUsesWith) {
+   auto* a = newNode();
+   auto* b = newNode();
+   std::vector<Node*> users;
+   for(unsigned i = 0; i < 5; i++) {
+      users.push_back(newNode());
+      for(unsigned j = 0; j <= i; j++) users.back()->addChild(j % 2 ? b : a);
+   }
+   a->replaceAllUsesWith(b);
+   verify();
+   EXPECT_EQ(a->numUsers(), 0u);
+   EXPECT_EQ(b->numUsers(), 15u);
+   for(auto* user : b->users()) EXPECT_NE(user, nullptr);
+}
+
+TEST_F(UseListTest, RandomMutations) {
+   std::mt19937 rng{42};
+   std::vector<Node*> all;
+   for(unsigned i = 0; i < 16; i++) all.push_back(newNode());
+   auto pick = [&] { return all[rng() % all.size()]; };
+   for(unsigned step = 0; step < 2000; step++) {
+      auto* user = pick();
+      unsigned n = user->numChildren();
+      switch(rng() % 5) {
+         case 0:
+            user->addChild(pick());
+            break;
+         case 1:
+            user->addChild(pick(), n ? rng() % (n + 1) : 0);
+            break;
+         case 2:
+            if(n) user->removeChild(rng() % n);
+            break;
+         case 3:
+            if(n) user->truncateChildren(rng() % n);
+            break;
+         case 4:
+            if(n) user->replaceChild(rng() % n, pick());
+            break;
+      }
+      if(step % 50 == 0) verify();
+   }
+   verify();
+}
+
+} // namespace
@@ -0,0 +1,125 @@
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+
+#include "target/Target.h"
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Context.h"
+#include "tir/IRBuilder.h"
+#include "tir/TIR.h"
+#include "utils/BumpAllocator.h"
+
+/**
+ * Compares the memory resources on the allocation patterns of the compiler:
+ * building TIR (as in tirtest, but many functions) and building an AST-like
+ * tree of small nodes with pmr strings and vectors.
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+
+// Builds fns functions of insts instructions each, as tirtest does
+void BuildIR(std::pmr::memory_resource* resource, int fns, int insts) {
+   using namespace tir;
+   using BinOp = tir::Instruction::BinOp;
+   BumpAllocator allocator{resource};
+   auto& TI = target::TargetInfo::Get<target::ArchType::X86>();
+   Context ctx{allocator, TI};
+   CompilationUnit cu{ctx};
+   auto i32 = Type::getInt32Ty(ctx);
+   auto fnty = FunctionType::get(ctx, i32, {i32});
+   IRBuilder builder{ctx};
+   for(int i = 0; i < fns; i++) {
+      auto* fn = cu.CreateFunction(fnty, "f" + std::to_string(i));
+      auto* bb = builder.createBasicBlock(fn);
+      builder.setInsertPoint(bb->begin());
+      Value* val = *fn->args().begin();
+      for(int j = 0; j < insts; j++) {
+         val = builder.createBinaryInstr(
+               BinOp::Add, val, ConstantInt::Create(ctx, i32, j));
+      }
+      builder.createReturnInstr(val);
+   }
+}
+
+// Builds a tree of small nodes, each with a name and a list of children
+void BuildAST(std::pmr::memory_resource* resource, int nodes) {
+   struct Node {
+      std::pmr::string name;
+      std::pmr::vector<Node*> children;
+      int kind;
+      Node(std::pmr::memory_resource* r, int i)
+            : name{"node" + std::to_string(i), r}, children{r}, kind{i % 7} {}
+   };
+   std::pmr::polymorphic_allocator<Node> alloc{resource};
+   std::vector<Node*> parents{alloc.new_object<Node>(resource, 0)};
+   for(int i = 1; i < nodes; i++) {
+      auto* node = alloc.new_object<Node>(resource, i);
+      parents[i % parents.size()]->children.push_back(node);
+      if(i % 3 == 0) parents.push_back(node);
+   }
+}
+
+using Workload = std::function<void(std::pmr::memory_resource*)>;
+
+struct Candidate {
+   std::string name;
+   std::function<std::unique_ptr<std::pmr::memory_resource>()> create;
+};
+
+double Time(Candidate const& candidate, Workload const& work, int reps) {
+   auto start = Clock::now();
+   for(int i = 0; i < reps; i++) {
+      auto resource = candidate.create();
+      work(resource.get());
+   }
+   std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+   return elapsed.count() / reps;
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+   int scale = argc > 1 ? std::stoi(argv[1]) : 1;
+   int reps = argc > 2 ? std::stoi(argv[2]) : 5;
+   using Options = utils::CustomBufferResource::Options;
+   std::vector<Candidate> candidates{
+         {"CustomBufferResource",
+          [] { return std::make_unique<utils::CustomBufferResource>(); }},
+         {"CustomBufferResource (64K, THP)",
+          [] {
+             return std::make_unique<utils::CustomBufferResource>(
+                   Options{.initial_size = 64 * 1024,
+                           .max_chunk_size = 4 * 1024 * 1024,
+                           .huge_pages = true});
+          }},
+         {"monotonic_buffer_resource",
+          [] { return std::make_unique<std::pmr::monotonic_buffer_resource>(); }},
+         {"unsynchronized_pool_resource",
+          [] {
+             return std::make_unique<std::pmr::unsynchronized_pool_resource>();
+          }},
+   };
+   std::vector<std::pair<std::string, Workload>> workloads{
+         {"IR", [&](auto* r) { BuildIR(r, 200 * scale, 500); }},
+         {"AST", [&](auto* r) { BuildAST(r, 200000 * scale); }},
+   };
+   std::cout << std::left << std::setw(34) << "Resource";
+   for(auto& [name, _] : workloads) std::cout << std::right << std::setw(12) << name;
+   std::cout << "  (ms per run)\n";
+   for(auto& candidate : candidates) {
+      std::cout << std::left << std::setw(34) << candidate.name;
+      for(auto& [_, work] : workloads) {
+         std::cout << std::right << std::setw(12) << std::fixed
+                   << std::setprecision(2) << Time(candidate, work, reps);
+      }
+      std::cout << "\n";
+   }
+   return 0;
+}
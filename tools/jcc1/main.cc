@@ -8,8 +8,13 @@
 #include "AllPasses.h"
 #include "diagnostics/Diagnostics.h"
 #include "passes/IRPasses.h"
+#include "passes/Pipeline.h"
 #include "third-party/CLI11.h"
+#include "tir/Bitcode.h"
+#include "utils/Error.h"
 #include "utils/PassManager.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
 
 enum class InputMode { File, Stdin };
 void pretty_print_errors(SourceManager& SM, diagnostics::DiagnosticEngine& diag);
@@ -25,6 +30,16 @@ int main(int argc, char** argv) {
    int verboseLevel = 0;
    std::string optOutputFile = "";
    std::string optPipeline = "";
+   std::string optTimePasses = "";
+   std::string optTraceFile = "";
+   bool optStats = false;
+   bool optPerfCounters = false;
+   unsigned optJobs = 1;
+   bool optSerialPasses = false;
+   unsigned optOptLevel = 0;
+   size_t optMemoryBudget = 0;
+   bool optEmitBitcode = false;
+   std::string optLoadBitcode = "";
 
    // Create the pass manager and source manager
    CLI::App app{"Joos1W Compiler Frontend", "jcc1"};
@@ -40,6 +55,9 @@ int main(int argc, char** argv) {
    app.add_flag("-c", optCompile, "Compile-only, running all the front-end passes.");
    app.add_flag("-s", optCodeGen, "Run the front-end passes, then generate IR code. Implies -c.");
    app.add_option("-o", optOutputFile, "Output the generated code to this file.");
+   app.add_flag("--emit-bc", optEmitBitcode, "With -s, output the TIR as a binary bitcode module instead of text");
+   app.add_option("--load-bc", optLoadBitcode, "Load the TIR from this bitcode module (see --emit-bc) instead of\nrunning the front end. The function bodies are only loaded\nwhen the passes visit them")
+      ->check(CLI::ExistingFile);
    app.add_option("--stdlib", optStdlibPath, "The path to the standard library to use for compilation")
       ->check(CLI::ExistingDirectory)
       ->expected(0, 1)
@@ -55,6 +73,17 @@ int main(int argc, char** argv) {
    app.add_flag("--disable-heap-reuse", optDisableHeapReuse, "Do not reuse heap memory between passes (for debugging heap GC issues)");
    app.add_flag("--freestanding", optFreestanding, "Do not include the standard library in the compilation");
    app.add_flag("--debug-mc", "Dump each function's machine code DAG to .dot files for debugging");
+   app.add_flag("--time-passes{text}", optTimePasses, "Print the time and memory used by each pass at exit,\nas a table (default) or as JSON (--time-passes=json)")
+      ->check(CLI::IsMember({"text", "json"}));
+   app.add_option("--trace", optTraceFile, "Write a Chrome trace-event timeline of the compilation\nto this file (view with chrome://tracing or Perfetto)");
+   app.add_flag("--stats", optStats, "Print the statistics collected by the passes at exit");
+   app.add_option("-j,--jobs", optJobs, "Number of threads to run the passes on: the parallel-safe\nfunction passes, and the independent front-end passes\n(i.e., parsing) at the same time (default: 1)")
+      ->check(CLI::PositiveNumber);
+   app.add_flag("--serial-passes", optSerialPasses, "Run the front-end passes one at a time even with -j, in a\nfixed order (the output is the same either way)");
+   app.add_option("-O", optOptLevel, "The optimization level (0 to 2), selects a preset pipeline\nthat runs before the -p passes (default: 0)")
+      ->check(CLI::Range(0, 2));
+   app.add_option("--memory-budget", optMemoryBudget, "Soft limit on the resident memory in MiB. When exceeded, free\nheaps are returned to the system and cached analyses are\ndropped (and recomputed on demand)");
+   app.add_flag("--perf-counters", optPerfCounters, "Count hardware events (cycles, instructions, cache and\nbranch misses) per pass with perf_event_open and print\nthem at exit (Linux only)");
    // clang-format on
 
    // Build the front-end and optimization passes
@@ -85,6 +114,9 @@ int main(int argc, char** argv) {
       ss << "You can specify a comma separated list of passes to run.\n";
       ss << "Optimization passes are run in-order and may be specified more than "
             "once.\n";
+      ss << "Optimization passes may be grouped with parentheses, and a group\n"
+            "followed by * is repeated until it no longer changes the IR,\n"
+            "e.g. mem2reg,(simplifycfg,mem2reg)*\n";
       ss << "Frontend passes are always run first, and run only once.";
       app.add_option("-p,--pipeline", optPipeline, ss.str());
    }
@@ -95,6 +127,33 @@ int main(int argc, char** argv) {
    // Disable heap reuse if requested
    if(optDisableHeapReuse) PM.SetHeapReuse(false);
 
+   // Limit the memory used by the passes if requested
+   if(optMemoryBudget) PM.SetMemoryBudget(optMemoryBudget * 1024 * 1024);
+
+   // Start recording the trace, it is written out at exit
+   if(!optTraceFile.empty()) utils::trace::Start(optTraceFile);
+
+   // Run the parallel-safe passes on a thread pool if requested
+   PM.SetNumThreads(optJobs);
+   if(optSerialPasses) PM.SetSerialPasses(true);
+
+   // Collect the pass statistics if requested, they are printed at exit
+   if(optStats) utils::Statistic::SetEnabled(true);
+
+   // Count hardware events per pass if requested, it is not an error if the
+   // counters are unavailable (i.e., perf_event_paranoid is too high)
+   if(optPerfCounters && !PM.EnablePerfCounters()) {
+      std::cerr << "Warning: hardware performance counters are unavailable, "
+                   "ignoring --perf-counters" << std::endl;
+   }
+
+   // Enable the pass timing report if requested
+   if(optTimePasses == "text") {
+      PM.SetTimePasses(utils::TimePassesFormat::Text);
+   } else if(optTimePasses == "json") {
+      PM.SetTimePasses(utils::TimePassesFormat::Json);
+   }
+
    // Validate the command line options
    {
       auto split = app.count("--print-split");
@@ -146,8 +205,11 @@ int main(int argc, char** argv) {
       optInputMode = InputMode::File;
    }
 
-   // Read the input into the source manager (either from file or stdin)
-   if(optInputMode == InputMode::File) {
+   // Read the input into the source manager (either from file or stdin),
+   // there is nothing to read if the front end is skipped
+   if(!optLoadBitcode.empty()) {
+      optFreestanding = true;
+   } else if(optInputMode == InputMode::File) {
       for(auto const& path : files) {
          SM.addFile(path);
       }
@@ -185,30 +247,35 @@ int main(int argc, char** argv) {
       }
    }
 
-   // Parse the pipeline string by splitting by ","
-   std::vector<std::string> optPassNames;
+   // Parse the pipeline string, the -O preset runs before the -p passes
+   passes::Pipeline optPasses;
    std::unordered_set<std::string> fePasses;
    {
-      std::istringstream ss{optPipeline};
-      std::string name;
-      while(std::getline(ss, name, ',')) {
-         if(name.empty()) continue;
-         if(!PM.HasPass(name)) {
-            std::cerr << "Error: Unknown pass " << name << std::endl;
-            return 1;
+      // Parsed apart, so the error columns are those of the -p string
+      auto parsed = passes::ParsePipeline(
+            passes::GetOptLevelPipeline(optOptLevel), PM, std::cerr);
+      auto extra = passes::ParsePipeline(optPipeline, PM, std::cerr);
+      if(!parsed || !extra) return 1;
+      parsed->insert(parsed->end(),
+                     std::make_move_iterator(extra->begin()),
+                     std::make_move_iterator(extra->end()));
+      for(auto& element : *parsed) {
+         if(element.isGroup()) {
+            optPasses.push_back(std::move(element));
+            continue;
          }
-         auto& pass = PM.FindPass(name);
+         auto& pass = PM.FindPass(element.pass);
          switch(static_cast<PassTag>(pass.Tag())) {
             case PassTag::FrontendPass:
-               fePasses.insert(name);
+               fePasses.insert(element.pass);
                break;
             case PassTag::BasicBlockPass:
             case PassTag::FunctionPass:
             case PassTag::CompilationUnitPass:
-               optPassNames.push_back(name);
+               optPasses.push_back(std::move(element));
                break;
             default:
-               std::cerr << "Error: Unknown pass " << name << std::endl;
+               std::cerr << "Error: Unknown pass " << element.pass << std::endl;
                return 1;
          }
       }
@@ -221,32 +288,31 @@ int main(int argc, char** argv) {
          }
          if(verboseLevel > 0) std::cerr << std::endl;
       }
-      if(!optPassNames.empty()) {
+      if(!optPasses.empty()) {
          if(verboseLevel > 0)
             std::cerr << "Enabled optimization passes (in order):";
-         for(auto const& pass : optPassNames)
-            if(verboseLevel > 0) std::cerr << " " << pass;
+         for(auto const& element : optPasses)
+            if(verboseLevel > 0) std::cerr << " " << element;
          if(verboseLevel > 0) std::cerr << std::endl;
       }
    }
 
    // Build the front end pipeline now that we have the files
    {
-      using utils::Pass;
-      Pass* p2 = nullptr;
-      for(auto file : SM.files()) {
-         auto* p1 = &NewJoos1WParserPass(PM, file, p2);
-         p2 = &NewAstBuilderPass(PM, p1);
-      }
+      for(auto file : SM.files())
+         NewAstBuilderPass(PM, &NewJoos1WParserPass(PM, file));
    }
 
-   // Enable the default front-end pass to run
-   if(fePasses.empty()) {
+   // Enable the default front-end pass to run, or just the IR context if the
+   // TIR is loaded instead
+   if(!optLoadBitcode.empty()) {
+      PM.EnablePass("ir-context");
+   } else if(fePasses.empty()) {
       PM.EnablePass("dfa");
    }
 
    // If we want to codegen, enable the codegen pass
-   if(optCodeGen || !optCompile) {
+   if((optCodeGen || !optCompile) && optLoadBitcode.empty()) {
       PM.EnablePass("codegen-tir");
    }
 
@@ -268,18 +334,35 @@ int main(int argc, char** argv) {
       return 0;
    }
 
-   // Run the middle-end pipeline now and add the IR context pass
-   for(auto const& name : optPassNames) {
-      PM.Reset();
-      PM.EnablePass(name);
-      PM.Run();
+   // Load the TIR instead of generating it, only the types and globals are
+   // read now and the bodies as the passes visit them
+   if(!optLoadBitcode.empty()) {
+      auto& CU = PM.FindPass<passes::IRContext>().CU();
+      try {
+         auto reader = tir::BitcodeReader::OpenFile(CU, optLoadBitcode);
+         reader->load();
+         CU.setMaterializer(std::move(reader));
+      } catch(utils::FatalError const& e) {
+         std::cerr << "Error: cannot load " << optLoadBitcode << ": " << e.what()
+                   << std::endl;
+         return 1;
+      }
    }
 
+   // Run the middle-end pipeline now and add the IR context pass
+   passes::RunPipeline(PM, optPasses);
+
    // Dump the generated code to the output file and exit when "-s" is set
    if(optCodeGen) {
-      std::ofstream out{optOutputFile};
-      PM.FindPass<passes::IRContext>().CU().print(out);
-      out.close();
+      auto& CU = PM.FindPass<passes::IRContext>().CU();
+      if(optEmitBitcode) {
+         std::ofstream out{optOutputFile, std::ios::binary};
+         tir::WriteBitcode(CU, out);
+      } else {
+         std::ofstream out{optOutputFile};
+         CU.materializeAll();
+         CU.print(out);
+      }
       return 0;
    }
 
@@ -0,0 +1,219 @@
+#include <fstream>
+#include <iostream>
+#include <iterator>
+#include <memory>
+#include <span>
+#include <sstream>
+#include <string>
+#include <string_view>
+
+#include "AllPasses.h"
+#include "passes/IRPasses.h"
+#include "passes/Pipeline.h"
+#include "passes/analysis/DominatorTree.h"
+#include "third-party/CLI11.h"
+#include "tir/Bitcode.h"
+#include "tir/Parser.h"
+#include "utils/Error.h"
+#include "utils/PassManager.h"
+#include "utils/Statistic.h"
+#include "utils/Trace.h"
+
+int main(int argc, char** argv) {
+   std::string optInputFile = "-";
+   std::string optOutputFile = "-";
+   std::string optPipeline = "";
+   std::string optTimePasses = "";
+   std::string optTraceFile = "";
+   bool optStats = false;
+   unsigned optJobs = 1;
+   unsigned optOptLevel = 0;
+   bool optEmitBitcode = false;
+   bool optDisableOutput = false;
+   bool optPrintDomTree = false;
+   // The input is read before the pass manager owning the CU is created, so
+   // it outlives a bitcode reader reading from it
+   std::string input;
+
+   // Create the pass manager
+   CLI::App app{"TIR Optimizer", "tir-opt"};
+   utils::PassManager PM{app};
+
+   // clang-format off
+   // Build the tir-opt-specific command line options
+   app.add_option("input", optInputFile, "The TIR module to optimize, either as text (as printed\nby jcc1 -s) or as bitcode (see --emit-bc), or - for stdin")
+      ->capture_default_str();
+   app.add_option("-o", optOutputFile, "Output the optimized TIR to this file, or - for stdout")
+      ->capture_default_str();
+   app.add_flag("--emit-bc", optEmitBitcode, "Output the TIR as a binary bitcode module instead of text");
+   app.add_flag("--disable-output", optDisableOutput, "Do not output the TIR (i.e., to time the passes only)");
+   app.add_flag("--print-dt", optPrintDomTree, "Print the dominator tree of each function after the pipeline");
+   app.add_option("-O", optOptLevel, "The optimization level (0 to 2), selects a preset pipeline\nthat runs before the -p passes (default: 0)")
+      ->check(CLI::Range(0, 2));
+   app.add_option("-j,--jobs", optJobs, "Number of threads to run the parallel-safe function passes on\n(default: 1)")
+      ->check(CLI::PositiveNumber);
+   app.add_flag("--time-passes{text}", optTimePasses, "Print the time and memory used by each pass at exit,\nas a table (default) or as JSON (--time-passes=json)")
+      ->check(CLI::IsMember({"text", "json"}));
+   app.add_option("--trace", optTraceFile, "Write a Chrome trace-event timeline to this file\n(view with chrome://tracing or Perfetto)");
+   app.add_flag("--stats", optStats, "Print the statistics collected by the passes at exit");
+   // Build the pass-specific global command line options
+   app.add_flag("--debug-mc", "Dump each function's machine code DAG to .dot files for debugging");
+   // clang-format on
+
+   // Build the optimization passes
+   BuildOptPasses(PM);
+
+   // Add the pipeline option and print the pass names
+   {
+      std::ostringstream ss;
+      ss << "The pipeline string to run. Below is a list of the passes.\n";
+      for(auto const* pass : PM.Passes()) {
+         auto name = pass->Name();
+         auto tag = static_cast<PassTag>(pass->Tag());
+         if(name.empty() || (tag != PassTag::BasicBlockPass &&
+                             tag != PassTag::FunctionPass &&
+                             tag != PassTag::CompilationUnitPass))
+            continue;
+         // Pad name with spaces to align the descriptions
+         ss << "    " << name;
+         for(size_t i = name.size(); i < 15; ++i) ss << " ";
+         ss << pass->Desc() << "\n";
+      }
+      ss << "Passes may be grouped with parentheses, and a group followed\n"
+            "by * is repeated until it no longer changes the IR,\n"
+            "e.g. mem2reg,(simplifycfg,mem2reg)*";
+      app.add_option("-p,--pipeline", optPipeline, ss.str());
+   }
+
+   // Parse the command line options
+   CLI11_PARSE(app, argc, argv);
+
+   // Start recording the trace, it is written out at exit
+   if(!optTraceFile.empty()) utils::trace::Start(optTraceFile);
+
+   // Run the parallel-safe passes on a thread pool if requested
+   PM.SetNumThreads(optJobs);
+
+   // Collect the pass statistics if requested, they are printed at exit
+   if(optStats) utils::Statistic::SetEnabled(true);
+
+   // Enable the pass timing report if requested
+   if(optTimePasses == "text") {
+      PM.SetTimePasses(utils::TimePassesFormat::Text);
+   } else if(optTimePasses == "json") {
+      PM.SetTimePasses(utils::TimePassesFormat::Json);
+   }
+
+   // Parse the pipeline string, the -O preset runs before the -p passes
+   passes::Pipeline optPasses;
+   {
+      // Parsed apart, so the error columns are those of the -p string
+      auto parsed = passes::ParsePipeline(
+            passes::GetOptLevelPipeline(optOptLevel), PM, std::cerr);
+      auto extra = passes::ParsePipeline(optPipeline, PM, std::cerr);
+      if(!parsed || !extra) return 1;
+      parsed->insert(parsed->end(),
+                     std::make_move_iterator(extra->begin()),
+                     std::make_move_iterator(extra->end()));
+      for(auto& element : *parsed) {
+         if(!element.isGroup()) {
+            auto tag = static_cast<PassTag>(PM.FindPass(element.pass).Tag());
+            if(tag != PassTag::BasicBlockPass && tag != PassTag::FunctionPass &&
+               tag != PassTag::CompilationUnitPass) {
+               std::cerr << "Error: Pass " << element.pass
+                         << " does not run on TIR" << std::endl;
+               return 1;
+            }
+         }
+         optPasses.push_back(std::move(element));
+      }
+   }
+
+   // Create the IR context to read the module into
+   PM.EnablePass("ir-context");
+   PM.Init();
+   if(!PM.Run()) {
+      std::cerr << "Error running pass: " << PM.LastRun()->Desc() << std::endl;
+      return 1;
+   }
+
+   // Read the module, the bitcode function bodies are only loaded when the
+   // passes visit them
+   auto& CU = PM.FindPass<passes::IRContext>().CU();
+   auto name = optInputFile == "-" ? std::string{"<stdin>"} : optInputFile;
+   try {
+      std::unique_ptr<tir::BitcodeReader> reader;
+      if(optInputFile == "-") {
+         input.assign(std::istreambuf_iterator<char>{std::cin},
+                      std::istreambuf_iterator<char>{});
+         if(input.starts_with("TIRB")) {
+            reader = std::make_unique<tir::BitcodeReader>(
+                  CU,
+                  std::span{reinterpret_cast<uint8_t const*>(input.data()),
+                            input.size()});
+         }
+      } else {
+         std::ifstream file{optInputFile, std::ios::binary};
+         if(!file) {
+            std::cerr << "Error: cannot open " << optInputFile << std::endl;
+            return 1;
+         }
+         // Map the bitcode modules, and read the text ones
+         char magic[4] = {};
+         file.read(magic, sizeof(magic));
+         if(std::string_view{magic, sizeof(magic)} == "TIRB") {
+            reader = tir::BitcodeReader::OpenFile(CU, optInputFile);
+         } else {
+            file.clear();
+            file.seekg(0);
+            input.assign(std::istreambuf_iterator<char>{file},
+                         std::istreambuf_iterator<char>{});
+         }
+      }
+      if(reader) {
+         reader->load();
+         CU.setMaterializer(std::move(reader));
+      } else {
+         tir::ParseModule(CU, input, name);
+      }
+   } catch(utils::FatalError const& e) {
+      std::cerr << "Error: " << e.what() << std::endl;
+      return 1;
+   }
+
+   // Run the pipeline
+   passes::RunPipeline(PM, optPasses);
+
+   // Open the output, if any
+   std::ofstream outFile;
+   if(optOutputFile != "-" && (!optDisableOutput || optPrintDomTree)) {
+      outFile.open(optOutputFile, std::ios::binary);
+      if(!outFile) {
+         std::cerr << "Error: cannot open " << optOutputFile << std::endl;
+         return 1;
+      }
+   }
+   std::ostream& out = optOutputFile == "-" ? std::cout : outFile;
+
+   // Print the dominator tree of each function
+   if(optPrintDomTree) {
+      auto& DTW = PM.FindPass<passes::DominatorTreeWrapper>();
+      CU.materializeAll();
+      for(auto* fn : CU.functions()) {
+         if(!fn->hasBody()) continue;
+         out << "function @" << fn->name() << "\n";
+         DTW.DT(fn).print(out);
+      }
+   }
+
+   // Output the optimized module
+   if(!optDisableOutput) {
+      if(optEmitBitcode) {
+         tir::WriteBitcode(CU, out);
+      } else {
+         CU.materializeAll();
+         CU.print(out);
+      }
+   }
+   return 0;
+}
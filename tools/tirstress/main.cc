@@ -0,0 +1,102 @@
+#include <chrono>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "target/Target.h"
+#include "tir/BasicBlock.h"
+#include "tir/Constant.h"
+#include "tir/Context.h"
+#include "tir/IRBuilder.h"
+#include "tir/TIR.h"
+#include "utils/BumpAllocator.h"
+#include "utils/ThreadPool.h"
+
+/**
+ * Stress tests tir::Context in concurrent mode: builds many functions at once
+ * on a thread pool, all sharing the types, the constants and a callee, and
+ * reports the time taken. Build with -DSANITIZE_THREAD=ON (in debug mode) to
+ * run it under the thread sanitizer; the results are checked by the unit
+ * tests (see tests/unit/ConcurrentContextTest.cc).
+ */
+
+namespace {
+
+using Clock = std::chrono::steady_clock;
+using namespace tir;
+using BinOp = tir::Instruction::BinOp;
+
+// Integer types of this many widths are created by the workers, in a
+// different order by each function
+constexpr unsigned NumWidths = 48;
+// The constants range over [0, NumConstants)
+constexpr unsigned NumConstants = 256;
+
+// Builds fn as a chain of insts diamonds, each adding a constant to the
+// argument and calling the shared sink function
+void BuildFunction(Context& ctx, Function* fn, Function* sink, unsigned index,
+                   unsigned insts) {
+   IRBuilder builder{ctx};
+   auto* i32 = Type::getInt32Ty(ctx);
+   auto* entry = builder.createBasicBlock(fn);
+   builder.setInsertPoint(entry->begin());
+   Value* val = *fn->args().begin();
+   for(unsigned j = 0; j < insts; j++) {
+      // Create (or find) a type and a constant that other workers race for
+      Type* ty = IntegerType::get(ctx, 1 + (index + j) % NumWidths);
+      (void)ArrayType::get(ctx, ty, j % 4);
+      (void)FunctionType::get(ctx, ty, {i32, ty});
+      auto* cst = ConstantInt::Create(ctx, i32, (index * 7 + j) % NumConstants);
+      auto* lhs = builder.createBinaryInstr(BinOp::Add, val, cst);
+      auto* cond = builder.createCmpInstr(
+            CmpInst::Predicate::LT, lhs, ConstantInt::Create(ctx, i32, j));
+      auto* then = builder.createBasicBlock(fn);
+      auto* join = builder.createBasicBlock(fn);
+      builder.createBranchInstr(cond, then, join);
+      builder.setInsertPoint(then->begin());
+      builder.createCallInstr(sink, {lhs});
+      builder.createBranchInstr(join);
+      builder.setInsertPoint(join->begin());
+      val = lhs;
+   }
+   builder.createReturnInstr(val);
+}
+
+} // namespace
+
+int main(int argc, char** argv) {
+   unsigned threads = argc > 1 ? std::stoul(argv[1]) : 8;
+   unsigned numFns = argc > 2 ? std::stoul(argv[2]) : 2000;
+   unsigned insts = argc > 3 ? std::stoul(argv[3]) : 50;
+   unsigned reps = argc > 4 ? std::stoul(argv[4]) : 3;
+   auto& TI = target::TargetInfo::Get<target::ArchType::X86>();
+   utils::ThreadPool pool{threads};
+   double total = 0;
+   for(unsigned rep = 0; rep < reps; rep++) {
+      utils::CustomBufferResource resource{};
+      BumpAllocator allocator{&resource};
+      Context ctx{allocator, TI};
+      CompilationUnit cu{ctx};
+      // The functions are declared up front, as the CU is not concurrent-safe
+      auto* i32 = Type::getInt32Ty(ctx);
+      auto* fnty = FunctionType::get(ctx, i32, {i32});
+      auto* sink = cu.CreateFunction(
+            FunctionType::get(ctx, Type::getVoidTy(ctx), {i32}), "sink");
+      std::vector<Function*> fns;
+      for(unsigned i = 0; i < numFns; i++)
+         fns.push_back(cu.CreateFunction(fnty, "f" + std::to_string(i)));
+      // Then built in parallel
+      auto start = Clock::now();
+      ctx.setConcurrent(true);
+      pool.ParallelFor(numFns, [&](size_t i) {
+         BuildFunction(ctx, fns[i], sink, i, insts);
+      });
+      ctx.setConcurrent(false);
+      std::chrono::duration<double, std::milli> elapsed = Clock::now() - start;
+      total += elapsed.count();
+   }
+   std::cout << "Built " << numFns << " functions of " << insts
+             << " diamonds on " << threads << " threads in "
+             << total / reps << " ms per run" << std::endl;
+   return 0;
+}